@@ -0,0 +1,135 @@
+// Native benchmark of AdcSampler: simulated sampling time and noise of the
+// moisture reading for each filter and sample count, to pick the cheapest
+// configuration meeting a noise target, then the CPU time the continuous
+// driver saves over one-shot reads. Run with
+//   pio run -e native-adc-benchmark -t exec
+// STACY_ADC_NOISE_MV, STACY_ADC_SPIKE_PERMILLE and STACY_ADC_US shape the
+// simulated ADC, STACY_ADC_STREAM replays a recorded one; STACY_NOISE_TARGET
+// is the target in hundredths of a percent.
+#include "adc_sampler.h"
+#include "configuration.h"
+#include <Arduino.h>
+
+#define TRIALS 500
+// Work overlapping the continuous conversions, as an HDC3022 LP0 conversion
+#define OVERLAP_US 12500
+
+static const char *const filterNames[] = {"mean", "median", "trimmed"};
+
+/**
+ * @brief Measures one configuration.
+ * @param config The configuration to measure.
+ * @param standardDeviation Set to the standard deviation of the moisture.
+ * @param worstError Set to the largest deviation from the mean.
+ * @return The mean sampling time in microseconds.
+ */
+static float measure(const AdcSamplerConfig &config, float &standardDeviation,
+                     float &worstError) {
+  static float moistures[TRIALS];
+  unsigned long elapsed = 0;
+  float sum = 0;
+
+  for (int i = 0; i < TRIALS; i++) {
+    unsigned long start = micros();
+    float value = AdcSampler::read(CAPACITANCE_PIN, config);
+    elapsed += micros() - start;
+    moistures[i] =
+        AdcSampler::mapClamped(value, AIR_VALUE, WATER_VALUE, 0.0, 100.0);
+    sum += moistures[i];
+  }
+
+  float mean = sum / TRIALS;
+  float variance = 0;
+  worstError = 0;
+  for (int i = 0; i < TRIALS; i++) {
+    float error = moistures[i] - mean;
+    variance += error * error;
+    worstError = max(worstError, fabsf(error));
+  }
+  standardDeviation = sqrtf(variance / TRIALS);
+  return (float)elapsed / TRIALS;
+}
+
+/**
+ * @brief Reads moisture and battery like a wake does.
+ * @param continuous Whether to start the continuous driver first and do
+ * other work while it converts.
+ * @param moisture Set to the moisture reading.
+ * @param battery Set to the battery reading.
+ * @return The time the CPU was blocked reading, in microseconds.
+ */
+static unsigned long readBoth(bool continuous, float &moisture,
+                              float &battery) {
+  static const AdcSamplerConfig moistureSampling = {
+      MOISTURE_SAMPLES, MOISTURE_FILTER, MOISTURE_TRIM, false};
+  static const AdcSamplerConfig batterySampling = {
+      BATTERY_SAMPLES, BATTERY_FILTER, BATTERY_TRIM, true};
+
+  if (continuous) {
+    AdcSampler::beginContinuous();
+    delayMicroseconds(OVERLAP_US);
+  }
+  unsigned long start = micros();
+  moisture = AdcSampler::read(CAPACITANCE_PIN, moistureSampling);
+  battery = AdcSampler::read(BATTERY_PIN, batterySampling);
+  return micros() - start;
+}
+
+/**
+ * @brief Compares one-shot reads with the continuous driver.
+ */
+static void compareContinuous() {
+  printf("\npath        blocked (us)  moisture (raw)  battery (mV)\n");
+  for (int continuous = 0; continuous <= 1; continuous++) {
+    unsigned long blocked = 0;
+    float moisture = 0, battery = 0;
+    for (int i = 0; i < TRIALS; i++) {
+      float moistureValue, batteryValue;
+      blocked += readBoth(continuous, moistureValue, batteryValue);
+      moisture += moistureValue;
+      battery += batteryValue;
+    }
+    printf("%-11s %12.0f %15.1f %13.1f\n",
+           continuous ? "continuous" : "one-shot", (float)blocked / TRIALS,
+           moisture / TRIALS, battery / TRIALS);
+  }
+}
+
+void setup() {
+  float target = NativeHal::envLong("STACY_NOISE_TARGET", 25) / 100.0;
+  float bestTime = 0;
+  AdcSamplerConfig best = {0, ADC_FILTER_MEAN, 0, false};
+
+  printf("filter   samples  trim  time (us)  stddev (%%)  worst (%%)\n");
+  for (int filter = ADC_FILTER_MEAN; filter <= ADC_FILTER_TRIMMED_MEAN;
+       filter++) {
+    for (uint8_t samples = 1; samples <= ADC_MAX_SAMPLES; samples *= 2) {
+      uint8_t trim = filter == ADC_FILTER_TRIMMED_MEAN ? samples / 5 : 0;
+      if (filter == ADC_FILTER_TRIMMED_MEAN && trim == 0 && samples > 1)
+        trim = 1;
+      AdcSamplerConfig config = {samples, (AdcFilter)filter, trim, false};
+      float standardDeviation, worstError;
+      float time = measure(config, standardDeviation, worstError);
+      printf("%-8s %7u %5u %10.0f %11.3f %10.3f\n", filterNames[filter],
+             samples, trim, time, standardDeviation, worstError);
+
+      if (standardDeviation <= target && (!best.samples || time < bestTime)) {
+        best = config;
+        bestTime = time;
+      }
+    }
+  }
+
+  if (best.samples) {
+    printf("Cheapest under %.2f %%: %s, %u samples, trim %u (%.0f us)\n",
+           target, filterNames[best.filter], best.samples, best.trim,
+           bestTime);
+  } else {
+    printf("No configuration reaches %.2f %%.\n", target);
+  }
+
+  compareContinuous();
+  NativeHal::powerOff();
+}
+
+void loop() {}
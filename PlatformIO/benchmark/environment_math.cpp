@@ -0,0 +1,187 @@
+// Benchmark of EnvironmentMath against the BME280 library's
+// EnvironmentCalculations: the error of both against the same formulas in
+// double precision over the sensor range, then the cost of one dew point
+// and one heat index. Run on the host with
+//   pio run -e native-math-benchmark -t exec
+// where the cost is host time, which hides what soft-float costs, or on the
+// board with
+//   pio run -e main-math-benchmark -t upload -t monitor
+// which counts CPU cycles on a coarser grid.
+#include "configuration.h"
+#include "environment_math.h"
+#include <Arduino.h>
+#include <EnvironmentCalculations.h>
+#include <math.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#define MATH_STEP 1.0 // °C and %RH between checked points
+#define MATH_LOOPS 20
+#define MATH_UNIT "cycles"
+#else
+#include <chrono>
+#define MATH_STEP 0.05
+#define MATH_LOOPS 20000
+#define MATH_UNIT "host ns"
+#endif
+
+#define MATH_MIN_CELSIUS -40.0 // HDC3022 and BME280 range
+#define MATH_MAX_CELSIUS 125.0
+#define MATH_MIN_HUMIDITY 0.1
+#define MATH_MAX_HUMIDITY 100.0
+#define MATH_INPUTS 256
+
+typedef float (*MathFunction)(float celsius, float humidity);
+
+typedef struct MathError {
+  double max;
+  double sum;
+  uint32_t count;
+  float celsius; // where the error is largest
+  float humidity;
+} MathError;
+
+static float celsiusInputs[MATH_INPUTS];
+static float humidityInputs[MATH_INPUTS];
+static volatile float sink;
+
+/**
+ * @brief The Magnus dew point in double precision.
+ */
+static double referenceDewPoint(double celsius, double humidity) {
+  double gamma = log(humidity / 100.0) + 17.625 * celsius / (243.04 + celsius);
+  return 243.04 * gamma / (17.625 - gamma);
+}
+
+/**
+ * @brief The NWS heat index in double precision, in °C.
+ */
+static double referenceHeatIndex(double celsius, double humidity) {
+  double t = celsius * 9.0 / 5.0 + 32.0;
+  double heatIndex = t;
+  if (t > 40) {
+    heatIndex = 0.5 * (t + 61.0 + ((t - 68.0) * 1.2) + (humidity * 0.094));
+    if (heatIndex >= 79) {
+      heatIndex = -42.379 + 2.04901523 * t + 10.14333127 * humidity -
+                  0.22475541 * t * humidity - 0.00683783 * t * t -
+                  0.05481717 * humidity * humidity +
+                  0.00122874 * t * t * humidity +
+                  0.00085282 * t * humidity * humidity -
+                  0.00000199 * t * t * humidity * humidity;
+      if (humidity < 13 && t >= 80.0 && t <= 112.0) {
+        heatIndex -= ((13.0 - humidity) * 0.25) *
+                     sqrt((17.0 - fabs(t - 95.0)) * 0.05882);
+      } else if (humidity > 85.0 && t >= 80.0 && t <= 87.0) {
+        heatIndex += 0.02 * (humidity - 85.0) * (87.0 - t);
+      }
+    }
+  }
+  return (heatIndex - 32.0) * 5.0 / 9.0;
+}
+
+static float libraryDewPoint(float celsius, float humidity) {
+  return EnvironmentCalculations::DewPoint(
+      celsius, humidity, EnvironmentCalculations::TempUnit_Celsius);
+}
+
+static float libraryHeatIndex(float celsius, float humidity) {
+  return EnvironmentCalculations::HeatIndex(
+      celsius, humidity, EnvironmentCalculations::TempUnit_Celsius);
+}
+
+/**
+ * @brief Adds the error of one value to a tally.
+ */
+static void tally(MathError &error, float value, double reference,
+                  float celsius, float humidity) {
+  double difference = fabs(value - reference);
+  if (difference > error.max) {
+    error.max = difference;
+    error.celsius = celsius;
+    error.humidity = humidity;
+  }
+  error.sum += difference * difference;
+  error.count++;
+}
+
+static void printError(const char *label, const MathError &error) {
+  Serial.printf("%-28s %10.6f %10.6f   at %.2f °C, %.2f %%RH\n", label,
+                error.max, sqrt(error.sum / error.count), error.celsius,
+                error.humidity);
+}
+
+/**
+ * @brief Times a function over the input table.
+ * @return The mean cost of a call, in MATH_UNIT.
+ */
+static double cost(MathFunction function) {
+#ifdef ARDUINO_ARCH_ESP32
+  uint32_t start = ESP.getCycleCount();
+#else
+  auto start = std::chrono::steady_clock::now();
+#endif
+  for (int loop = 0; loop < MATH_LOOPS; loop++)
+    for (int i = 0; i < MATH_INPUTS; i++)
+      sink = function(celsiusInputs[i], humidityInputs[i]);
+#ifdef ARDUINO_ARCH_ESP32
+  double elapsed = (uint32_t)(ESP.getCycleCount() - start);
+#else
+  double elapsed = std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+#endif
+  return elapsed / ((double)MATH_LOOPS * MATH_INPUTS);
+}
+
+void setup() {
+  Serial.begin(115200);
+#ifdef ARDUINO_ARCH_ESP32
+  while (!Serial)
+    delay(10);
+  delay(DELAY_SHORT);
+#endif
+
+  MathError errors[4] = {};
+  for (double celsius = MATH_MIN_CELSIUS; celsius <= MATH_MAX_CELSIUS;
+       celsius += MATH_STEP) {
+    for (double humidity = MATH_MIN_HUMIDITY; humidity <= MATH_MAX_HUMIDITY;
+         humidity += MATH_STEP) {
+      // The functions take floats, so the reference does too
+      float t = celsius;
+      float h = humidity;
+      double dewPoint = referenceDewPoint(t, h);
+      double heatIndex = referenceHeatIndex(t, h);
+      tally(errors[0], libraryDewPoint(t, h), dewPoint, t, h);
+      tally(errors[1], EnvironmentMath::dewPoint(t, h), dewPoint, t, h);
+      tally(errors[2], libraryHeatIndex(t, h), heatIndex, t, h);
+      tally(errors[3], EnvironmentMath::heatIndex(t, h), heatIndex, t, h);
+    }
+  }
+
+  // Inputs spread over the range, so that every branch is taken
+  for (int i = 0; i < MATH_INPUTS; i++) {
+    celsiusInputs[i] = MATH_MIN_CELSIUS +
+                       (MATH_MAX_CELSIUS - MATH_MIN_CELSIUS) *
+                           ((i * 37) % MATH_INPUTS) / MATH_INPUTS;
+    humidityInputs[i] = MATH_MIN_HUMIDITY +
+                        (MATH_MAX_HUMIDITY - MATH_MIN_HUMIDITY) * i /
+                            MATH_INPUTS;
+  }
+
+  Serial.printf("error against double, °C %14s %10s\n", "max", "rms");
+  printError("dew point, library", errors[0]);
+  printError("dew point, EnvironmentMath", errors[1]);
+  printError("heat index, library", errors[2]);
+  printError("heat index, EnvironmentMath", errors[3]);
+  Serial.printf("\ncost per call (%s)\n", MATH_UNIT);
+  Serial.printf("dew point, library %21.1f\n", cost(libraryDewPoint));
+  Serial.printf("dew point, EnvironmentMath %13.1f\n",
+                cost(EnvironmentMath::dewPoint));
+  Serial.printf("heat index, library %20.1f\n", cost(libraryHeatIndex));
+  Serial.printf("heat index, EnvironmentMath %12.1f\n",
+                cost(EnvironmentMath::heatIndex));
+#ifndef ARDUINO_ARCH_ESP32
+  NativeHal::powerOff();
+#endif
+}
+
+void loop() {}
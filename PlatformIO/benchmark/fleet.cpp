@@ -0,0 +1,403 @@
+// Fleet load generator: simulates STACY_FLEET_DEVICES stations uplinking to
+// the server at SERVER_URL through the firmware's own NetworkHandler, so
+// every request carries the headers and payload a station sends. Each
+// station has its own Device-ID and bearer token and uplinks once every
+// READING_BUFFER_FLUSH_COUNT wakes, on a new connection, with a full batch
+// and a wake profile. Tokens expire STACY_FLEET_TOKEN_S simulated seconds
+// after they were issued, when the station gets a 403 and takes the refresh
+// path. Run against a local backend with, for example,
+//   STACY_PROVISION=1 STACY_UID=<uid> STACY_TOKEN=<jwt>
+//   STACY_FLEET_REGISTER=1 pio run -e native-fleet-benchmark -t exec
+// in the environment, or STACY_FLEET_EMAIL and STACY_FLEET_PASSWORD to log
+// in first.
+//
+// The stand-ins are not thread safe, so each of the STACY_FLEET_WORKERS
+// concurrent clients is a process with its share of the stations. The
+// schedule is open loop: a station uplinks when it is due whether or not the
+// server kept up, and the lag behind the schedule is reported with the
+// latencies. STACY_FLEET_SPEEDUP runs that many simulated seconds per second.
+#include "configuration.h"
+#include "credentials.h"
+#include "device_config.h"
+#include "logger.h"
+#include "network_handler.h"
+#include "phase_profiler.h"
+#include "reading_buffer.h"
+#include "reading_record.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define FLEET_WAKES_PER_DAY 17280 // TPL5110 period of 5 s, as in NativeHal
+#define FLEET_JITTER 0.01         // TPL5110 period tolerance
+#define FLEET_AWAKE 510           // awake time of an uplink wake, 100 us
+
+typedef std::chrono::steady_clock FleetClock;
+
+// What an uplink came to
+typedef enum {
+  UPLINK_ACCEPTED,  // 201 with the token the station had
+  UPLINK_REFRESHED, // 403, refresh, then 201 on the retry
+  UPLINK_FAILED,
+} UplinkOutcome;
+
+typedef struct FleetStation {
+  char mac[18];
+  double nextUplink;  // simulated s since the start
+  double tokenExpiry; // simulated s since the start
+  uint32_t uplinks;
+  char token[CONFIG_TOKEN_SIZE];
+} FleetStation;
+
+typedef struct FleetSample {
+  uint32_t latency; // us from beginning the uplink to its last response
+  uint32_t lag;     // us the uplink began after it was due
+  uint8_t outcome;  // UplinkOutcome
+} FleetSample;
+
+// Totals a worker passes to the parent ahead of its samples
+typedef struct FleetTotals {
+  uint32_t samples;
+  uint32_t httpRequests;
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+} FleetTotals;
+
+static long devices;
+static long workers;
+static double duration;   // wall s
+static double speedup;    // simulated s per wall s
+static double uplinkTime; // simulated s between uplinks
+static double tokenLifetime;
+static FleetClock::time_point startTime;
+static char uid[CONFIG_UID_SIZE];
+static char accountToken[CONFIG_TOKEN_SIZE]; // every station starts with it
+
+/**
+ * @brief Gives a station a MAC address of its own, in Espressif's range.
+ * @param station The station.
+ * @param index Its index in the fleet.
+ */
+static void assignMac(FleetStation &station, long index) {
+  snprintf(station.mac, sizeof(station.mac), "F0:9E:9E:%02X:%02X:%02X",
+           (unsigned)(index >> 16) & 0xFF, (unsigned)(index >> 8) & 0xFF,
+           (unsigned)index & 0xFF);
+}
+
+/**
+ * @brief Fills a batch with the readings a station sampled since its last
+ * uplink, oldest first.
+ * @param readings The batch, READING_BUFFER_FLUSH_COUNT readings.
+ * @param station The station.
+ * @param now Simulated s since the start.
+ * @return The wake clock the reading deltas count from.
+ */
+static uint32_t sample(PackedReading *readings, const FleetStation &station,
+                       double now) {
+  double wakeTime = uplinkTime / READING_BUFFER_FLUSH_COUNT;
+  double span = (READING_BUFFER_FLUSH_COUNT - 1) * wakeTime;
+  uint32_t epoch = now > span ? (uint32_t)(now - span) : 0;
+  ReadingBuffer::begin((uint32_t)now);
+  for (int i = 0; i < READING_BUFFER_FLUSH_COUNT; i++) {
+    double age = (READING_BUFFER_FLUSH_COUNT - 1 - i) * wakeTime;
+    double temperature, humidity;
+    NativeHal::conditions((now - age) / wakeTime, temperature, humidity);
+    SensorData sensorData = {};
+    sensorData.temperature = temperature;
+    sensorData.humidity = humidity;
+    sensorData.moisture = 40 + (station.uplinks % 20);
+    sensorData.batteryVoltage = 3.9;
+    uint32_t time = now > age ? (uint32_t)(now - age) : 0;
+    uint32_t delta = std::min<uint32_t>(time - epoch, UINT16_MAX);
+    readings[i] = ReadingRecord::pack(sensorData, delta);
+  }
+  return epoch;
+}
+
+/**
+ * @brief Runs one uplink wake of a station: sets its identity, sends its
+ * batch and closes the connection, as the TPL5110 would. The stand-ins'
+ * clock and counters start over, as for any wake.
+ * @param station The station, whose token is updated after a refresh.
+ * @param now Simulated s since the start.
+ * @return The UplinkOutcome.
+ */
+static uint8_t uplink(FleetStation &station, double now) {
+  NativeHal::beginWake(station.uplinks);
+  setenv("STACY_MAC", station.mac, 1);
+
+  // An expired token is sent with a broken signature, which the server
+  // rejects with the same 403
+  char token[CONFIG_TOKEN_SIZE];
+  snprintf(token, sizeof(token), "%s", station.token);
+  if (now >= station.tokenExpiry) {
+    char *signature = strrchr(token, '.');
+    char &broken = signature && signature[1] ? signature[1] : token[0];
+    broken = broken == 'A' ? 'B' : 'A';
+  }
+  DeviceConfig::setAccount(uid, token);
+
+  PackedReading readings[READING_BUFFER_FLUSH_COUNT];
+  uint32_t epoch = sample(readings, station, now);
+  WakeProfile profile = {};
+  profile.awake = FLEET_AWAKE;
+
+  UploadResult result = NetworkHandler::sendReadings(
+      readings, READING_BUFFER_FLUSH_COUNT, epoch, &profile);
+  NetworkHandler::closeConnection();
+  station.uplinks++;
+
+  const char *current = DeviceConfig::get().bearerToken;
+  bool refreshed = strcmp(current, token) != 0;
+  if (refreshed) {
+    snprintf(station.token, sizeof(station.token), "%s", current);
+    station.tokenExpiry = now + tokenLifetime;
+  }
+  if (result != UPLOAD_ACCEPTED)
+    return UPLINK_FAILED;
+  return refreshed ? UPLINK_REFRESHED : UPLINK_ACCEPTED;
+}
+
+/**
+ * @brief Creates a plant for a station, which the server needs before it
+ * refreshes the station's token.
+ * @param index The station's index in the fleet.
+ * @return True if the server returned a plant ID.
+ */
+static bool registerStation(long index) {
+  FleetStation station;
+  assignMac(station, index);
+  NativeHal::beginWake(0);
+  setenv("STACY_MAC", station.mac, 1);
+  DeviceConfig::setAccount(uid, accountToken);
+  DeviceConfig::setPlantId("");
+  NetworkHandler::createPlant(String("fleet-") + String(index));
+  NetworkHandler::closeConnection();
+  return DeviceConfig::get().plantId[0] != '\0';
+}
+
+/**
+ * @brief Runs the stations of one worker until the end of the run and
+ * writes the totals and samples to the parent.
+ * @param worker The worker index, which owns every workers-th station.
+ * @param output The pipe to the parent.
+ */
+static void runWorker(long worker, int output) {
+  std::mt19937 random(NativeHal::envLong("STACY_FLEET_SEED", 1) + worker);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<FleetStation> stations;
+  for (long index = worker; index < devices; index += workers) {
+    FleetStation station = {};
+    assignMac(station, index);
+    snprintf(station.token, sizeof(station.token), "%s", accountToken);
+    // Stations are at random points of their uplink and token cycles
+    station.nextUplink = unit(random) * uplinkTime;
+    station.tokenExpiry = unit(random) * tokenLifetime;
+    stations.push_back(station);
+  }
+
+  FleetTotals totals = {};
+  std::vector<FleetSample> samples;
+  samples.reserve(stations.size() *
+                  (size_t)(duration * speedup / uplinkTime + 1));
+  double end = duration * speedup;
+  while (!stations.empty()) {
+    FleetStation *station = &stations[0];
+    for (FleetStation &candidate : stations)
+      if (candidate.nextUplink < station->nextUplink)
+        station = &candidate;
+    if (station->nextUplink >= end)
+      break;
+
+    auto due = startTime + std::chrono::duration_cast<FleetClock::duration>(
+                               std::chrono::duration<double>(
+                                   station->nextUplink / speedup));
+    std::this_thread::sleep_until(due);
+    auto begin = FleetClock::now();
+    FleetSample sample;
+    sample.outcome = uplink(*station, station->nextUplink);
+    auto finished = FleetClock::now();
+    sample.latency =
+        std::chrono::duration_cast<std::chrono::microseconds>(finished - begin)
+            .count();
+    sample.lag =
+        std::chrono::duration_cast<std::chrono::microseconds>(begin - due)
+            .count();
+    samples.push_back(sample);
+    totals.httpRequests += NativeHal::stats.httpRequests;
+    totals.bytesSent += NativeHal::stats.bytesSent;
+    totals.bytesReceived += NativeHal::stats.bytesReceived;
+
+    double jitter = (unit(random) * 2 - 1) * FLEET_JITTER;
+    station->nextUplink += uplinkTime * (1 + jitter);
+  }
+
+  totals.samples = samples.size();
+  write(output, &totals, sizeof(totals));
+  write(output, samples.data(), samples.size() * sizeof(FleetSample));
+  close(output);
+}
+
+/**
+ * @brief Reads all of a worker's output.
+ * @param input The pipe from the worker.
+ * @param destination Where to read to.
+ * @param size The number of bytes to read.
+ * @return True if all of them came.
+ */
+static bool readAll(int input, void *destination, size_t size) {
+  uint8_t *bytes = (uint8_t *)destination;
+  while (size > 0) {
+    ssize_t length = read(input, bytes, size);
+    if (length <= 0)
+      return false;
+    bytes += length;
+    size -= length;
+  }
+  return true;
+}
+
+/**
+ * @brief Gets a percentile of sorted values, by nearest rank.
+ * @param values The values, in ascending order.
+ * @param percentile The percentile, 0 to 100.
+ * @return The value, in ms.
+ */
+static double percentile(const std::vector<uint32_t> &values,
+                         double percentile) {
+  if (values.empty())
+    return 0;
+  size_t rank = (size_t)(percentile / 100 * values.size() + 0.5);
+  return values[std::min(rank ? rank - 1 : 0, values.size() - 1)] / 1000.0;
+}
+
+/**
+ * @brief Prints the latency distribution of some uplinks.
+ * @param label What the uplinks are.
+ * @param values Their latencies, or lags, in us, sorted in place.
+ */
+static void printDistribution(const char *label,
+                              std::vector<uint32_t> &values) {
+  std::sort(values.begin(), values.end());
+  printf("%-22s %7zu %8.1f %8.1f %8.1f %8.1f\n", label, values.size(),
+         percentile(values, 50), percentile(values, 90),
+         percentile(values, 99), percentile(values, 100));
+}
+
+void setup() {
+  Logger::begin();
+  devices = NativeHal::envLong("STACY_FLEET_DEVICES", 1000);
+  workers = std::max(1L, std::min(NativeHal::envLong("STACY_FLEET_WORKERS", 16),
+                                  devices));
+  duration = NativeHal::envLong("STACY_FLEET_SECONDS", 60);
+  speedup = std::max(1L, NativeHal::envLong("STACY_FLEET_SPEEDUP", 1));
+  uplinkTime = 86400.0 * READING_BUFFER_FLUSH_COUNT /
+               NativeHal::envLong("STACY_WAKES_PER_DAY", FLEET_WAKES_PER_DAY);
+  tokenLifetime = NativeHal::envLong("STACY_FLEET_TOKEN_S", 86400);
+
+  DeviceConfig::begin();
+  NetworkHandler::connectToWiFi();
+  const char *email = NativeHal::envString("STACY_FLEET_EMAIL", "");
+  if (email[0] != '\0' &&
+      !NetworkHandler::loginUser(
+          email, NativeHal::envString("STACY_FLEET_PASSWORD", ""))) {
+    printf("Login as %s failed.\n", email);
+    NativeHal::powerOff();
+  }
+  NetworkHandler::closeConnection();
+  snprintf(uid, sizeof(uid), "%s", DeviceConfig::get().uid);
+  snprintf(accountToken, sizeof(accountToken), "%s",
+           DeviceConfig::get().bearerToken);
+
+  printf("%ld stations, %ld workers, %.0f s at %.0fx, uplink every %.0f s, "
+         "tokens valid %.0f s, server %s\n",
+         devices, workers, duration, speedup, uplinkTime, tokenLifetime,
+         SERVER_URL);
+  if (NativeHal::envLong("STACY_FLEET_REGISTER", 0)) {
+    long registered = 0;
+    for (long index = 0; index < devices; index++)
+      registered += registerStation(index);
+    printf("registered %ld of %ld stations\n", registered, devices);
+  }
+  fflush(stdout);
+
+  startTime = FleetClock::now();
+  std::vector<int> inputs;
+  for (long worker = 0; worker < workers; worker++) {
+    int pipeEnds[2];
+    if (pipe(pipeEnds) != 0) {
+      perror("pipe");
+      NativeHal::powerOff();
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(pipeEnds[0]);
+      for (int input : inputs)
+        close(input);
+      runWorker(worker, pipeEnds[1]);
+      _exit(0);
+    }
+    close(pipeEnds[1]);
+    inputs.push_back(pipeEnds[0]);
+  }
+
+  FleetTotals fleet = {};
+  std::vector<uint32_t> latencies[3];
+  std::vector<uint32_t> lags;
+  for (int input : inputs) {
+    FleetTotals totals;
+    std::vector<FleetSample> samples;
+    if (readAll(input, &totals, sizeof(totals))) {
+      samples.resize(totals.samples);
+      if (!readAll(input, samples.data(),
+                   samples.size() * sizeof(FleetSample)))
+        samples.clear();
+      fleet.httpRequests += totals.httpRequests;
+      fleet.bytesSent += totals.bytesSent;
+      fleet.bytesReceived += totals.bytesReceived;
+    }
+    close(input);
+    for (const FleetSample &sample : samples) {
+      latencies[std::min(sample.outcome, (uint8_t)UPLINK_FAILED)].push_back(
+          sample.latency);
+      lags.push_back(sample.lag);
+    }
+  }
+  while (wait(nullptr) > 0) {
+  }
+  double elapsed =
+      std::chrono::duration<double>(FleetClock::now() - startTime).count();
+
+  std::vector<uint32_t> all;
+  for (const std::vector<uint32_t> &outcome : latencies)
+    all.insert(all.end(), outcome.begin(), outcome.end());
+  size_t uplinks = all.size();
+  size_t accepted = latencies[UPLINK_ACCEPTED].size() +
+                    latencies[UPLINK_REFRESHED].size();
+
+  printf("uplinks %zu, accepted %zu, refreshed %zu, failed %zu in %.1f s\n",
+         uplinks, accepted, latencies[UPLINK_REFRESHED].size(),
+         latencies[UPLINK_FAILED].size(), elapsed);
+  printf("throughput: %.1f uplinks/s, %.1f requests/s, %.1f readings/s, "
+         "%.1f kB/s sent, %.1f kB/s received\n",
+         uplinks / elapsed, fleet.httpRequests / elapsed,
+         accepted * READING_BUFFER_FLUSH_COUNT / elapsed,
+         fleet.bytesSent / elapsed / 1000,
+         fleet.bytesReceived / elapsed / 1000);
+  printf("\n%-22s %7s %8s %8s %8s %8s\n", "latency (ms)", "count", "p50",
+         "p90", "p99", "max");
+  printDistribution("all uplinks", all);
+  printDistribution("accepted", latencies[UPLINK_ACCEPTED]);
+  printDistribution("refreshed", latencies[UPLINK_REFRESHED]);
+  printDistribution("failed", latencies[UPLINK_FAILED]);
+  printDistribution("behind schedule", lags);
+  NativeHal::powerOff();
+}
+
+void loop() {}
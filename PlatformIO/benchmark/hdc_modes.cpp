@@ -0,0 +1,95 @@
+// Native benchmark of the HDC3022 acquisition modes: latency, charge and
+// temperature noise of an on-demand conversion at LP0 to LP3, and of
+// reading back an auto-measurement with its min/max history. Run with
+//   pio run -e native-hdc-benchmark -t exec
+#include "configuration.h"
+#include <Adafruit_HDC302x.h>
+#include <Arduino.h>
+#include <EnergyModel.h>
+#include <Wire.h>
+
+#define TRIALS 200
+
+typedef struct ModeResult {
+  float latency;   // us
+  float charge;    // nAh
+  float deviation; // °C
+} ModeResult;
+
+static Adafruit_HDC302x hdc;
+
+/**
+ * @brief Reads a history register the way Hdc3022Sensor does.
+ */
+static void readHistoryRegister(uint16_t command) {
+  Wire.beginTransmission(HDC3022_ADDR);
+  Wire.write(command >> 8);
+  Wire.write(command & 0xFF);
+  Wire.endTransmission();
+  Wire.requestFrom(HDC3022_ADDR, 3);
+  while (Wire.available())
+    Wire.read();
+}
+
+/**
+ * @brief Measures one acquisition path.
+ * @param mode The trigger mode, or 0 to read back an auto-measurement.
+ */
+static ModeResult measure(uint16_t mode) {
+  static double temperatures[TRIALS];
+  unsigned long elapsed = 0;
+  double charge = 0;
+  double sum = 0;
+
+  for (int i = 0; i < TRIALS; i++) {
+    double humidity;
+    unsigned long start = micros();
+    double startCharge = EnergyModel::charged();
+    if (mode) {
+      hdc.readTemperatureHumidityOnDemand(temperatures[i], humidity,
+                                          (hdcTriggerMode)mode);
+    } else {
+      hdc.readAutoTempRH(temperatures[i], humidity);
+      for (uint16_t command = 0xE002; command <= 0xE005; command++)
+        readHistoryRegister(command);
+    }
+    charge += EnergyModel::charged() - startCharge;
+    elapsed += micros() - start;
+    sum += temperatures[i];
+  }
+
+  double mean = sum / TRIALS;
+  double variance = 0;
+  for (int i = 0; i < TRIALS; i++)
+    variance += (temperatures[i] - mean) * (temperatures[i] - mean);
+
+  ModeResult result;
+  result.latency = (float)elapsed / TRIALS;
+  result.charge = charge * 1000 / TRIALS;
+  result.deviation = sqrt(variance / TRIALS);
+  return result;
+}
+
+void setup() {
+  static const hdcTriggerMode modes[] = {TRIGGERMODE_LP0, TRIGGERMODE_LP1,
+                                         TRIGGERMODE_LP2, TRIGGERMODE_LP3};
+
+  Wire.begin();
+  hdc.begin(HDC3022_ADDR);
+  printf("mode            latency (us)  charge (nAh)  stddev (C)\n");
+  for (int level = 0; level < 4; level++) {
+    ModeResult result = measure(modes[level]);
+    printf("on-demand LP%d %14.0f %13.3f %11.4f\n", level, result.latency,
+           result.charge, result.deviation);
+  }
+
+  hdc.setAutoMode(AUTO_MEASUREMENT_0_5MPS_LP0);
+  ModeResult result = measure(0);
+  printf("auto LP0 + min/max %9.0f %13.3f %11.4f\n", result.latency,
+         result.charge, result.deviation);
+  printf("Charge includes the CPU waiting; the sensor's own current while\n"
+         "measuring in auto mode between wakes is not modelled.\n");
+  NativeHal::powerOff();
+}
+
+void loop() {}
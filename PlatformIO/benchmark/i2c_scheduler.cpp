@@ -0,0 +1,127 @@
+// Native benchmark of I2cScheduler on a simulated bus: sensors that NACK
+// reads until their conversion is done, read one after the other
+// (trigger, wait, read) and then with every conversion overlapped. Run with
+//   pio run -e native-i2c-benchmark -t exec
+// STACY_I2C_LATENCIES lists the conversion time of each simulated device in
+// µs (default "12500,9300,5000"), STACY_I2C_HZ sets the bus clock.
+#include "i2c_scheduler.h"
+#include <Arduino.h>
+#include <EnergyModel.h>
+#include <Wire.h>
+#include <vector>
+
+#define FIRST_ADDRESS 0x50
+#define RESULT_BYTES 6
+#define TRIALS 100
+
+// A device that converts for a fixed time after any write, NACKs reads
+// until then, and then returns RESULT_BYTES bytes.
+class ConversionDevice : public NativeI2cDevice {
+private:
+  uint32_t latency;
+  uint64_t readyAt = 0;
+
+public:
+  explicit ConversionDevice(uint32_t latency) : latency(latency) {}
+
+  bool receive(const uint8_t *data, size_t size) override {
+    readyAt = NativeHal::micros() + latency;
+    return true;
+  }
+
+  size_t respond(uint8_t *data, size_t size) override {
+    if (NativeHal::micros() < readyAt)
+      return 0;
+    memset(data, 0xA5, size);
+    return size;
+  }
+};
+
+static std::vector<uint32_t> latencies;
+
+/**
+ * @brief Samples every device.
+ * @param overlapped True to trigger them all before waiting, false to
+ * trigger, wait for and read each in turn.
+ * @return True if every device was read.
+ */
+static bool sampleAll(bool overlapped) {
+  uint8_t data[RESULT_BYTES];
+  bool sampled = true;
+  for (size_t i = 0; i < latencies.size(); i++) {
+    I2cScheduler::command(FIRST_ADDRESS + i, 0x2400);
+    I2cScheduler::expect(latencies[i]);
+    if (!overlapped) {
+      I2cScheduler::waitForConversions();
+      sampled = I2cScheduler::read(FIRST_ADDRESS + i, data, sizeof(data)) &&
+                sampled;
+    }
+  }
+  if (overlapped) {
+    I2cScheduler::waitForConversions();
+    for (size_t i = 0; i < latencies.size(); i++) {
+      sampled = I2cScheduler::read(FIRST_ADDRESS + i, data, sizeof(data)) &&
+                sampled;
+    }
+  }
+  return sampled;
+}
+
+/**
+ * @brief Measures one way of sampling the devices.
+ * @param overlapped See sampleAll().
+ * @param charge Set to the mean charge in nAh.
+ * @return The mean time in microseconds.
+ */
+static float measure(bool overlapped, float &charge) {
+  unsigned long elapsed = 0;
+  double total = 0;
+  bool sampled = true;
+  for (int i = 0; i < TRIALS; i++) {
+    unsigned long start = micros();
+    double startCharge = EnergyModel::charged();
+    sampled = sampleAll(overlapped) && sampled;
+    total += EnergyModel::charged() - startCharge;
+    elapsed += micros() - start;
+  }
+  if (!sampled)
+    printf("Some reads failed.\n");
+  charge = total * 1000 / TRIALS;
+  return (float)elapsed / TRIALS;
+}
+
+void setup() {
+  String list = NativeHal::envString("STACY_I2C_LATENCIES", "12500,9300,5000");
+  const char *cursor = list.c_str();
+  while (*cursor) {
+    char *end;
+    latencies.push_back(strtoul(cursor, &end, 10));
+    cursor = *end ? end + 1 : end;
+  }
+  Wire.begin(-1, -1, NativeHal::envLong("STACY_I2C_HZ", 100000));
+  for (size_t i = 0; i < latencies.size(); i++) {
+    TwoWire::attach(FIRST_ADDRESS + i, new ConversionDevice(latencies[i]));
+  }
+
+  float sequentialCharge, overlappedCharge;
+  float sequential = measure(false, sequentialCharge);
+  float overlapped = measure(true, overlappedCharge);
+  printf("%zu devices      time (us)  charge (nAh)\n", latencies.size());
+  printf("sequential %14.0f %13.3f\n", sequential, sequentialCharge);
+  printf("overlapped %14.0f %13.3f\n", overlapped, overlappedCharge);
+
+  for (int overlappedPass = 0; overlappedPass < 2; overlappedPass++) {
+    I2cScheduler::reset();
+    sampleAll(overlappedPass);
+    printf("\n%s pass (us):\n", overlappedPass ? "Overlapped" : "Sequential");
+    for (size_t i = 0; i < I2cScheduler::transactions(); i++) {
+      const I2cTransaction &entry = I2cScheduler::transaction(i);
+      printf("%8u  0x%02x %-5s %u B %6u%s\n", entry.start, entry.address,
+             entry.read ? "read" : "write", entry.size, entry.duration,
+             entry.acknowledged ? "" : "  NACK");
+    }
+  }
+  NativeHal::powerOff();
+}
+
+void loop() {}
@@ -0,0 +1,98 @@
+// Native benchmark of the logger: host time and heap allocations of one
+// record logged the way DEBUGLN did, by concatenating Strings and printing
+// them, then through the LOG_* macros to the serial port, to the serial port
+// and the crash ring, and at a level compiled out. Run with
+//   pio run -e native-logger-benchmark -t exec
+// The environment builds with LOG_LEVEL_INFO, so LOG_DEBUG is compiled out.
+#include "configuration.h"
+#include "logger.h"
+#include <Arduino.h>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define LOG_LOOPS 200000
+
+static unsigned long evaluations = 0;
+
+// An argument with a side effect, to see whether it is evaluated
+__attribute__((noinline)) static unsigned long counted(unsigned long value) {
+  evaluations++;
+  return value;
+}
+
+/**
+ * @brief Times a logging statement on the host, with the serial port going
+ * to /dev/null.
+ * @param allocations Set to the heap allocations per record.
+ * @return The mean time of one record, in nanoseconds.
+ */
+template <typename Statement>
+static double hostTime(Statement statement, double &allocations) {
+  fflush(stdout);
+  int console = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+
+  uint32_t startAllocations = NativeHal::stats.allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < LOG_LOOPS; i++)
+    statement(i);
+  fflush(stdout);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  allocations =
+      (double)(NativeHal::stats.allocations - startAllocations) / LOG_LOOPS;
+
+  dup2(console, STDOUT_FILENO);
+  close(console);
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         LOG_LOOPS;
+}
+
+void setup() {
+  Logger::begin();
+  double allocations[4];
+  double times[4];
+
+  times[0] = hostTime(
+      [](unsigned long i) {
+        Serial.println("Queued " + String(counted(i)) + " readings in flash, " +
+                       String(i * 2) + " waiting.");
+      },
+      allocations[0]);
+  times[1] = hostTime(
+      [](unsigned long i) {
+        LOG_INFO("Queued %lu readings in flash, %lu waiting.", counted(i),
+                 i * 2);
+      },
+      allocations[1]);
+  times[2] = hostTime(
+      [](unsigned long i) {
+        LOG_WARN("Queued %lu readings in flash, %lu waiting.", counted(i),
+                 i * 2);
+      },
+      allocations[2]);
+  unsigned long before = evaluations;
+  times[3] = hostTime(
+      [](unsigned long i) {
+        LOG_DEBUG("Queued %lu readings in flash, %lu waiting.", counted(i),
+                  i * 2);
+      },
+      allocations[3]);
+
+  printf("one record, %d loops       host time (ns)  allocations\n",
+         LOG_LOOPS);
+  printf("String concatenation %19.1f %12.1f\n", times[0], allocations[0]);
+  printf("LOG_INFO, serial %23.1f %12.1f\n", times[1], allocations[1]);
+  printf("LOG_WARN, serial and ring %14.1f %12.1f\n", times[2],
+         allocations[2]);
+  printf("LOG_DEBUG, compiled out %16.1f %12.1f\n", times[3], allocations[3]);
+  printf("arguments evaluated when compiled out: %lu\n",
+         evaluations - before);
+  printf("\n");
+  Logger::dumpRing(Serial);
+  NativeHal::powerOff();
+}
+
+void loop() {}
@@ -0,0 +1,150 @@
+// Native benchmark of the sensor registry: the host time the sampling loop
+// spends dispatching to drivers, through SensorRegistry, through hand-written
+// calls and through a virtual interface, then the simulated time and charge
+// of SensorHandler::readSensorData with the sensors of this build. Run with
+//   pio run -e native-sensor-benchmark -t exec
+// STACY_BME280=1 fits the BME280 stand-in when SENSOR_BME280 is enabled.
+#include "configuration.h"
+#include "sensor_handler.h"
+#include <Arduino.h>
+#include <EnergyModel.h>
+#include <chrono>
+#include <vector>
+
+#define DISPATCH_LOOPS 10000000
+#define TRIALS 200
+
+// Drivers with a trivial, out-of-line body, so that only the way they are
+// called differs between the loops
+class FirstDriver {
+public:
+  __attribute__((noinline)) static bool begin() { return true; }
+  __attribute__((noinline)) static bool trigger(SensorData &sensorData) {
+    sensorData.temperature += 1;
+    return true;
+  }
+  __attribute__((noinline)) static bool collect(SensorData &sensorData) {
+    return true;
+  }
+};
+
+class SecondDriver {
+public:
+  __attribute__((noinline)) static bool begin() { return true; }
+  __attribute__((noinline)) static bool trigger(SensorData &sensorData) {
+    sensorData.humidity += 1;
+    return true;
+  }
+  __attribute__((noinline)) static bool collect(SensorData &sensorData) {
+    return true;
+  }
+};
+
+class ThirdDriver {
+public:
+  __attribute__((noinline)) static bool begin() { return true; }
+  __attribute__((noinline)) static bool trigger(SensorData &sensorData) {
+    sensorData.moisture += 1;
+    return true;
+  }
+  __attribute__((noinline)) static bool collect(SensorData &sensorData) {
+    return true;
+  }
+};
+
+typedef SensorRegistry<FirstDriver, SensorIf<SecondDriver, false>::type,
+                       SecondDriver, ThirdDriver>
+    BenchmarkSensors;
+
+// The run-time alternative: one object per driver behind an interface
+class VirtualDriver {
+public:
+  virtual ~VirtualDriver() {}
+  virtual bool begin() = 0;
+  virtual bool trigger(SensorData &sensorData) = 0;
+  virtual bool collect(SensorData &sensorData) = 0;
+};
+
+template <typename Driver> class VirtualAdapter : public VirtualDriver {
+public:
+  bool begin() override { return Driver::begin(); }
+  bool trigger(SensorData &sensorData) override {
+    return Driver::trigger(sensorData);
+  }
+  bool collect(SensorData &sensorData) override {
+    return Driver::collect(sensorData);
+  }
+};
+
+/**
+ * @brief Times a sampling loop on the host.
+ * @return The mean time of one pass over the drivers, in nanoseconds.
+ */
+template <typename Loop> static double hostTime(Loop loop) {
+  SensorData data;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < DISPATCH_LOOPS; i++)
+    loop(data);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  // Keeps the loop from being optimized out
+  if (data.temperature < 0)
+    printf("unreachable\n");
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         DISPATCH_LOOPS;
+}
+
+void setup() {
+  std::vector<VirtualDriver *> drivers = {new VirtualAdapter<FirstDriver>,
+                                          new VirtualAdapter<SecondDriver>,
+                                          new VirtualAdapter<ThirdDriver>};
+
+  double registry = hostTime(
+      [](SensorData &data) { return BenchmarkSensors::sample(data); });
+  double direct = hostTime([](SensorData &data) {
+    bool first = FirstDriver::begin() && FirstDriver::trigger(data);
+    bool second = SecondDriver::begin() && SecondDriver::trigger(data);
+    bool third = ThirdDriver::begin() && ThirdDriver::trigger(data);
+    I2cScheduler::waitForConversions();
+    first = first && FirstDriver::collect(data);
+    second = second && SecondDriver::collect(data);
+    third = third && ThirdDriver::collect(data);
+    return first && second && third;
+  });
+  double dispatched = hostTime([&drivers](SensorData &data) {
+    bool started[3];
+    for (size_t i = 0; i < drivers.size(); i++)
+      started[i] = drivers[i]->begin() && drivers[i]->trigger(data);
+    I2cScheduler::waitForConversions();
+    bool sampled = true;
+    for (size_t i = 0; i < drivers.size(); i++)
+      sampled = started[i] && drivers[i]->collect(data) && sampled;
+    return sampled;
+  });
+  printf("dispatch of 3 drivers (+1 disabled)  host time (ns/pass)\n");
+  printf("SensorRegistry %36.2f\n", registry);
+  printf("hand-written calls %32.2f\n", direct);
+  printf("virtual interface %33.2f\n", dispatched);
+  for (VirtualDriver *driver : drivers)
+    delete driver;
+
+  unsigned long elapsed = 0;
+  double charge = 0;
+  bool sampled = true;
+  for (int i = 0; i < TRIALS; i++) {
+    SensorData data;
+    data.batteryPercentage = 100;
+    unsigned long start = micros();
+    double startCharge = EnergyModel::charged();
+    sampled = SensorHandler::readSensorData(data) && sampled;
+    charge += EnergyModel::charged() - startCharge;
+    elapsed += micros() - start;
+  }
+  printf("\nsensors: HDC3022 %s, BME280 %s, moisture %s%s\n",
+         SENSOR_HDC3022 ? "on" : "off", SENSOR_BME280 ? "on" : "off",
+         SENSOR_MOISTURE ? "on" : "off", sampled ? "" : " (failures)");
+  printf("readSensorData: %.0f us, %.3f nAh per wake (simulated)\n",
+         (float)elapsed / TRIALS, charge * 1000 / TRIALS);
+  NativeHal::powerOff();
+}
+
+void loop() {}
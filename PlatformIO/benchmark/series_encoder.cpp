@@ -0,0 +1,273 @@
+// Benchmark of SeriesEncoder: the size of a batch as a series against the
+// fixed 12-byte records of telemetry version 3, in both SeriesModes and
+// for batches of READING_BUFFER_FLUSH_COUNT and READING_BUFFER_CAPACITY
+// readings, then the cost of encoding one reading. Every batch is decoded
+// back and compared. The series are synthetic, a day of readings every
+// SERIES_WAKE_S, and on the host also the STACY_TRACE replay file when one
+// is given. Run on the host with
+//   STACY_TRACE=trace.csv pio run -e native-series-benchmark -t exec
+// or on the board with
+//   pio run -e main-series-benchmark -t upload -t monitor
+// which counts CPU cycles.
+#include "adc_sampler.h"
+#include "configuration.h"
+#include "reading_record.h"
+#include "series_encoder.h"
+#include "telemetry_encoder.h"
+#include <Arduino.h>
+#include <math.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#define SERIES_LOOPS 4
+#define SERIES_UNIT "cycles"
+#else
+#include <chrono>
+#define SERIES_LOOPS 200
+#define SERIES_UNIT "host ns"
+#endif
+
+#define SERIES_WAKE_S 300
+#define SERIES_READINGS (86400 / SERIES_WAKE_S)
+#define SERIES_HEADER_SIZE 6 // version, count and epoch age
+
+typedef enum {
+  SERIES_STEADY,    // daily cycle with sensor noise
+  SERIES_NOISY,     // the same with five times the noise
+  SERIES_ON_CHANGE, // steady, thinned by the ReportPolicy deadbands
+  SERIES_RECORDED,  // STACY_TRACE, host only
+  SERIES_KINDS
+} SeriesKind;
+
+static const char *const kindNames[SERIES_KINDS] = {"steady", "noisy",
+                                                    "send-on-change",
+                                                    "recorded"};
+
+// Readings of a day, with their time in s since its start
+static PackedReading readings[SERIES_READINGS];
+static uint32_t times[SERIES_READINGS];
+static uint8_t encoded[1 + READING_BUFFER_CAPACITY * SERIES_MAX_READING_SIZE];
+static uint32_t noiseState = 1;
+
+/**
+ * @brief Sensor noise, roughly normal: the sum of four xorshift draws.
+ * @param deviation The standard deviation.
+ */
+static float noise(float deviation) {
+  float sum = 0;
+  for (int i = 0; i < 4; i++) {
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    sum += (noiseState & 0xFFFF) / 65535.0f - 0.5f;
+  }
+  return sum * deviation * 1.73f; // four uniforms have a deviation of 0.58
+}
+
+/**
+ * @brief Fills the day with a series.
+ * @return The number of readings, 0 if the series is not available.
+ */
+static size_t fill(SeriesKind kind) {
+  noiseState = 1;
+  float scale = kind == SERIES_NOISY ? 5.0f : 1.0f;
+  SensorData reported = {};
+  uint32_t reportedTime = 0;
+  size_t count = 0;
+
+  for (int wake = 0; wake < SERIES_READINGS; wake++) {
+    SensorData sensorData = {};
+    if (kind == SERIES_RECORDED) {
+#ifdef ARDUINO_ARCH_ESP32
+      return 0;
+#else
+      double temperature, humidity, moistureMv, batteryMv;
+      if (!NativeHal::traceValue(TRACE_TEMPERATURE, temperature, wake) ||
+          !NativeHal::traceValue(TRACE_HUMIDITY, humidity, wake) ||
+          !NativeHal::traceValue(TRACE_MOISTURE_MV, moistureMv, wake) ||
+          !NativeHal::traceValue(TRACE_BATTERY_MV, batteryMv, wake))
+        return 0;
+      sensorData.temperature = temperature;
+      sensorData.humidity = humidity;
+      sensorData.moisture = AdcSampler::mapClamped(
+          moistureMv, AIR_VALUE_MV, WATER_VALUE_MV, 0.0, 100.0);
+      sensorData.batteryVoltage = batteryMv / 1000.0;
+#endif
+    } else {
+      float phase = 2 * M_PI * wake / SERIES_READINGS;
+      sensorData.temperature = 22 + 3 * sinf(phase) + noise(0.05f * scale);
+      sensorData.humidity = 45 - 8 * sinf(phase) + noise(0.2f * scale);
+      sensorData.moisture =
+          60 - 20.0f * wake / SERIES_READINGS + noise(0.3f * scale);
+      sensorData.batteryVoltage =
+          3.7f - 0.024f * wake / SERIES_READINGS + noise(0.003f * scale);
+    }
+
+    uint32_t time = wake * SERIES_WAKE_S;
+    if (kind == SERIES_ON_CHANGE && count > 0 &&
+        time - reportedTime < REPORT_HEARTBEAT_S &&
+        fabsf(sensorData.temperature - reported.temperature) <
+            REPORT_DEADBAND_TEMPERATURE &&
+        fabsf(sensorData.humidity - reported.humidity) <
+            REPORT_DEADBAND_HUMIDITY &&
+        fabsf(sensorData.moisture - reported.moisture) <
+            REPORT_DEADBAND_MOISTURE)
+      continue;
+    reported = sensorData;
+    reportedTime = time;
+    times[count] = time;
+    readings[count++] = ReadingRecord::pack(sensorData, 0);
+  }
+  return count;
+}
+
+/**
+ * @brief Reads a varint the way the backend does.
+ */
+static uint32_t readVarint(const uint8_t *&cursor) {
+  uint32_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t byte = *cursor++;
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/**
+ * @brief Decodes a series and compares it with the readings it came from.
+ * @return True if every field matches.
+ */
+static bool roundTrip(const PackedReading *batch, size_t count,
+                      SeriesMode mode, size_t length) {
+  const uint8_t *cursor = encoded;
+  uint8_t version = readVarint(cursor);
+  uint16_t values[SERIES_VALUES] = {};
+  uint8_t flags = 0;
+  int32_t time = 0;
+  int32_t step = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t timing = readVarint(cursor);
+    if (timing & 1)
+      flags = readVarint(cursor);
+    step += unzigzag(timing >> 1);
+    time += step;
+    for (int j = 0; j < SERIES_VALUES; j++) {
+      uint32_t coded = readVarint(cursor);
+      values[j] = mode == SERIES_XOR ? values[j] ^ coded
+                                     : values[j] + unzigzag(coded);
+    }
+    const PackedReading &reading = batch[i];
+    if (version != reading.version || flags != reading.flags ||
+        time != reading.delta || (int16_t)values[0] != reading.temperature ||
+        values[1] != reading.humidity || values[2] != reading.moisture ||
+        values[3] != reading.batteryVoltage)
+      return false;
+  }
+  return cursor == encoded + length;
+}
+
+/**
+ * @brief Encodes the day in batches, as the uplinks would send it.
+ * @param count The number of readings of the day.
+ * @param batchSize The readings per batch.
+ * @param mode The SeriesMode.
+ * @param ok Cleared if a batch does not decode back.
+ * @return The size of the series of every batch, headers included.
+ */
+static size_t encodeDay(size_t count, size_t batchSize, SeriesMode mode,
+                        bool &ok) {
+  size_t total = 0;
+  for (size_t start = 0; start < count; start += batchSize) {
+    size_t size = min(batchSize, count - start);
+    PackedReading *batch = readings + start;
+    for (size_t i = 0; i < size; i++) {
+      batch[i].delta = times[start + i] - times[start];
+    }
+    SeriesEncoder series(encoded, sizeof(encoded), mode);
+    for (size_t i = 0; i < size; i++) {
+      series.add(batch[i]);
+    }
+    ok = ok && !series.overflowed() &&
+         roundTrip(batch, size, mode, series.size());
+    total += SERIES_HEADER_SIZE + 1 + series.size();
+  }
+  return total;
+}
+
+/**
+ * @brief Times the encoding of the day in batches of the buffer capacity.
+ * @return The mean cost of a reading, in SERIES_UNIT.
+ */
+static double cost(size_t count, SeriesMode mode) {
+#ifdef ARDUINO_ARCH_ESP32
+  uint32_t start = ESP.getCycleCount();
+#else
+  auto start = std::chrono::steady_clock::now();
+#endif
+  for (int loop = 0; loop < SERIES_LOOPS; loop++) {
+    for (size_t first = 0; first < count; first += READING_BUFFER_CAPACITY) {
+      size_t size = min((size_t)READING_BUFFER_CAPACITY, count - first);
+      SeriesEncoder series(encoded, sizeof(encoded), mode);
+      for (size_t i = 0; i < size; i++) {
+        series.add(readings[first + i]);
+      }
+    }
+  }
+#ifdef ARDUINO_ARCH_ESP32
+  double elapsed = (uint32_t)(ESP.getCycleCount() - start);
+#else
+  double elapsed = std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+#endif
+  return elapsed / ((double)SERIES_LOOPS * count);
+}
+
+void setup() {
+  Serial.begin(115200);
+#ifdef ARDUINO_ARCH_ESP32
+  while (!Serial)
+    delay(10);
+  delay(DELAY_SHORT);
+#endif
+
+  const size_t batchSizes[] = {READING_BUFFER_FLUSH_COUNT,
+                               READING_BUFFER_CAPACITY};
+  Serial.printf("%-15s %5s %6s %8s %14s %14s %9s %9s\n", "series",
+                "batch", "count", "records", "delta", "xor",
+                "delta/rd", "xor/rd");
+  for (int kind = 0; kind < SERIES_KINDS; kind++) {
+    size_t count = fill((SeriesKind)kind);
+    if (count == 0) {
+      Serial.printf("%-15s not available\n", kindNames[kind]);
+      continue;
+    }
+    for (size_t batchSize : batchSizes) {
+      size_t batches = (count + batchSize - 1) / batchSize;
+      size_t records =
+          batches * SERIES_HEADER_SIZE + count * TELEMETRY_READING_SIZE;
+      bool ok = true;
+      size_t delta = encodeDay(count, batchSize, SERIES_DELTA, ok);
+      size_t xorSize = encodeDay(count, batchSize, SERIES_XOR, ok);
+      Serial.printf("%-15s %5zu %6zu %8zu %6zu (%4.2fx) %6zu (%4.2fx) "
+                    "%9.1f %9.1f%s\n",
+                    kindNames[kind], batchSize, count, records, delta,
+                    (double)records / delta, xorSize,
+                    (double)records / xorSize, (double)delta / count,
+                    (double)xorSize / count,
+                    ok ? "" : "  ROUND TRIP FAILED");
+    }
+    Serial.printf("%-15s encode per reading (%s): delta %.1f, xor %.1f\n",
+                  "", SERIES_UNIT, cost(count, SERIES_DELTA),
+                  cost(count, SERIES_XOR));
+  }
+#ifndef ARDUINO_ARCH_ESP32
+  NativeHal::powerOff();
+#endif
+}
+
+void loop() {}
@@ -0,0 +1,46 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include "configuration.h"
+#include <Arduino.h>
+
+#define ADC_MAX_SAMPLES 64
+// Pins converted by the continuous driver, moisture first
+#define ADC_CONTINUOUS_PINS 2
+
+typedef enum {
+  ADC_FILTER_MEAN,
+  ADC_FILTER_MEDIAN,
+  ADC_FILTER_TRIMMED_MEAN, // mean without the `trim` lowest and highest
+} AdcFilter;
+
+typedef struct AdcSamplerConfig {
+  uint8_t samples;
+  AdcFilter filter;
+  uint8_t trim;
+  bool calibrated; // analogReadMilliVolts() instead of raw counts
+} AdcSamplerConfig;
+
+// Oversampled ADC reads with outlier rejection, shared by the moisture
+// sensor and the battery monitor. With ADC_CONTINUOUS, both pins are
+// converted by the DMA driver in the background from beginContinuous(),
+// and read() filters those samples instead of blocking on one-shot reads.
+class AdcSampler {
+private:
+  static bool continuousRunning;
+  static uint16_t continuousSamples[ADC_CONTINUOUS_PINS][ADC_MAX_SAMPLES];
+  static size_t continuousCount[ADC_CONTINUOUS_PINS];
+  static void collectContinuous();
+  static int continuousIndex(uint8_t pin);
+  static void sort(uint16_t *samples, size_t count);
+  static float reduce(uint16_t *samples, size_t count,
+                      const AdcSamplerConfig &config);
+
+public:
+  static bool beginContinuous();
+  static float read(uint8_t pin, const AdcSamplerConfig &config);
+  static float mapClamped(float value, float fromLow, float fromHigh,
+                          float toLow, float toHigh);
+};
+
+#endif
@@ -7,9 +7,9 @@
 class BatteryMonitor {
 private:
   static float readBatteryVoltage();
-  static float calculateBatteryPercentage(float voltage);
 
 public:
+  static float calculateBatteryPercentage(float voltage);
   static void getBatteryStatus(SensorData &sensorData);
 };
 
@@ -0,0 +1,18 @@
+#ifndef BME280_SENSOR_H
+#define BME280_SENSOR_H
+
+#include "configuration.h"
+#include <BME280I2C.h>
+
+// Temperature and humidity from a BME280, see SensorRegistry.
+class Bme280Sensor {
+private:
+  static BME280I2C bme280;
+
+public:
+  static bool begin();
+  static bool trigger(SensorData &sensorData);
+  static bool collect(SensorData &sensorData);
+};
+
+#endif
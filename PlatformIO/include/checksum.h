@@ -0,0 +1,12 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <Arduino.h>
+
+// Integrity checks for what is kept in flash.
+class Checksum {
+public:
+  static uint32_t crc32(const uint8_t *data, size_t size);
+};
+
+#endif
@@ -1,24 +1,68 @@
 #ifndef CONFIGURATION_H
 #define CONFIGURATION_H
 
-#include <EnvironmentCalculations.h>
-
 // Battery
 #define BATTERY_PIN A1
 #define BATTERY_MAX 3.8
 #define BATTERY_MIN 3.0
+// Charge delivered between BATTERY_MAX and BATTERY_MIN
+#define BATTERY_CAPACITY_MAH 1000
+
+// Sensor drivers built into the firmware, see SensorRegistry
+#define SENSOR_HDC3022 true
+#define SENSOR_BME280 false
+#define SENSOR_MOISTURE true
 
 // HDC3022
 #define HDC3022_ADDR 0x44
+// Required temperature repeatability, selects the cheapest of LP0 to LP3
+#define HDC_PRECISION_C 0.01
+// Auto-measurement needs the sensor powered between wakes, which the
+// TPL5110 does not do
+#define HDC_AUTO_MODE false
 
 // Capacitance
 #define CAPACITANCE_PIN A2
 #define AIR_VALUE 3725
 #define WATER_VALUE 2125
+// The same calibration points in mV, used with MOISTURE_CALIBRATED
+#define AIR_VALUE_MV 2820
+#define WATER_VALUE_MV 1609
+
+// ADC oversampling, see AdcSampler
+#define MOISTURE_SAMPLES 16
+#define MOISTURE_FILTER ADC_FILTER_TRIMMED_MEAN
+#define MOISTURE_TRIM 3
+#define MOISTURE_CALIBRATED false
+#define BATTERY_SAMPLES 16
+#define BATTERY_FILTER ADC_FILTER_TRIMMED_MEAN
+#define BATTERY_TRIM 3
+// Continuous (DMA) conversion of both pins while Wi-Fi associates and the
+// I2C sensors convert
+#define ADC_CONTINUOUS true
+#define ADC_CONTINUOUS_SAMPLES 16 // per pin, at least *_SAMPLES
+#define ADC_CONTINUOUS_FREQ_HZ 20000
+#define ADC_CONTINUOUS_TIMEOUT_MS 20
 
 // I2C
 #define I2C_SDA_PIN 8
 #define I2C_SCL_PIN 9
+// Reads NACKed while a conversion is still running are retried
+#define I2C_READ_RETRIES 4
+#define I2C_RETRY_US 500
+#define I2C_LOG_SIZE 16 // transactions timed per wake, see I2cScheduler
+
+// Power between wakes, see PowerManager. POWER_TPL5110 cuts power through
+// the TPL5110, POWER_DEEP_SLEEP is for boards without one: the ESP32-C3
+// sleeps with a timer wake and keeps RTC memory, so the reading buffer and
+// report policy state need no NVS writes, but a reset or a battery change
+// loses them.
+#define POWER_TPL5110 0
+#define POWER_DEEP_SLEEP 1
+#ifndef POWER_BACKEND
+#define POWER_BACKEND POWER_TPL5110
+#endif
+#define POWER_RETAINS_RTC (POWER_BACKEND == POWER_DEEP_SLEEP)
 
 // TPL5110
 #define TPL5110_DONE_PIN 10
@@ -36,17 +80,78 @@
 #define AP_SSID "PlantStation"
 #define DNS_PORT 53
 
-// EnvironmentCalculations settings
-#define ENV_TEMP_UNIT EnvironmentCalculations::TempUnit_Celsius
+// Device configuration (NVS), field sizes including the terminating NUL
+#define CONFIG_SSID_SIZE 33
+#define CONFIG_WIFI_PASSWORD_SIZE 65
+#define CONFIG_UID_SIZE 40
+#define CONFIG_TOKEN_SIZE 504 // fits the Authorization header buffer
+#define CONFIG_PLANT_NAME_SIZE 64
+#define CONFIG_PLANT_ID_SIZE 40
+
+// Wi-Fi fast reconnect
+#define WIFI_CONNECT_TIMEOUT 5000
+#define WIFI_FAST_CONNECT_TIMEOUT 1500
+#define WIFI_CACHE_MAX_MISSES 3
+// Block on the got-IP event instead of polling WiFi.status(), with the CPU
+// clocked down to WIFI_WAIT_CPU_MHZ while it idles (0 keeps the clock).
+// The radio needs at least 80 MHz.
+#ifndef WIFI_WAIT_EVENTS
+#define WIFI_WAIT_EVENTS true
+#endif
+#define WIFI_WAIT_CPU_MHZ 80
+
+// Reading buffer (batched uplink)
+#define READING_BUFFER_CAPACITY 24
+#define READING_BUFFER_FLUSH_COUNT 12
+#define READING_BUFFER_MAX_AGE_S 300
+
+// Offline queue (LittleFS), holds the readings of failed uplinks
+#define OFFLINE_QUEUE_SEGMENT_RECORDS 255 // 16 B records, one 4 KB block
+#define OFFLINE_QUEUE_MAX_SEGMENTS 64     // backlog cap, oldest evicted first
+#define OFFLINE_QUEUE_DRAIN_BATCHES 4     // replay POSTs per wake
+
+// Send-on-change report policy
+#define REPORT_DEADBAND_TEMPERATURE 0.2f // °C
+#define REPORT_DEADBAND_HUMIDITY 1.0f    // %RH
+#define REPORT_DEADBAND_MOISTURE 2.0f    // %
+#define REPORT_HEARTBEAT_S 1800
+#define REPORT_LOW_BATTERY 20 // %, below which wakes are skipped
+#define REPORT_LOW_BATTERY_STRIDE 2
+#define REPORT_CRITICAL_BATTERY 10
+#define REPORT_CRITICAL_BATTERY_STRIDE 4
+
+// Wake phase profiler, see PhaseProfiler
+#define PROFILER_TRACE_SIZE 32 // phase intervals kept per wake
+#define BOOT_SENSOR_BUDGET_US 5000 // reset to the first sensor trigger
+
+// Logging, see Logger. LOG_LEVEL, the serial level, follows DEBUG_MODE.
+#define LOG_RING_LEVEL LOG_LEVEL_WARN // kept across a crash, NONE disables
+#define LOG_RING_SIZE 16              // records, in RTC memory
+#define LOG_RING_TEXT_SIZE 56         // bytes of message per record
+#define LOG_BUFFER_SIZE 192           // formatted line, longer is truncated
+
+// Telemetry wire format
+#define TELEMETRY_BINARY true
+#define TELEMETRY_CONTENT_TYPE "application/vnd.stacy.telemetry"
+#define TELEMETRY_VERSION 3
+// Batches as a compressed series, telemetry version 4, in SeriesMode
+#define TELEMETRY_SERIES true
+#define TELEMETRY_SERIES_MODE SERIES_DELTA
 
 typedef struct SensorData {
-  double temperature = 0.0;
-  double humidity = 0.0;
+  float temperature = 0.0; // °C
+  float humidity = 0.0;    // %RH
   float moisture = 0.0;
   float hic = 0.0;
   float dewPoint = 0.0;
   float batteryVoltage = 0.0;
   float batteryPercentage = 0.0;
+  // Extremes since the previous wake, from the HDC3022 auto-measurement
+  bool hasHistory = false;
+  float temperatureMin = 0.0;
+  float temperatureMax = 0.0;
+  float humidityMin = 0.0;
+  float humidityMax = 0.0;
 } SensorData;
 
 #endif
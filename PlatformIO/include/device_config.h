@@ -0,0 +1,61 @@
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include "configuration.h"
+#include <Arduino.h>
+
+// Provisioning and account settings, stored as one versioned NVS blob.
+typedef struct DeviceConfigData {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t crc; // CRC-32 of everything after this field
+  char ssid[CONFIG_SSID_SIZE];
+  char wifiPassword[CONFIG_WIFI_PASSWORD_SIZE];
+  char uid[CONFIG_UID_SIZE];
+  char bearerToken[CONFIG_TOKEN_SIZE];
+  char plantName[CONFIG_PLANT_NAME_SIZE];
+  char plantId[CONFIG_PLANT_ID_SIZE];
+} DeviceConfigData;
+
+// How a wake boots, derived from the configuration and stored beside it, so
+// that a timer wake can choose its path without loading the blob.
+typedef enum {
+  BOOT_MODE_UNKNOWN, // not stored yet, take the full path
+  BOOT_MODE_SETUP,   // portal, mDNS or plant creation still to do
+  BOOT_MODE_NORMAL,  // fully provisioned, straight to the sensors
+} BootMode;
+
+// Snapshot of the device configuration, read from NVS once per wake.
+// Setters only change the snapshot; commit() writes it back, once, if
+// anything changed. Devices provisioned with the former one-key-per-setting
+// layout are migrated on first load. The boot mode is rewritten whenever
+// the configuration it follows from changes.
+class DeviceConfig {
+private:
+  static DeviceConfigData data;
+  static bool loaded;
+  static bool dirty;
+  static bool migrated;
+  static uint8_t storedMode;
+  static bool modeRead;
+  static uint32_t checksum(const DeviceConfigData &config);
+  static bool isValid(const DeviceConfigData &config, size_t length);
+  static bool loadLegacy();
+  static bool set(char *field, size_t size, const char *value);
+  static BootMode modeOf(const DeviceConfigData &config);
+
+public:
+  static void begin();
+  static BootMode bootMode();
+  static const DeviceConfigData &get();
+  static bool setWiFi(const char *ssid, const char *wifiPassword);
+  static void clearWiFi();
+  static bool setAccount(const char *uid, const char *bearerToken);
+  static bool setBearerToken(const char *bearerToken);
+  static bool setPlantName(const char *plantName);
+  static bool setPlantId(const char *plantId);
+  static bool commit();
+};
+
+#endif
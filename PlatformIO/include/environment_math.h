@@ -0,0 +1,24 @@
+#ifndef ENVIRONMENT_MATH_H
+#define ENVIRONMENT_MATH_H
+
+#include <Arduino.h>
+
+// Dew point and heat index in single precision, for the ESP32-C3, which
+// has no FPU: every float operation is a libgcc call, and a double one or a
+// libm log() costs several times more. Same formulas as the BME280
+// library's EnvironmentCalculations, in °C, with the logarithm reduced with
+// integer operations on the float's bits. Over -40 to 125 °C and 0.1 to
+// 100 %RH, against the formulas in double precision, the dew point is
+// within 0.0001 °C and the heat index within 0.001 °C, far below the
+// sensors' accuracy.
+// benchmark/environment_math.cpp checks both bounds and the cost per call.
+class EnvironmentMath {
+private:
+  static float logarithm(float value);
+
+public:
+  static float dewPoint(float celsius, float humidity);
+  static float heatIndex(float celsius, float humidity);
+};
+
+#endif
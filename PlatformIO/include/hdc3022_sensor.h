@@ -0,0 +1,24 @@
+#ifndef HDC3022_SENSOR_H
+#define HDC3022_SENSOR_H
+
+#include "configuration.h"
+#include <Adafruit_HDC302x.h>
+
+// Temperature and humidity from the HDC3022, see SensorRegistry.
+class Hdc3022Sensor {
+private:
+  static Adafruit_HDC302x hdc3022;
+  static uint8_t level;
+  static bool converting;
+  static bool checkCrc(const uint8_t *data);
+  static uint8_t selectLowPowerLevel(float batteryPercentage);
+  static bool readHistoryValue(uint16_t command, float &value);
+  static void readHistory(SensorData &sensorData);
+
+public:
+  static bool begin();
+  static bool trigger(SensorData &sensorData);
+  static bool collect(SensorData &sensorData);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef I2C_SCHEDULER_H
+#define I2C_SCHEDULER_H
+
+#include "configuration.h"
+#include <Arduino.h>
+
+// One timed transaction on the bus.
+typedef struct I2cTransaction {
+  uint8_t address;
+  uint8_t size; // bytes written or read
+  bool read;
+  bool acknowledged;
+  uint32_t start;    // us since the first transaction of the wake
+  uint32_t duration; // us
+} I2cTransaction;
+
+// Split-phase I2C on top of Wire. Drivers send their conversion triggers
+// and declare how long the conversion takes; once every trigger is out,
+// waitForConversions() sleeps until the slowest one is done, and the
+// results are read in one burst. The conversions therefore overlap instead
+// of adding up. Each transaction is timed into a small log.
+class I2cScheduler {
+private:
+  static uint32_t firstTransaction;
+  static uint32_t readyTime;
+  static bool pending;
+  static I2cTransaction log[I2C_LOG_SIZE];
+  static size_t logCount;
+  static void record(uint8_t address, size_t size, bool read,
+                     bool acknowledged, uint32_t start);
+
+public:
+  static bool write(uint8_t address, const uint8_t *data, size_t size);
+  static bool command(uint8_t address, uint16_t command);
+  static bool read(uint8_t address, uint8_t *data, size_t size);
+  static void expect(uint32_t conversionMicros);
+  static void waitForConversions();
+  static size_t transactions();
+  static const I2cTransaction &transaction(size_t index);
+  static void reset();
+  static void report();
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+// Longest number add() writes, truncated beyond it
+#define JSON_NUMBER_MAX_SIZE 23
+
+// Writes JSON into a caller-provided buffer, without any heap allocation.
+class JsonWriter {
+private:
+  char *buffer;
+  size_t capacity;
+  size_t length;
+  bool overflow;
+  bool needsComma;
+  void append(char c);
+  void append(const char *text);
+  void appendEscaped(const char *text);
+  void appendKey(const char *key);
+  void appendSeparator();
+
+public:
+  JsonWriter(char *buffer, size_t capacity);
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+  void add(const char *key, const char *value);
+  void add(const char *key, double value, uint8_t decimals = 2);
+  void add(const char *key, uint32_t value);
+  const char *c_str() const;
+  size_t size() const;
+  bool overflowed() const;
+};
+
+#endif
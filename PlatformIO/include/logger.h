@@ -0,0 +1,89 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+
+// Severities, most severe first. A record is kept when its level is at or
+// below the level compiled in for an output.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#include "configuration.h"
+
+// Serial output level. Debug builds print everything, production builds
+// nothing. Override with -DLOG_LEVEL=LOG_LEVEL_INFO and the like.
+#ifndef LOG_LEVEL
+#ifdef DEBUG_MODE
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL LOG_LEVEL_NONE
+#endif
+#endif
+
+// Whether a level reaches any output. Constant, so a disabled call is
+// dropped by the compiler together with its arguments, which are still type
+// checked against the format but never evaluated.
+#define LOG_ENABLED(level) ((level) <= LOG_LEVEL || (level) <= LOG_RING_LEVEL)
+
+#define LOG_AT(level, ...)                                                     \
+  do {                                                                         \
+    if (LOG_ENABLED(level))                                                    \
+      Logger::write(level, __VA_ARGS__);                                       \
+  } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// Prints the free heap and its low-water mark since boot
+#define LOG_HEAP(label)                                                        \
+  LOG_DEBUG("heap %s: free %u, min free %u", label,                           \
+            (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap())
+
+// One record of the crash log. Binary, so that keeping it costs a copy and
+// no formatting beyond the message itself.
+typedef struct LogRecord {
+  uint32_t time; // ms since reset
+  uint16_t boot; // boot the record was written in
+  uint8_t level;
+  uint8_t length;
+  char text[LOG_RING_TEXT_SIZE]; // message, truncated, not terminated
+} LogRecord;
+
+// Records of the last boots, in RTC memory that is not initialized at reset.
+// It survives panics, watchdog and software resets and deep sleep, but not
+// the TPL5110 cutting power, which is why the magic is checked before it is
+// used.
+typedef struct LogRing {
+  uint32_t magic;
+  uint16_t boot;
+  uint16_t head;
+  uint16_t count;
+  LogRecord records[LOG_RING_SIZE];
+} LogRing;
+
+// Leveled logging through the LOG_* macros. Messages are formatted with
+// printf syntax into one static buffer, so logging never allocates, and go
+// to the serial port up to LOG_LEVEL and to the crash ring up to
+// LOG_RING_LEVEL. Not reentrant, like the rest of the firmware it runs in
+// the Arduino task only.
+class Logger {
+private:
+  static char buffer[LOG_BUFFER_SIZE];
+  static bool crashed;
+  static void record(uint8_t level, const char *text, size_t length);
+
+public:
+  static void begin();
+  static void waitForSerial();
+  static void write(uint8_t level, const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+  static bool resetByCrash();
+  static void dumpRing(Print &output);
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef MOISTURE_SENSOR_H
+#define MOISTURE_SENSOR_H
+
+#include "configuration.h"
+
+// Soil moisture from the capacitive probe, see SensorRegistry.
+class MoistureSensor {
+public:
+  static bool begin();
+  static bool trigger(SensorData &sensorData);
+  static bool collect(SensorData &sensorData);
+};
+
+#endif
@@ -2,19 +2,82 @@
 #define NETWORK_HANDLER_H
 
 #include "configuration.h"
+#include "json_writer.h"
+#include "phase_profiler.h"
+#include "reading_buffer.h"
 #include <Arduino.h>
 #include <Preferences.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+// Bits of the Wi-Fi event group
+#define WIFI_GOT_IP_BIT 0x01
+
+// Outcome of an uplink.
+typedef enum {
+  UPLOAD_ACCEPTED, // stored by the server
+  UPLOAD_REJECTED, // 400, 413 or 415: the server will never take the batch
+  UPLOAD_FAILED,   // no connection, 5xx, no token or a local error: retried
+} UploadResult;
+
+// Last successful association, used to skip the scan and DHCP on wake.
+typedef struct WiFiCache {
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t localIP;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint8_t misses;
+} WiFiCache;
 
 class NetworkHandler {
 private:
   Preferences initialModePreferences;
+  static unsigned long lastConnectTime;
+  static unsigned long connectStartTime;
+  static bool connectHasCache;
+  static WiFiCache connectCache;
+  static WiFiCache pendingCache;
+  static bool cacheDirty;
+  static String connectSsid;
+  static String connectPassword;
+  static EventGroupHandle_t wifiEvents;
+  static void onWiFiEvent(WiFiEvent_t event);
+  static uint8_t handshakeCount;
+  static unsigned long handshakeTime;
   static String getMacAddress();
   static bool refreshToken();
+  static bool beginRequest(const char *path);
+  static int post(const uint8_t *payload, size_t size);
+  static void addDeviceHeaders(const char *contentType,
+                               const char *bearerToken, const char *uid);
+  static void writeReading(JsonWriter &json, const SensorData &sensorData,
+                           uint32_t age = 0);
+  static bool waitForConnection(unsigned long startTime,
+                                unsigned long timeout);
+  static bool loadWiFiCache(WiFiCache &cache);
+  static void saveWiFiCache(const WiFiCache &cache);
+  static void clearWiFiCache();
 
 public:
   static void connectToWiFi();
-  static void sendDataToServer(SensorData sensorData);
-  static void createPlant(String plantName);
+  static void beginConnection();
+  static bool finishConnection();
+  static unsigned long getLastConnectTime();
+  static void closeConnection();
+  static void commitWiFiCache();
+  static uint8_t getHandshakeCount();
+  static unsigned long getHandshakeTime();
+  static void sendDataToServer(SensorData sensorData, bool refreshed = false);
+  static UploadResult sendReadings(const PackedReading *readings,
+                                   size_t count, uint32_t epoch,
+                                   const WakeProfile *profile = nullptr,
+                                   bool refreshed = false);
+  static UploadResult sendBufferedData();
+  static bool sendQueuedData();
+  static void createPlant(String plantName, bool refreshed = false);
   static bool loginUser(const String &email, const String &password);
 };
 
@@ -0,0 +1,71 @@
+#ifndef OFFLINE_QUEUE_H
+#define OFFLINE_QUEUE_H
+
+#include "configuration.h"
+#include "reading_record.h"
+#include <Arduino.h>
+#include <FS.h>
+
+// Start of a segment file: the wake clock its reading deltas count from.
+typedef struct SegmentHeader {
+  uint32_t magic;
+  uint32_t epoch;
+} SegmentHeader;
+
+// A queued reading as stored in flash.
+typedef struct __attribute__((packed)) QueuedRecord {
+  PackedReading reading;
+  uint32_t crc; // CRC-32 of the reading
+} QueuedRecord;
+
+// Read position and size of the queue, kept in NVS so that the common
+// case, an empty queue, does not mount the filesystem.
+typedef struct OfflineQueueState {
+  uint32_t magic;
+  uint32_t segment; // oldest segment holding unsent records
+  uint32_t offset;  // records of that segment already sent
+  uint32_t count;   // records queued
+} OfflineQueueState;
+
+// Store-and-forward log of readings whose uplink failed, in LittleFS.
+// Records are only ever appended, to numbered segment files of
+// OFFLINE_QUEUE_SEGMENT_RECORDS records that fit one flash block; sent
+// segments are deleted whole rather than rewritten. A reading too far from
+// the epoch of the last segment for its delta starts a new one. Beyond
+// OFFLINE_QUEUE_MAX_SEGMENTS, the oldest segment is evicted. A record cut
+// short by a power loss fails its CRC or length and is skipped, and the
+// next append starts a fresh segment. An append that fails otherwise is
+// rolled back, so that its readings are queued whole or not at all.
+class OfflineQueue {
+private:
+  static bool mounted;
+  static bool loaded;
+  static OfflineQueueState state;
+  static OfflineQueueState readState;
+  static uint32_t firstSegment;
+  static uint32_t lastSegment;
+  static size_t lastSegmentRecords;
+  static bool lastSegmentTorn;
+  static uint32_t lastSegmentEpoch;
+  static bool hasSegments;
+  static void load();
+  static void save();
+  static bool mount();
+  static void scan();
+  static String segmentPath(uint32_t segment);
+  static void evictOldest();
+  static bool readHeader(File &file, uint32_t &epoch);
+  static bool startSegment(uint32_t epoch);
+  static void discardSegments(uint32_t from);
+  static bool truncateSegment(uint32_t segment, size_t records);
+
+public:
+  static size_t count();
+  static bool append(const PackedReading *readings, size_t count,
+                     uint32_t epoch);
+  static size_t read(PackedReading *readings, size_t capacity,
+                     uint32_t &epoch);
+  static void commit();
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PHASE_PROFILER_H
+#define PHASE_PROFILER_H
+
+#include "configuration.h"
+#include <Arduino.h>
+
+// Phases of a wake. The order is part of the telemetry format, append only.
+typedef enum {
+  PHASE_BOOT,    // reset to setup()
+  PHASE_NVS,     // Preferences reads and writes
+  PHASE_WIFI,    // association, from beginConnection() to connected
+  PHASE_TLS,     // handshakes
+  PHASE_SENSOR,  // sampling the sensor registry
+  PHASE_ADC,     // moisture and battery conversions
+  PHASE_POST,    // HTTP requests, from sending to the response
+  PHASE_STARTUP, // reset to the first sensor trigger
+  PHASE_BATTERY, // battery voltage read
+  PHASE_COUNT
+} Phase;
+
+// One timed interval of a phase.
+typedef struct PhaseInterval {
+  uint8_t phase;
+  uint32_t start;    // us since reset
+  uint32_t duration; // us
+} PhaseInterval;
+
+// Time spent in each phase over a whole wake, in units of 100 us,
+// saturating. Phases may overlap, e.g. sampling runs while Wi-Fi
+// associates, so they do not add up to the awake time.
+typedef struct WakeProfile {
+  uint32_t magic;
+  uint16_t awake;
+  uint16_t phases[PHASE_COUNT];
+} WakeProfile;
+
+// Times the phases of a wake with esp_timer_get_time(). Each interval goes
+// to a fixed trace ring, and the time of each phase is summed into a
+// profile. The profile of the last uplink wake is kept in NVS and sent with
+// the next telemetry batch, so that production builds, without serial
+// output, still report where awake time goes.
+class PhaseProfiler {
+private:
+  static uint32_t startTimes[PHASE_COUNT];
+  static uint8_t depth[PHASE_COUNT];
+  static uint32_t totals[PHASE_COUNT];
+  static PhaseInterval trace[PROFILER_TRACE_SIZE];
+  static size_t traceHead;
+  static size_t traceCount;
+  static WakeProfile saved;
+  static bool dirty;
+  static uint16_t toUnits(uint32_t micros);
+
+public:
+  static void begin();
+  static void start(Phase phase);
+  static void stop(Phase phase);
+  static uint32_t total(Phase phase);
+  static void save();
+  static void commit();
+  static bool lastUplink(WakeProfile &profile);
+  static void report();
+};
+
+// Times a phase for as long as it is in scope.
+class PhaseTimer {
+private:
+  Phase phase;
+
+public:
+  explicit PhaseTimer(Phase phase) : phase(phase) {
+    PhaseProfiler::start(phase);
+  }
+  ~PhaseTimer() { PhaseProfiler::stop(phase); }
+};
+
+#endif
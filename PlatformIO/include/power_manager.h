@@ -0,0 +1,28 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include "configuration.h"
+#include <Arduino.h>
+
+// Kept in RTC memory, so only valid after a deep sleep.
+typedef struct PowerState {
+  uint32_t magic;
+  uint32_t cycles;    // wakes since RTC memory was last lost
+  uint32_t lastAwake; // ms the previous wake was awake
+} PowerState;
+
+// Ends a wake with the POWER_BACKEND: the TPL5110 cutting power until its
+// next period, or deep sleep with a timer wake after TIME_TO_SLEEP. The
+// wake itself runs the same code on both, and each one reports its awake
+// time and whether RTC memory was retained from the previous one.
+class PowerManager {
+private:
+  static bool retained;
+
+public:
+  static void begin();
+  static bool isRetained();
+  static void sleep();
+};
+
+#endif
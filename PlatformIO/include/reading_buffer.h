@@ -0,0 +1,42 @@
+#ifndef READING_BUFFER_H
+#define READING_BUFFER_H
+
+#include "configuration.h"
+#include "reading_record.h"
+#include <Arduino.h>
+
+// Ring buffer persisted in RTC memory (POWER_DEEP_SLEEP) or in an NVS blob
+// (POWER_TPL5110, where RTC memory does not survive), written once at the
+// end of the wake by commit(). Reading times are deltas from the epoch, a
+// wake clock time no later than the oldest.
+typedef struct ReadingBufferState {
+  uint32_t magic;
+  uint16_t head;
+  uint16_t count;
+  uint32_t epoch;
+  PackedReading readings[READING_BUFFER_CAPACITY];
+} ReadingBufferState;
+
+class ReadingBuffer {
+private:
+  static uint32_t currentTime;
+  static bool dirty;
+  static bool isValid(const ReadingBufferState &state);
+  static size_t slotOf(size_t index);
+  static void rebase();
+
+public:
+  static void begin(uint32_t now);
+  static void push(const SensorData &sensorData);
+  static bool shouldFlush();
+  static bool shouldFlushAfterPush();
+  static size_t count();
+  static uint32_t ageOf(size_t index);
+  static uint32_t age(uint32_t time);
+  static void get(size_t index, SensorData &sensorData);
+  static size_t copy(PackedReading *readings, uint32_t &epoch);
+  static void clear();
+  static void commit();
+};
+
+#endif
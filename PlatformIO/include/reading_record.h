@@ -0,0 +1,92 @@
+#ifndef READING_RECORD_H
+#define READING_RECORD_H
+
+#include "configuration.h"
+#include <Arduino.h>
+#include <limits>
+
+#define READING_RECORD_VERSION 1
+
+// Fixed-point scales of the record fields
+#define RECORD_TEMPERATURE_SCALE 100 // centi-°C
+#define RECORD_HUMIDITY_SCALE 100    // centi-%RH
+#define RECORD_MOISTURE_SCALE 10     // per-mille
+#define RECORD_VOLTAGE_SCALE 1000    // mV
+
+// Ranges the fields must hold: the HDC3022 and BME280 ranges with a
+// margin, and twice the ADC full scale behind the battery divider
+#define RECORD_MIN_CELSIUS -45.0
+#define RECORD_MAX_CELSIUS 130.0
+#define RECORD_MAX_PERCENT 100.0
+#define RECORD_MAX_VOLTS 6.5
+
+// Flags of the values that were not a number when packed
+#define RECORD_NAN_TEMPERATURE 0x01
+#define RECORD_NAN_HUMIDITY 0x02
+#define RECORD_NAN_MOISTURE 0x04
+#define RECORD_NAN_VOLTAGE 0x08
+
+// A reading as kept in the buffer and the offline queue and sent in
+// telemetry version 3, little-endian. The heat index, dew point and battery
+// percentage follow from the other values and are derived when unpacked.
+// The time is a delta from an epoch kept by whatever holds the records.
+typedef struct __attribute__((packed)) PackedReading {
+  uint8_t version;         // READING_RECORD_VERSION
+  uint8_t flags;           // RECORD_NAN_* bits
+  int16_t temperature;     // centi-°C
+  uint16_t humidity;       // centi-%RH
+  uint16_t moisture;       // per-mille
+  uint16_t batteryVoltage; // mV
+  uint16_t delta;          // s after the epoch
+} PackedReading;
+
+/**
+ * @brief Rounds a value to a fixed-point integer.
+ * @param value The value.
+ * @param scale The fixed-point units per unit of the value.
+ * @return The scaled value, rounded half away from zero.
+ */
+constexpr long quantize(double value, long scale) {
+  return (long)(value * scale + (value < 0 ? -0.5 : 0.5));
+}
+
+/**
+ * @brief Tells whether a range of values fits a fixed-point field.
+ * @param min The lowest value to hold.
+ * @param max The highest value to hold.
+ * @param scale The fixed-point units per unit of the value.
+ * @return True if both ends fit the field type T.
+ */
+template <typename T> constexpr bool fitsField(double min, double max,
+                                               long scale) {
+  return quantize(min, scale) >= (long)std::numeric_limits<T>::min() &&
+         quantize(max, scale) <= (long)std::numeric_limits<T>::max();
+}
+
+static_assert(sizeof(PackedReading) == 12, "PackedReading must be 12 bytes");
+static_assert(fitsField<int16_t>(RECORD_MIN_CELSIUS, RECORD_MAX_CELSIUS,
+                                 RECORD_TEMPERATURE_SCALE),
+              "temperature range does not fit the record");
+static_assert(fitsField<uint16_t>(0, RECORD_MAX_PERCENT,
+                                  RECORD_HUMIDITY_SCALE),
+              "humidity range does not fit the record");
+static_assert(fitsField<uint16_t>(0, RECORD_MAX_PERCENT,
+                                  RECORD_MOISTURE_SCALE),
+              "moisture range does not fit the record");
+static_assert(fitsField<uint16_t>(0, RECORD_MAX_VOLTS, RECORD_VOLTAGE_SCALE),
+              "battery voltage range does not fit the record");
+static_assert(BATTERY_MAX <= RECORD_MAX_VOLTS,
+              "battery voltage beyond the record range");
+
+// Conversion between SensorData and PackedReading. Values beyond the
+// record ranges are clamped to them.
+class ReadingRecord {
+private:
+  static long clamp(float value, double min, double max, long scale);
+
+public:
+  static PackedReading pack(const SensorData &sensorData, uint16_t delta);
+  static bool unpack(const PackedReading &reading, SensorData &sensorData);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include "configuration.h"
+#include <Arduino.h>
+
+// Wake clock and last reported values, persisted like the reading buffer.
+typedef struct ReportState {
+  uint32_t magic;
+  uint32_t clock;          // seconds since provisioning, one period per wake
+  uint32_t lastReportTime; // clock of the last reading pushed
+  float temperature;
+  float humidity;
+  float moisture;
+  float batteryPercentage;
+  uint8_t wakesSinceSample;
+  bool hasReport;
+} ReportState;
+
+// Send-on-change policy: a reading is only buffered for upload when it
+// moved past a deadband or the heartbeat expired, and wakes are skipped
+// without sampling when the battery is low.
+class ReportPolicy {
+private:
+  static bool dirty;
+  static bool isValid(const ReportState &state);
+  static uint8_t wakeStride();
+
+public:
+  static void begin();
+  static uint32_t now();
+  static bool isSampleDue();
+  static bool isHeartbeatDue();
+  static float batteryEstimate();
+  static bool shouldReport(const SensorData &sensorData);
+  static void sampled(const SensorData &sensorData, bool reported);
+  static void skipWake();
+  static void commit();
+};
+
+#endif
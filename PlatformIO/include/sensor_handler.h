@@ -1,18 +1,23 @@
 #ifndef SENSOR_HANDLER_H
 #define SENSOR_HANDLER_H
 
+#include "bme280_sensor.h"
 #include "configuration.h"
-#include <Adafruit_HDC302x.h>
+#include "hdc3022_sensor.h"
+#include "moisture_sensor.h"
+#include "sensor_registry.h"
 
-class SensorHandler {
-private:
-  static Adafruit_HDC302x hdc3022;
-  static void readHDC(SensorData &sensorData);
-  static float getMoisture();
+// The sensors of this build, sampled in this order. Both the BME280 and the
+// HDC3022 provide temperature and humidity; if both are fitted, the HDC3022
+// reading is kept.
+typedef SensorRegistry<SensorIf<Bme280Sensor, SENSOR_BME280>::type,
+                       SensorIf<Hdc3022Sensor, SENSOR_HDC3022>::type,
+                       SensorIf<MoistureSensor, SENSOR_MOISTURE>::type>
+    Sensors;
 
+class SensorHandler {
 public:
-  static bool initHDC();
-  static void readSensorData(SensorData &sensorData);
+  static bool readSensorData(SensorData &sensorData);
 };
 
-#endif
\ No newline at end of file
+#endif
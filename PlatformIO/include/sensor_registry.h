@@ -0,0 +1,85 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include "configuration.h"
+#include "i2c_scheduler.h"
+
+// A sensor driver is a class of static methods:
+//   static bool begin();                      // probe and configure
+//   static bool trigger(SensorData &data);    // start a conversion
+//   static bool collect(SensorData &data);    // fill in its fields
+// trigger() declares its conversion time with I2cScheduler::expect(), so
+// the conversions of all drivers overlap before collect() reads them.
+// Drivers are listed in a SensorRegistry at compile time, so sampling them
+// unrolls into direct, inlinable calls with no dispatch at run time.
+
+// Takes the place of a driver left out of the build. Its calls fold away
+// and the driver is never referenced, so its sources can be compiled out.
+class DisabledSensor {
+public:
+  static bool begin() { return true; }
+  static bool trigger(SensorData &sensorData) { return true; }
+  static bool collect(SensorData &sensorData) { return true; }
+};
+
+// Selects a driver, or DisabledSensor when the build leaves it out.
+template <typename Driver, bool enabled> struct SensorIf {
+  typedef Driver type;
+};
+
+template <typename Driver> struct SensorIf<Driver, false> {
+  typedef DisabledSensor type;
+};
+
+template <typename... Drivers> class SensorRegistry;
+
+template <> class SensorRegistry<> {
+public:
+  static uint32_t start(SensorData &sensorData) { return 0; }
+  static bool collect(SensorData &sensorData, uint32_t started) {
+    return true;
+  }
+  static bool sample(SensorData &sensorData) { return true; }
+};
+
+template <typename Driver, typename... Drivers>
+class SensorRegistry<Driver, Drivers...> {
+  typedef SensorRegistry<Drivers...> Rest;
+
+public:
+  /**
+   * @brief Starts each driver and triggers its conversion.
+   * @param sensorData Reference to the SensorData struct to populate.
+   * @return A mask with bit i set if driver i was started.
+   */
+  static uint32_t start(SensorData &sensorData) {
+    uint32_t started = Driver::begin() && Driver::trigger(sensorData);
+    return Rest::start(sensorData) << 1 | started;
+  }
+
+  /**
+   * @brief Reads the result of each started driver.
+   * @param sensorData Reference to the SensorData struct to populate.
+   * @param started The mask returned by start().
+   * @return True if every driver was read.
+   */
+  static bool collect(SensorData &sensorData, uint32_t started) {
+    bool collected = (started & 1) && Driver::collect(sensorData);
+    return Rest::collect(sensorData, started >> 1) && collected;
+  }
+
+  /**
+   * @brief Triggers all drivers, waits once for the slowest conversion, then
+   * reads them all. A driver that fails does not stop the others.
+   * @param sensorData Reference to the SensorData struct to populate.
+   * @return True if every driver was sampled.
+   */
+  static bool sample(SensorData &sensorData) {
+    static_assert(sizeof...(Drivers) < 32, "one mask bit per driver");
+    uint32_t started = start(sensorData);
+    I2cScheduler::waitForConversions();
+    return collect(sensorData, started);
+  }
+};
+
+#endif
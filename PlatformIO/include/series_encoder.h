@@ -0,0 +1,54 @@
+#ifndef SERIES_ENCODER_H
+#define SERIES_ENCODER_H
+
+#include "reading_record.h"
+#include <Arduino.h>
+
+// How a value is coded against the same value of the previous reading
+typedef enum {
+  SERIES_DELTA, // zigzag varint of the difference, modulo 2^16
+  SERIES_XOR,   // varint of the bits that differ
+} SeriesMode;
+
+// Values of a reading coded by the mode: temperature, humidity, moisture
+// and battery voltage
+#define SERIES_VALUES 4
+// Worst case of a reading: at most 3 varint bytes for the time and for each
+// value, and its flags
+#define SERIES_MAX_READING_SIZE (1 + 3 * (1 + SERIES_VALUES))
+
+// Compresses a series of PackedReading records into a caller-provided
+// buffer, one reading at a time, keeping only what the next reading is
+// coded against, so memory does not grow with the series.
+// The series starts with the record version, which every reading must
+// share. Each reading is then the delta-of-delta of its time, zigzagged and
+// shifted left by one, with the low bit set if its flags differ from the
+// previous reading's, then those flags if so, then its values in the
+// SeriesMode. The first reading is coded against a reading of zeros, and
+// the version and flags are varints of one byte.
+// Varints are LEB128: 7 bits per byte, low bits first, the high bit set on
+// every byte but the last.
+class SeriesEncoder {
+private:
+  uint8_t *buffer;
+  size_t capacity;
+  size_t length;
+  SeriesMode mode;
+  uint8_t version;
+  bool started;
+  bool overflow;
+  uint8_t previousFlags;
+  uint16_t previous[SERIES_VALUES];
+  uint16_t previousTime;
+  int32_t previousStep;
+  void writeVarint(uint32_t value);
+  static uint32_t zigzag(int32_t value);
+
+public:
+  SeriesEncoder(uint8_t *buffer, size_t capacity, SeriesMode mode);
+  bool add(const PackedReading &reading);
+  size_t size() const;
+  bool overflowed() const;
+};
+
+#endif
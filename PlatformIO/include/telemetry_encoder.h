@@ -0,0 +1,44 @@
+#ifndef TELEMETRY_ENCODER_H
+#define TELEMETRY_ENCODER_H
+
+#include "configuration.h"
+#include "phase_profiler.h"
+#include "reading_record.h"
+#include "series_encoder.h"
+#include <Arduino.h>
+
+// Binary /weather payload, little-endian:
+//   header: version (u8), reading count (u8), age of the epoch in seconds
+//           (u32)
+//   reading: a PackedReading, its age being the epoch's less its delta
+//   profile: phase count (u8), 0 when there is no profile, then awake time
+//            and the time of each Phase (u16 each, 100 us)
+// Version 4 adds the SeriesMode (u8) to the header and sends the readings
+// as a SeriesEncoder series. Versions 1 and 2 sent every value as an f32,
+// with a u16 age.
+#define TELEMETRY_SERIES_VERSION 4
+#define TELEMETRY_HEADER_SIZE 6
+#define TELEMETRY_SERIES_HEADER_SIZE 7
+#define TELEMETRY_READING_SIZE 12
+#define TELEMETRY_PROFILE_SIZE (1 + 2 + 2 * PHASE_COUNT)
+#define TELEMETRY_MAX_SIZE                                                     \
+  (TELEMETRY_SERIES_HEADER_SIZE + 1 +                                          \
+   READING_BUFFER_CAPACITY * SERIES_MAX_READING_SIZE + TELEMETRY_PROFILE_SIZE)
+
+class TelemetryEncoder {
+private:
+  static size_t writeUInt16(uint8_t *buffer, uint16_t value);
+  static size_t writeUInt32(uint8_t *buffer, uint32_t value);
+  static size_t writeRecords(const PackedReading *readings, size_t count,
+                             uint8_t *buffer);
+  static size_t writeSeries(const PackedReading *readings, size_t count,
+                            uint8_t *buffer, size_t capacity);
+  static size_t writeProfile(const WakeProfile *profile, uint8_t *buffer);
+
+public:
+  static size_t encodeReadings(const PackedReading *readings, size_t count,
+                               uint32_t epoch, const WakeProfile *profile,
+                               uint8_t *buffer, size_t capacity);
+};
+
+#endif
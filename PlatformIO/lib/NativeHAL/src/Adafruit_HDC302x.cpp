@@ -0,0 +1,230 @@
+#include "Adafruit_HDC302x.h"
+#include "ESPmDNS.h"
+#include "EnergyModel.h"
+
+#include <stdio.h>
+#include <string>
+
+#define I2C_TRANSACTION_US 300
+// Auto-measurement history points per wake interval
+#define HISTORY_POINTS 5
+#define HDC_READ_MIN_TEMPERATURE 0xE002
+#define HDC_READ_MAX_TEMPERATURE 0xE003
+#define HDC_READ_MIN_HUMIDITY 0xE004
+#define HDC_READ_MAX_HUMIDITY 0xE005
+
+MDNSResponder MDNS;
+
+// Approximate conversion time and temperature repeatability per mode
+static const uint32_t conversionMicros[] = {12500, 7500, 5000, 3700};
+static const double repeatability[] = {0.01, 0.015, 0.025, 0.04};
+
+// Auto-measurement state, kept across wakes only when STACY_HDC_POWERED
+// says the sensor is not power-gated with the board
+typedef struct HdcState {
+  uint16_t autoMode;
+  uint32_t autoSince; // wake the mode was entered
+} HdcState;
+
+static HdcState state;
+
+static std::string statePath() {
+  return std::string(NativeHal::envString("STACY_NVS_DIR", "native_nvs")) +
+         "/hdc3022.state";
+}
+
+static void loadState() {
+  state = HdcState();
+  if (!NativeHal::envLong("STACY_HDC_POWERED", 0))
+    return;
+  FILE *file = fopen(statePath().c_str(), "rb");
+  if (!file)
+    return;
+  if (fread(&state, sizeof(state), 1, file) != 1)
+    state = HdcState();
+  fclose(file);
+}
+
+static void saveState() {
+  if (!NativeHal::envLong("STACY_HDC_POWERED", 0))
+    return;
+  FILE *file = fopen(statePath().c_str(), "wb");
+  if (!file)
+    return;
+  fwrite(&state, sizeof(state), 1, file);
+  fclose(file);
+}
+
+/**
+ * @brief Spends time on the I2C bus or waiting for a conversion.
+ */
+static void busy(uint64_t micros) {
+  NativeHal::advance(micros);
+  EnergyModel::consume(RAIL_I2C, micros);
+}
+
+/**
+ * @brief Gets the low-power level of a trigger or auto-measurement mode.
+ * @return 0 (LP0, lowest noise) to 3 (LP3, fastest).
+ */
+static int lowPowerLevel(uint16_t mode) {
+  switch (mode) {
+  case TRIGGERMODE_LP0:
+  case AUTO_MEASUREMENT_0_5MPS_LP0:
+  case AUTO_MEASUREMENT_1MPS_LP0:
+    return 0;
+  case TRIGGERMODE_LP1:
+  case AUTO_MEASUREMENT_0_5MPS_LP1:
+  case AUTO_MEASUREMENT_1MPS_LP1:
+    return 1;
+  case TRIGGERMODE_LP2:
+  case AUTO_MEASUREMENT_0_5MPS_LP2:
+  case AUTO_MEASUREMENT_1MPS_LP2:
+    return 2;
+  default:
+    return 3;
+  }
+}
+
+/**
+ * @brief A conversion of the current conditions at a low-power level.
+ */
+static void sample(int level, double &temperature, double &humidity) {
+  NativeHal::conditions(NativeHal::wake(), temperature, humidity);
+  double noise = repeatability[level] * (rand() % 201 - 100) / 100.0;
+  temperature += noise;
+  humidity += noise * 5;
+}
+
+/**
+ * @brief Writes a 16-bit word followed by its CRC.
+ */
+static void putWord(uint8_t *data, uint16_t word) {
+  data[0] = word >> 8;
+  data[1] = word & 0xFF;
+  // CRC-8, polynomial 0x31, initial value 0xFF
+  uint8_t crc = 0xFF;
+  for (int i = 0; i < 2; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  data[2] = crc;
+}
+
+static uint16_t rawTemperature(double temperature) {
+  return constrain((temperature + 45.0) / 175.0, 0.0, 1.0) * 65535;
+}
+
+static uint16_t rawHumidity(double humidity) {
+  return constrain(humidity / 100.0, 0.0, 1.0) * 65535;
+}
+
+// The sensor as seen over I2C: on-demand conversions, which NACK reads
+// until their conversion time (scaled by STACY_HDC_LATENCY_PERCENT) has
+// passed, and the min/max history of the auto-measurement mode over the
+// interval since the previous wake.
+class HdcDevice : public NativeI2cDevice {
+private:
+  uint16_t command = 0;
+  uint64_t readyAt = 0;
+
+public:
+  bool receive(const uint8_t *data, size_t size) override {
+    if (size != 2)
+      return false;
+    command = data[0] << 8 | data[1];
+    if ((command & 0xFF00) == 0x2400) {
+      uint64_t conversion = conversionMicros[lowPowerLevel(command)] *
+                            NativeHal::envLong("STACY_HDC_LATENCY_PERCENT",
+                                               100) /
+                            100;
+      readyAt = NativeHal::micros() + conversion;
+      // The sensor draws while converting, whatever the CPU does meanwhile
+      EnergyModel::consume(RAIL_I2C, conversion);
+    }
+    return true;
+  }
+
+  size_t respond(uint8_t *data, size_t size) override {
+    if ((command & 0xFF00) == 0x2400)
+      return respondConversion(data, size);
+    if (size < 3 || !state.autoMode || command < HDC_READ_MIN_TEMPERATURE ||
+        command > HDC_READ_MAX_HUMIDITY)
+      return 0;
+
+    uint32_t wake = NativeHal::wake();
+    uint32_t from = wake > state.autoSince ? wake - 1 : wake;
+    double minimum = INFINITY, maximum = -INFINITY;
+    for (int i = 0; i <= HISTORY_POINTS; i++) {
+      double point = from + (double)(wake - from) * i / HISTORY_POINTS;
+      double temperature, humidity;
+      NativeHal::conditions(point, temperature, humidity);
+      bool isTemperature = command <= HDC_READ_MAX_TEMPERATURE;
+      double value = isTemperature ? temperature : humidity;
+      minimum = fmin(minimum, value);
+      maximum = fmax(maximum, value);
+    }
+
+    bool isMinimum = command == HDC_READ_MIN_TEMPERATURE ||
+                     command == HDC_READ_MIN_HUMIDITY;
+    double value = isMinimum ? minimum : maximum;
+    putWord(data, command <= HDC_READ_MAX_TEMPERATURE ? rawTemperature(value)
+                                                      : rawHumidity(value));
+    return 3;
+  }
+
+  size_t respondConversion(uint8_t *data, size_t size) {
+    if (size < 6 || NativeHal::micros() < readyAt)
+      return 0;
+    double temperature, humidity;
+    sample(lowPowerLevel(command), temperature, humidity);
+    putWord(data, rawTemperature(temperature));
+    putWord(data + 3, rawHumidity(humidity));
+    command = 0;
+    return 6;
+  }
+};
+
+static HdcDevice device;
+
+bool Adafruit_HDC302x::begin(uint8_t address, TwoWire *wire) {
+  busy(I2C_TRANSACTION_US);
+  if (NativeHal::envLong("STACY_HDC_MISSING", 0))
+    return false;
+  loadState();
+  TwoWire::attach(address, &device);
+  return true;
+}
+
+bool Adafruit_HDC302x::readTemperatureHumidityOnDemand(double &temperature,
+                                                       double &humidity,
+                                                       hdcTriggerMode mode) {
+  int level = lowPowerLevel(mode);
+  busy(2 * I2C_TRANSACTION_US + conversionMicros[level]);
+  sample(level, temperature, humidity);
+  return true;
+}
+
+bool Adafruit_HDC302x::setAutoMode(hdcAutoMode mode) {
+  busy(I2C_TRANSACTION_US);
+  state.autoMode = mode == EXIT_AUTO_MODE ? 0 : mode;
+  state.autoSince = NativeHal::wake();
+  saveState();
+  return true;
+}
+
+bool Adafruit_HDC302x::readAutoTempRH(double &temperature, double &humidity) {
+  if (!state.autoMode)
+    return false;
+  busy(I2C_TRANSACTION_US);
+  sample(lowPowerLevel(state.autoMode), temperature, humidity);
+  return true;
+}
+
+bool Adafruit_HDC302x::reset() {
+  busy(I2C_TRANSACTION_US);
+  state = HdcState();
+  saveState();
+  return true;
+}
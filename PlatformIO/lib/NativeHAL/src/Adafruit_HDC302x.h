@@ -0,0 +1,41 @@
+#ifndef ADAFRUIT_HDC302X_H
+#define ADAFRUIT_HDC302X_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+typedef enum {
+  TRIGGERMODE_LP0 = 0x2400,
+  TRIGGERMODE_LP1 = 0x240B,
+  TRIGGERMODE_LP2 = 0x2416,
+  TRIGGERMODE_LP3 = 0x24FF,
+} hdcTriggerMode;
+
+typedef enum {
+  AUTO_MEASUREMENT_0_5MPS_LP0 = 0x2032,
+  AUTO_MEASUREMENT_0_5MPS_LP1 = 0x2024,
+  AUTO_MEASUREMENT_0_5MPS_LP2 = 0x202F,
+  AUTO_MEASUREMENT_0_5MPS_LP3 = 0x20FF,
+  AUTO_MEASUREMENT_1MPS_LP0 = 0x2130,
+  AUTO_MEASUREMENT_1MPS_LP1 = 0x2126,
+  AUTO_MEASUREMENT_1MPS_LP2 = 0x212D,
+  AUTO_MEASUREMENT_1MPS_LP3 = 0x21FF,
+  EXIT_AUTO_MODE = 0x3093,
+} hdcAutoMode;
+
+// HDC3022 stand-in. Readings follow STACY_TRACE or a daily cycle around
+// STACY_TEMP_C and STACY_RH, and each conversion costs the time and noise
+// of its low-power mode. Once begin() attaches it to Wire, on-demand
+// conversions and the min/max history can also be driven over I2C. The
+// auto-measurement mode survives wakes only with STACY_HDC_POWERED.
+class Adafruit_HDC302x {
+public:
+  bool begin(uint8_t address = 0x44, TwoWire *wire = &Wire);
+  bool readTemperatureHumidityOnDemand(double &temperature, double &humidity,
+                                       hdcTriggerMode mode);
+  bool setAutoMode(hdcAutoMode mode);
+  bool readAutoTempRH(double &temperature, double &humidity);
+  bool reset();
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "Arduino.h"
+#include "EnergyModel.h"
+
+// The firmware signals the TPL5110 on this pin, see TPL5110_DONE_PIN
+#ifndef NATIVE_POWER_OFF_PIN
+#define NATIVE_POWER_OFF_PIN 10
+#endif
+
+#define NATIVE_PIN_COUNT 32
+
+HardwareSerial Serial;
+EspClass ESP;
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+static uint8_t pinLevels[NATIVE_PIN_COUNT];
+static uint32_t cpuMhz = 160;
+
+uint32_t nativeFreeHeap();
+uint32_t nativeMinFreeHeap();
+
+uint32_t EspClass::getFreeHeap() { return nativeFreeHeap(); }
+uint32_t EspClass::getMinFreeHeap() { return nativeMinFreeHeap(); }
+uint32_t EspClass::getCpuFreqMHz() { return cpuMhz; }
+
+unsigned long millis() { return NativeHal::micros() / 1000; }
+unsigned long micros() { return NativeHal::micros(); }
+void delay(uint32_t ms) { NativeHal::advance((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { NativeHal::advance(us); }
+void yield() {}
+
+/**
+ * @brief Sets the CPU clock, which only changes the idle current in the
+ * energy model.
+ * @return False for a clock the ESP32-C3 does not run at.
+ */
+bool setCpuFrequencyMhz(uint32_t mhz) {
+  if (mhz != 160 && mhz != 80 && mhz != 40 && mhz != 20 && mhz != 10)
+    return false;
+  cpuMhz = mhz;
+  return true;
+}
+
+uint32_t getCpuFrequencyMhz() { return cpuMhz; }
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+/**
+ * @brief Drives a pin. A rising edge on the TPL5110 DONE pin cuts power,
+ * which ends the wake.
+ */
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin >= NATIVE_PIN_COUNT)
+    return;
+  bool risingEdge = pinLevels[pin] == LOW && value == HIGH;
+  pinLevels[pin] = value;
+  if (pin == NATIVE_POWER_OFF_PIN && risingEdge)
+    NativeHal::powerOff();
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < NATIVE_PIN_COUNT ? pinLevels[pin] : LOW;
+}
+
+/**
+ * @brief Returns a noisy level taken from the trace or the environment. Also
+ * used by the continuous ADC stand-in.
+ * @param pin The ADC pin.
+ * @return The level in millivolts.
+ */
+uint32_t nativeAdcMilliVolts(uint8_t pin) {
+  long noise = NativeHal::envLong("STACY_ADC_NOISE_MV", 12);
+  long centre;
+  double recorded;
+  if (pin == A1) {
+    // Battery behind the 1/2 divider
+    centre = NativeHal::traceValue(TRACE_BATTERY_MV, recorded)
+                 ? recorded
+                 : NativeHal::envLong("STACY_BATTERY_MV", 3700);
+    centre /= 2;
+  } else {
+    centre = NativeHal::traceValue(TRACE_MOISTURE_MV, recorded)
+                 ? recorded
+                 : NativeHal::envLong("STACY_MOISTURE_MV", 2200);
+  }
+  long sample = centre + (noise ? rand() % (2 * noise + 1) - noise : 0);
+  // Occasional spikes, as from the Wi-Fi radio or a switching regulator
+  if (rand() % 1000 < NativeHal::envLong("STACY_ADC_SPIKE_PERMILLE", 20)) {
+    long spike = NativeHal::envLong("STACY_ADC_SPIKE_MV", 250);
+    sample += rand() % 2 ? spike : -spike;
+  }
+  if (sample < 0)
+    return 0;
+  return sample > NATIVE_ADC_FULL_SCALE_MV ? NATIVE_ADC_FULL_SCALE_MV : sample;
+}
+
+/**
+ * @brief Runs a one-shot conversion, which blocks for STACY_ADC_US.
+ * @param pin The ADC pin.
+ * @return The sample in millivolts.
+ */
+static uint32_t sampleMilliVolts(uint8_t pin) {
+  uint32_t conversionUs = NativeHal::envLong("STACY_ADC_US", 40);
+  NativeHal::advance(conversionUs);
+  EnergyModel::consume(RAIL_ADC, conversionUs);
+  return nativeAdcMilliVolts(pin);
+}
+
+uint16_t analogRead(uint8_t pin) {
+  return sampleMilliVolts(pin) * 4095 / NATIVE_ADC_FULL_SCALE_MV;
+}
+
+int8_t digitalPinToAnalogChannel(uint8_t pin) { return pin <= A4 ? pin : -1; }
+
+uint32_t analogReadMilliVolts(uint8_t pin) { return sampleMilliVolts(pin); }
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin)
+    return outMin;
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+long random(long max) { return max > 0 ? rand() % max : 0; }
+
+long random(long min, long max) {
+  return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) { srand(seed); }
@@ -0,0 +1,91 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "IPAddress.h"
+#include "NativeHal.h"
+#include "Print.h"
+#include "WString.h"
+
+// RTC memory is one section, which NativeHal keeps across deep sleep only.
+// Like a TPL5110 power cut, any other end of a wake clears it.
+#define RTC_DATA_ATTR __attribute__((section("native_rtc")))
+#define RTC_NOINIT_ATTR __attribute__((section("native_rtc")))
+#define IRAM_ATTR
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define A0 0
+#define A1 1
+#define A2 2
+#define A3 3
+#define A4 4
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) {}
+  void setDebugOutput(bool enabled) {}
+  void flush() { fflush(stdout); }
+  operator bool() const { return true; }
+  size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    return fwrite(buffer, 1, size, stdout);
+  }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  void restart() { NativeHal::restart(); }
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getCpuFreqMHz();
+};
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+// The native analog pins are numbered after their ADC1 channel
+int8_t digitalPinToAnalogChannel(uint8_t pin);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+template <typename T, typename L, typename H>
+auto constrain(T x, L low, H high) -> decltype(x + low + high) {
+  return x < low ? low : (x > high ? high : x);
+}
+
+using std::max;
+using std::min;
+
+#endif
@@ -0,0 +1,57 @@
+#include "BME280I2C.h"
+#include "EnergyModel.h"
+
+#define I2C_TRANSACTION_US 300
+// Forced conversion of temperature, pressure and humidity at 1x
+#define CONVERSION_US 8000
+// Absolute accuracy class of the BME280, much coarser than the HDC3022
+#define NOISE_C 0.1
+
+/**
+ * @brief Spends time on the I2C bus or waiting for a conversion.
+ */
+static void busy(uint64_t micros) {
+  NativeHal::advance(micros);
+  EnergyModel::consume(RAIL_I2C, micros);
+}
+
+bool BME280I2C::begin() {
+  // Chip ID, then the calibration registers
+  busy(3 * I2C_TRANSACTION_US);
+  model = NativeHal::envLong("STACY_BME280", 0) ? ChipModel_BME280
+                                                : ChipModel_UNKNOWN;
+  return model != ChipModel_UNKNOWN;
+}
+
+void BME280I2C::setSettings(const Settings &settings) {
+  busy(2 * I2C_TRANSACTION_US);
+  readyAt = NativeHal::micros() + CONVERSION_US;
+  EnergyModel::consume(RAIL_I2C, CONVERSION_US);
+}
+
+void BME280I2C::read(float &pressure, float &temperature, float &humidity,
+                     TempUnit tempUnit, PresUnit presUnit) {
+  if (model == ChipModel_UNKNOWN) {
+    pressure = temperature = humidity = NAN;
+    return;
+  }
+  uint64_t now = NativeHal::micros();
+  if (readyAt == 0) {
+    busy(CONVERSION_US);
+  } else if (now < readyAt) {
+    NativeHal::advance(readyAt - now);
+  }
+  readyAt = 0;
+  busy(2 * I2C_TRANSACTION_US);
+
+  double airTemperature, airHumidity;
+  NativeHal::conditions(NativeHal::wake(), airTemperature, airHumidity);
+  double noise = NOISE_C * (rand() % 201 - 100) / 100.0;
+  temperature = airTemperature + noise;
+  humidity = airHumidity + noise * 10;
+  pressure = 1013.25 + noise;
+  if (tempUnit == TempUnit_Fahrenheit)
+    temperature = temperature * 9 / 5 + 32;
+  if (presUnit == PresUnit_Pa)
+    pressure *= 100;
+}
@@ -0,0 +1,40 @@
+#ifndef BME280I2C_H
+#define BME280I2C_H
+
+#include "Arduino.h"
+
+// Subset of the finitespace/BME280 interface used by the firmware.
+class BME280 {
+public:
+  enum TempUnit { TempUnit_Celsius, TempUnit_Fahrenheit };
+  enum PresUnit { PresUnit_Pa, PresUnit_hPa };
+  enum ChipModel {
+    ChipModel_UNKNOWN = 0,
+    ChipModel_BMP280 = 0x58,
+    ChipModel_BME280 = 0x60
+  };
+};
+
+// BME280 stand-in in forced mode at 1x oversampling. Readings follow the
+// same conditions as the HDC3022 stand-in, with a coarser noise, and the
+// sensor is absent unless STACY_BME280 is set. setSettings() starts a
+// conversion; read() waits for whatever is left of it, or for a whole one.
+class BME280I2C : public BME280 {
+private:
+  ChipModel model = ChipModel_UNKNOWN;
+  uint64_t readyAt = 0;
+
+public:
+  // Only the defaults are modelled
+  struct Settings {};
+
+  BME280I2C(const Settings &settings = Settings()) {}
+  bool begin();
+  void setSettings(const Settings &settings);
+  ChipModel chipModel() { return model; }
+  void read(float &pressure, float &temperature, float &humidity,
+            TempUnit tempUnit = TempUnit_Celsius,
+            PresUnit presUnit = PresUnit_hPa);
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include "Print.h"
+#include <stddef.h>
+#include <stdint.h>
+
+class Client : public Print {
+public:
+  virtual int connect(const char *host, uint16_t port) = 0;
+  virtual uint8_t connected() = 0;
+  virtual void stop() = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t *buffer, size_t size) = 0;
+  virtual void flush() {}
+  using Print::write;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef ESPMDNS_H
+#define ESPMDNS_H
+
+#include "Arduino.h"
+
+class MDNSResponder {
+public:
+  bool begin(const char *hostName) { return true; }
+  void addService(const char *service, const char *protocol, uint16_t port) {}
+};
+
+extern MDNSResponder MDNS;
+
+#endif
@@ -0,0 +1,193 @@
+#include "EnergyModel.h"
+#include "Arduino.h"
+#include "NativeHal.h"
+#include "configuration.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// 802.11 + IP + TCP headers per frame and payload per segment
+#define FRAME_OVERHEAD_BYTES 66
+#define SEGMENT_BYTES 1460
+#define MICROS_PER_HOUR 3.6e9
+
+static const char *const railNames[RAIL_COUNT] = {
+    "cpu", "cpu idle", "radio rx", "radio tx", "adc", "i2c", "off", "sleep"};
+
+double EnergyModel::charge[RAIL_COUNT];
+bool EnergyModel::radioOn = false;
+uint64_t EnergyModel::radioOnSince = 0;
+uint64_t EnergyModel::idleMicros = 0;
+EnergyTotals *EnergyModel::totals = nullptr;
+
+/**
+ * @brief Current drawn by a rail, in mA. Defaults are typical ESP32-C3,
+ * HDC3022 and TPL5110 datasheet figures; deep sleep is the figure given
+ * for the whole XIAO ESP32C3 board, regulator included.
+ */
+static double railCurrent(EnergyRail rail) {
+  switch (rail) {
+  case RAIL_CPU:
+    return NativeHal::envLong("STACY_CPU_UA", 22000) / 1000.0;
+  case RAIL_CPU_IDLE:
+    // Modem-sleep figures of the ESP32-C3 waiting for an interrupt
+    return getCpuFrequencyMhz() < 160
+               ? NativeHal::envLong("STACY_IDLE_80_UA", 13000) / 1000.0
+               : NativeHal::envLong("STACY_IDLE_UA", 16000) / 1000.0;
+  case RAIL_RADIO_RX:
+    return NativeHal::envLong("STACY_RX_UA", 62000) / 1000.0;
+  case RAIL_RADIO_TX:
+    return NativeHal::envLong("STACY_TX_UA", 258000) / 1000.0;
+  case RAIL_ADC:
+    return NativeHal::envLong("STACY_ADC_UA", 1000) / 1000.0;
+  case RAIL_I2C:
+    return NativeHal::envLong("STACY_I2C_UA", 700) / 1000.0;
+  case RAIL_SLEEP:
+    return NativeHal::envLong("STACY_SLEEP_UA", 44) / 1000.0;
+  default:
+    return NativeHal::envLong("STACY_OFF_NA", 35) / 1e6;
+  }
+}
+
+static double toMicroAmpHours(double chargeMilliAmpMicros) {
+  return chargeMilliAmpMicros / MICROS_PER_HOUR * 1000.0;
+}
+
+/**
+ * @brief Allocates the totals in memory shared with the wake processes.
+ */
+void EnergyModel::begin() {
+  void *memory = mmap(nullptr, sizeof(EnergyTotals), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    return;
+  totals = (EnergyTotals *)memory;
+  memset(totals, 0, sizeof(EnergyTotals));
+}
+
+void EnergyModel::consume(EnergyRail rail, uint64_t micros) {
+  charge[rail] += railCurrent(rail) * micros;
+}
+
+/**
+ * @brief Charges time the CPU spent blocked on an event, at the clock it
+ * runs at now, instead of the CPU running current.
+ * @param micros The idle time.
+ */
+void EnergyModel::idle(uint64_t micros) {
+  idleMicros += micros;
+  consume(RAIL_CPU_IDLE, micros);
+}
+
+void EnergyModel::radioStart() {
+  if (radioOn)
+    return;
+  radioOn = true;
+  radioOnSince = NativeHal::micros();
+}
+
+void EnergyModel::radioStop() {
+  if (!radioOn)
+    return;
+  radioOn = false;
+  consume(RAIL_RADIO_RX, NativeHal::micros() - radioOnSince);
+}
+
+/**
+ * @brief Charges the airtime of outgoing frames at STACY_PHY_KBPS.
+ * @param bytes The payload bytes.
+ * @param frames The number of frames carrying them.
+ */
+void EnergyModel::transmit(size_t bytes, uint32_t frames) {
+  double bits = 8.0 * (bytes + (double)frames * FRAME_OVERHEAD_BYTES);
+  consume(RAIL_RADIO_TX,
+          bits * 1000.0 / NativeHal::envLong("STACY_PHY_KBPS", 24000));
+}
+
+/**
+ * @brief Charges outgoing TCP segments.
+ */
+void EnergyModel::sent(size_t bytes) {
+  transmit(bytes, (bytes + SEGMENT_BYTES - 1) / SEGMENT_BYTES);
+}
+
+/**
+ * @brief Charges the TCP acknowledgements of incoming bytes.
+ */
+void EnergyModel::received(size_t bytes) {
+  transmit(0, (bytes + SEGMENT_BYTES - 1) / SEGMENT_BYTES);
+}
+
+/**
+ * @brief Gets the charge used so far in this wake, for benchmarks.
+ * @return The charge in uAh, the CPU and a listening radio included.
+ */
+double EnergyModel::charged() {
+  uint64_t now = NativeHal::micros();
+  double total = railCurrent(RAIL_CPU) * now;
+  if (radioOn)
+    total += railCurrent(RAIL_RADIO_RX) * (now - radioOnSince);
+  for (int rail = 0; rail < RAIL_COUNT; rail++)
+    total += charge[rail];
+  return toMicroAmpHours(total);
+}
+
+/**
+ * @brief Closes the books on a wake: CPU for its whole duration, the
+ * radio until now, and the idle state until the next wake.
+ * @param wakeMicros The simulated duration of the wake.
+ * @param idle RAIL_OFF after a TPL5110 power cut, RAIL_SLEEP after deep
+ * sleep.
+ */
+void EnergyModel::endWake(uint64_t wakeMicros, EnergyRail idle) {
+  radioStop();
+  consume(RAIL_CPU, wakeMicros - std::min(idleMicros, wakeMicros));
+  consume(idle, TIME_TO_SLEEP * 1000000ULL);
+
+  double total = 0;
+  printf("[energy] Wake %u:", NativeHal::wake());
+  for (int rail = 0; rail < RAIL_COUNT; rail++) {
+    total += charge[rail];
+    printf(" %s %.4f", railNames[rail], toMicroAmpHours(charge[rail]));
+  }
+  printf(", total %.4f uAh\n", toMicroAmpHours(total));
+
+  if (!totals)
+    return;
+  totals->wakes++;
+  totals->awakeMicros += wakeMicros;
+  totals->idleMicros += idleMicros;
+  for (int rail = 0; rail < RAIL_COUNT; rail++)
+    totals->charge[rail] += charge[rail];
+}
+
+/**
+ * @brief Prints the mean charge per wake and the battery life it gives
+ * on BATTERY_CAPACITY_MAH, with one wake every TIME_TO_SLEEP seconds.
+ */
+void EnergyModel::report() {
+  if (!totals || totals->wakes == 0)
+    return;
+
+  double total = 0;
+  printf("[energy] Mean over %u wakes (uAh per wake):\n", totals->wakes);
+  for (int rail = 0; rail < RAIL_COUNT; rail++) {
+    double perWake = toMicroAmpHours(totals->charge[rail]) / totals->wakes;
+    total += perWake;
+    printf("  %-9s %10.4f\n", railNames[rail], perWake);
+  }
+  double awakeMs = totals->awakeMicros / totals->wakes / 1000.0;
+  double idleMs = totals->idleMicros / totals->wakes / 1000.0;
+  double cycleHours = (awakeMs / 1000.0 + TIME_TO_SLEEP) / 3600.0;
+  double averageMilliAmps = total / 1000.0 / cycleHours;
+  double lifeHours = BATTERY_CAPACITY_MAH / averageMilliAmps;
+
+  printf("  %-9s %10.4f (%.6f mAh)\n", "total", total, total / 1000.0);
+  printf("[energy] Awake %.1f ms (CPU idle %.1f ms) per %d s cycle, "
+         "average %.3f mA\n",
+         awakeMs, idleMs, TIME_TO_SLEEP, averageMilliAmps);
+  printf("[energy] Projected life on %d mAh (%.1f V to %.1f V): %.1f days\n",
+         BATTERY_CAPACITY_MAH, BATTERY_MAX, BATTERY_MIN, lifeHours / 24.0);
+}
@@ -0,0 +1,55 @@
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  RAIL_CPU,
+  RAIL_CPU_IDLE, // blocked on an event, at the current CPU clock
+  RAIL_RADIO_RX,
+  RAIL_RADIO_TX,
+  RAIL_ADC,
+  RAIL_I2C,
+  RAIL_OFF,   // TPL5110 power cut
+  RAIL_SLEEP, // deep sleep
+  RAIL_COUNT
+} EnergyRail;
+
+// Charge used by the wakes run so far, shared with the parent process.
+typedef struct EnergyTotals {
+  uint32_t wakes;
+  double awakeMicros;
+  double idleMicros;
+  double charge[RAIL_COUNT]; // mA x us
+} EnergyTotals;
+
+// Per-peripheral current model. The CPU draws for the whole wake, at the
+// idle current while the firmware blocks on an event (delay() still counts
+// as running), the radio listens from WiFi.begin() until it is turned off,
+// and the other rails draw while the matching stand-in spends simulated
+// time. Currents are added on top of the CPU and can be overridden with
+// STACY_*_UA.
+class EnergyModel {
+private:
+  static double charge[RAIL_COUNT];
+  static bool radioOn;
+  static uint64_t radioOnSince;
+  static uint64_t idleMicros;
+  static EnergyTotals *totals;
+
+public:
+  static void begin();
+  static void consume(EnergyRail rail, uint64_t micros);
+  static void idle(uint64_t micros);
+  static void radioStart();
+  static void radioStop();
+  static void transmit(size_t bytes, uint32_t frames);
+  static void sent(size_t bytes);
+  static void received(size_t bytes);
+  static double charged();
+  static void endWake(uint64_t wakeMicros, EnergyRail idle);
+  static void report();
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "EnvironmentCalculations.h"
+
+#include <math.h>
+
+namespace EnvironmentCalculations {
+
+/**
+ * @brief Magnus formula with the Alduchov and Eskridge coefficients.
+ */
+float DewPoint(float temp, float hum, TempUnit tempUnit) {
+  float celsius =
+      tempUnit == TempUnit_Celsius ? temp : (temp - 32.0) * 5.0 / 9.0;
+  float gamma = log(hum / 100.0) + (17.625 * celsius) / (243.04 + celsius);
+  float dewPoint = 243.04 * gamma / (17.625 - gamma);
+  return tempUnit == TempUnit_Celsius ? dewPoint : dewPoint * 9.0 / 5.0 + 32.0;
+}
+
+/**
+ * @brief NWS heat index: Steadman's simple formula, then the Rothfusz
+ * regression and its adjustments above 79 °F.
+ */
+float HeatIndex(float temperature, float humidity, TempUnit tempUnit) {
+  if (isnan(temperature) || isnan(humidity))
+    return NAN;
+
+  float t = tempUnit == TempUnit_Celsius ? temperature * 9.0 / 5.0 + 32.0
+                                         : temperature;
+  float heatIndex = t;
+
+  if (t > 40) {
+    heatIndex = 0.5 * (t + 61.0 + ((t - 68.0) * 1.2) + (humidity * 0.094));
+    if (heatIndex >= 79) {
+      heatIndex = -42.379 + 2.04901523 * t + 10.14333127 * humidity -
+                  0.22475541 * t * humidity - 0.00683783 * t * t -
+                  0.05481717 * humidity * humidity +
+                  0.00122874 * t * t * humidity +
+                  0.00085282 * t * humidity * humidity -
+                  0.00000199 * t * t * humidity * humidity;
+      if (humidity < 13 && t >= 80.0 && t <= 112.0) {
+        heatIndex -= ((13.0 - humidity) * 0.25) *
+                     sqrt((17.0 - fabs(t - 95.0)) * 0.05882);
+      } else if (humidity > 85.0 && t >= 80.0 && t <= 87.0) {
+        heatIndex += 0.02 * (humidity - 85.0) * (87.0 - t);
+      }
+    }
+  }
+
+  return tempUnit == TempUnit_Celsius ? (heatIndex - 32.0) * 5.0 / 9.0
+                                      : heatIndex;
+}
+
+} // namespace EnvironmentCalculations
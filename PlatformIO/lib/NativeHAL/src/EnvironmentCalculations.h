@@ -0,0 +1,16 @@
+#ifndef ENVIRONMENT_CALCULATIONS_H
+#define ENVIRONMENT_CALCULATIONS_H
+
+// Subset of the finitespace/BME280 EnvironmentCalculations used by the
+// firmware, with the same formulas.
+namespace EnvironmentCalculations {
+
+enum TempUnit { TempUnit_Celsius, TempUnit_Fahrenheit };
+
+float DewPoint(float temp, float hum, TempUnit tempUnit = TempUnit_Celsius);
+float HeatIndex(float temperature, float humidity,
+                TempUnit tempUnit = TempUnit_Celsius);
+
+} // namespace EnvironmentCalculations
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FS_H
+#define FS_H
+
+#include "WString.h"
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+class FileImpl;
+
+// Handle to an open file or directory, shared by its copies like the
+// Arduino one.
+class File {
+private:
+  std::shared_ptr<FileImpl> impl;
+
+public:
+  File() {}
+  explicit File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+  size_t write(const uint8_t *data, size_t size);
+  size_t write(uint8_t data) { return write(&data, 1); }
+  size_t read(uint8_t *data, size_t size);
+  bool seek(uint32_t position);
+  size_t position() const;
+  size_t size() const;
+  void flush() {}
+  void close();
+  const char *name() const;
+  bool isDirectory() const;
+  File openNextFile(const char *mode = FILE_READ);
+  operator bool() const;
+};
+
+// Filesystem mapped onto a host directory.
+class FS {
+protected:
+  std::string root;
+  std::string hostPath(const char *path) const;
+
+public:
+  File open(const char *path, const char *mode = FILE_READ,
+            bool create = false);
+  File open(const String &path, const char *mode = FILE_READ,
+            bool create = false) {
+    return open(path.c_str(), mode, create);
+  }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *pathFrom, const char *pathTo);
+  bool rename(const String &pathFrom, const String &pathTo) {
+    return rename(pathFrom.c_str(), pathTo.c_str());
+  }
+  bool mkdir(const char *path);
+  bool mkdir(const String &path) { return mkdir(path.c_str()); }
+  bool rmdir(const char *path);
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
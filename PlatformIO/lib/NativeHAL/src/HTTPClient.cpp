@@ -0,0 +1,187 @@
+#include "HTTPClient.h"
+#include "NativeHal.h"
+
+#include <stdlib.h>
+#include <strings.h>
+
+/**
+ * @brief Parses the URL and remembers the client. The connection is only
+ * opened by the first request if the client is not already connected.
+ */
+bool HTTPClient::begin(Client &client, const String &url) {
+  this->client = &client;
+  requestHeaders = String();
+  response = String();
+  canReuse = reuse;
+
+  String rest = url;
+  bool secure = rest.startsWith("https://");
+  port = secure ? 443 : 80;
+  int schemeEnd = rest.indexOf("://");
+  if (schemeEnd >= 0)
+    rest = rest.substring(schemeEnd + 3);
+
+  int pathStart = rest.indexOf('/');
+  host = pathStart >= 0 ? rest.substring(0, pathStart) : rest;
+  path = pathStart >= 0 ? rest.substring(pathStart) : String("/");
+
+  int portStart = host.indexOf(':');
+  if (portStart >= 0) {
+    port = host.substring(portStart + 1).toInt();
+    host = host.substring(0, portStart);
+  }
+  return host.length() > 0;
+}
+
+void HTTPClient::end() {
+  if (client && (!reuse || !canReuse))
+    client->stop();
+  requestHeaders = String();
+}
+
+void HTTPClient::addHeader(const String &name, const String &value,
+                           bool first, bool replace) {
+  requestHeaders += name + ": " + value + "\r\n";
+}
+
+void HTTPClient::collectHeaders(const char *headerKeys[],
+                                const size_t headerKeysCount) {
+  collectKeys.clear();
+  for (size_t i = 0; i < headerKeysCount; i++)
+    collectKeys.push_back(headerKeys[i]);
+}
+
+String HTTPClient::header(const char *name) {
+  for (size_t i = 0; i < collectKeys.size() && i < collectValues.size(); i++) {
+    if (strcasecmp(collectKeys[i].c_str(), name) == 0)
+      return collectValues[i];
+  }
+  return String();
+}
+
+bool HTTPClient::readLine(String &line) {
+  line = String();
+  while (true) {
+    int c = client->read();
+    if (c < 0)
+      return false;
+    if (c == '\n')
+      break;
+    if (c != '\r')
+      line += (char)c;
+  }
+  return true;
+}
+
+bool HTTPClient::readBody(int contentLength, bool chunked) {
+  char chunk[512];
+  if (chunked) {
+    String line;
+    while (readLine(line)) {
+      long size = strtol(line.c_str(), nullptr, 16);
+      if (size == 0)
+        return readLine(line);
+      while (size > 0) {
+        int count = client->read((uint8_t *)chunk,
+                                 size < (long)sizeof(chunk) ? size
+                                                            : sizeof(chunk));
+        if (count <= 0)
+          return false;
+        response.concat(chunk, count);
+        size -= count;
+      }
+      readLine(line);
+    }
+    return false;
+  }
+
+  while (contentLength != 0) {
+    size_t wanted = contentLength < 0 || contentLength > (int)sizeof(chunk)
+                        ? sizeof(chunk)
+                        : contentLength;
+    int count = client->read((uint8_t *)chunk, wanted);
+    if (count <= 0)
+      return contentLength < 0;
+    response.concat(chunk, count);
+    if (contentLength > 0)
+      contentLength -= count;
+  }
+  return true;
+}
+
+int HTTPClient::sendRequest(const char *method, const uint8_t *payload,
+                            size_t size) {
+  if (!client)
+    return HTTPC_ERROR_NOT_CONNECTED;
+  if (!client->connected() && !client->connect(host.c_str(), port))
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+
+  String request = String(method) + " " + path + " HTTP/1.1\r\n" +
+                   "Host: " + host + "\r\n" +
+                   "User-Agent: ESP32HTTPClient\r\n" +
+                   "Connection: " + (reuse ? "keep-alive" : "close") + "\r\n" +
+                   "Content-Length: " + String((unsigned long)size) + "\r\n" +
+                   requestHeaders + "\r\n";
+  if (client->write((const uint8_t *)request.c_str(), request.length()) !=
+          request.length() ||
+      (size && client->write(payload, size) != size))
+    return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+
+  NativeHal::stats.httpRequests++;
+  NativeHal::advance(NativeHal::envLong("STACY_RTT_MS", 60) * 1000);
+
+  String line;
+  if (!readLine(line))
+    return HTTPC_ERROR_READ_TIMEOUT;
+  int space = line.indexOf(' ');
+  int code = space >= 0 ? line.substring(space + 1).toInt() : 0;
+  if (code <= 0)
+    return HTTPC_ERROR_CONNECTION_LOST;
+
+  int contentLength = -1;
+  bool chunked = false;
+  collectValues.assign(collectKeys.size(), String());
+  while (readLine(line) && line.length() > 0) {
+    int colon = line.indexOf(':');
+    if (colon < 0)
+      continue;
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (strcasecmp(name.c_str(), "Content-Length") == 0)
+      contentLength = value.toInt();
+    else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0)
+      chunked = strcasecmp(value.c_str(), "chunked") == 0;
+    else if (strcasecmp(name.c_str(), "Connection") == 0)
+      canReuse = strcasecmp(value.c_str(), "close") != 0;
+    for (size_t i = 0; i < collectKeys.size(); i++) {
+      if (strcasecmp(collectKeys[i].c_str(), name.c_str()) == 0)
+        collectValues[i] = value;
+    }
+  }
+
+  // Without a length the body runs until the server closes the connection
+  if (contentLength < 0 && !chunked)
+    canReuse = false;
+  response = String();
+  if (!readBody(contentLength, chunked))
+    return HTTPC_ERROR_CONNECTION_LOST;
+  return code;
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+  case HTTPC_ERROR_CONNECTION_REFUSED:
+    return "connection refused";
+  case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+    return "send payload failed";
+  case HTTPC_ERROR_NOT_CONNECTED:
+    return "not connected";
+  case HTTPC_ERROR_CONNECTION_LOST:
+    return "connection lost";
+  case HTTPC_ERROR_READ_TIMEOUT:
+    return "read Timeout";
+  default:
+    return String();
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include "Client.h"
+#include "WString.h"
+#include <vector>
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_CREATED 201
+#define HTTP_CODE_NO_CONTENT 204
+#define HTTP_CODE_BAD_REQUEST 400
+#define HTTP_CODE_UNAUTHORIZED 401
+#define HTTP_CODE_FORBIDDEN 403
+#define HTTP_CODE_NOT_FOUND 404
+#define HTTP_CODE_PAYLOAD_TOO_LARGE 413
+#define HTTP_CODE_UNSUPPORTED_MEDIA_TYPE 415
+#define HTTP_CODE_INTERNAL_SERVER_ERROR 500
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// HTTP/1.1 client with keep-alive, speaking plain HTTP over the Client.
+// Each request costs STACY_RTT_MS of simulated round trip.
+class HTTPClient {
+private:
+  Client *client = nullptr;
+  String host;
+  uint16_t port = 80;
+  String path;
+  bool reuse = true;
+  bool canReuse = false;
+  String requestHeaders;
+  std::vector<String> collectKeys;
+  std::vector<String> collectValues;
+  String response;
+  bool readLine(String &line);
+  bool readBody(int contentLength, bool chunked);
+  int sendRequest(const char *method, const uint8_t *payload, size_t size);
+
+public:
+  ~HTTPClient() { end(); }
+  bool begin(Client &client, const String &url);
+  void end();
+  void setReuse(bool reuse) { this->reuse = reuse; }
+  void setTimeout(uint16_t timeout) {}
+  void setConnectTimeout(int32_t timeout) {}
+  void addHeader(const String &name, const String &value, bool first = false,
+                 bool replace = true);
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+  String header(const char *name);
+  bool connected() { return client && client->connected(); }
+
+  int GET() { return sendRequest("GET", nullptr, 0); }
+  int POST(const uint8_t *payload, size_t size) {
+    return sendRequest("POST", payload, size);
+  }
+  int POST(uint8_t *payload, size_t size) {
+    return sendRequest("POST", payload, size);
+  }
+  int POST(const String &payload) {
+    return POST((const uint8_t *)payload.c_str(), payload.length());
+  }
+  String getString() { return response; }
+  int getSize() { return response.length(); }
+  static String errorToString(int error);
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+
+#include "Print.h"
+#include "WString.h"
+#include <stdint.h>
+
+class IPAddress : public Printable {
+private:
+  uint8_t octets[4];
+
+public:
+  IPAddress() : octets{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+  // Same byte order as the ESP32 core: first octet in the low byte
+  IPAddress(uint32_t address)
+      : octets{(uint8_t)address, (uint8_t)(address >> 8),
+               (uint8_t)(address >> 16), (uint8_t)(address >> 24)} {}
+  operator uint32_t() const {
+    return octets[0] | octets[1] << 8 | octets[2] << 16 |
+           (uint32_t)octets[3] << 24;
+  }
+  uint8_t operator[](int index) const { return octets[index]; }
+  bool operator==(const IPAddress &other) const {
+    return (uint32_t)*this == (uint32_t)other;
+  }
+  String toString() const {
+    return String(octets[0]) + "." + String(octets[1]) + "." +
+           String(octets[2]) + "." + String(octets[3]);
+  }
+  size_t printTo(Print &p) const override { return p.print(toString()); }
+};
+
+extern const IPAddress INADDR_NONE;
+
+#endif
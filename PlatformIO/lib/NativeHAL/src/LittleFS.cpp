@@ -0,0 +1,216 @@
+#include "LittleFS.h"
+#include "NativeHal.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Rough LittleFS on SPI flash costs
+#define FS_MOUNT_US 8000
+#define FS_OPEN_US 600
+#define FS_COMMIT_US 3000 // closing a written file programs its metadata
+#define FS_WRITE_BYTES_PER_US 8
+#define FS_READ_BYTES_PER_US 32
+
+fs::LittleFSFS LittleFS;
+
+static uint32_t bytesWrittenThisWake = 0;
+static bool writeFailed = false;
+
+namespace fs {
+
+class FileImpl {
+public:
+  FILE *file = nullptr;
+  DIR *directory = nullptr;
+  std::string hostPath;
+  std::string name;
+  bool written = false;
+
+  ~FileImpl() { close(); }
+
+  void close() {
+    if (file) {
+      fclose(file);
+      if (written)
+        NativeHal::advance(FS_COMMIT_US);
+    }
+    if (directory)
+      closedir(directory);
+    file = nullptr;
+    directory = nullptr;
+  }
+};
+
+static std::shared_ptr<FileImpl> openHost(const std::string &hostPath,
+                                          const char *mode) {
+  NativeHal::advance(FS_OPEN_US);
+  auto impl = std::make_shared<FileImpl>();
+  impl->hostPath = hostPath;
+  const char *slash = strrchr(hostPath.c_str(), '/');
+  impl->name = slash ? slash + 1 : hostPath;
+
+  struct stat info;
+  if (stat(hostPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+    impl->directory = opendir(hostPath.c_str());
+    return impl->directory ? impl : nullptr;
+  }
+  std::string hostMode = std::string(mode) + "b";
+  impl->file = fopen(hostPath.c_str(), hostMode.c_str());
+  return impl->file ? impl : nullptr;
+}
+
+size_t File::write(const uint8_t *data, size_t size) {
+  if (!impl || !impl->file)
+    return 0;
+  long cutWake = NativeHal::envLong("STACY_FS_CUT_WAKE", -1);
+  long cutBytes = NativeHal::envLong("STACY_FS_CUT_BYTES", -1);
+  bool cut = cutWake == (long)NativeHal::wake() && cutBytes >= 0 &&
+             bytesWrittenThisWake + size > (uint32_t)cutBytes;
+  long failWake = NativeHal::envLong("STACY_FS_FAIL_WAKE", -1);
+  long failBytes = NativeHal::envLong("STACY_FS_FAIL_BYTES", -1);
+  bool fail = !cut && !writeFailed && failWake == (long)NativeHal::wake() &&
+              failBytes >= 0 &&
+              bytesWrittenThisWake + size > (uint32_t)failBytes;
+  size_t allowed = size;
+  if (cut)
+    allowed = cutBytes - bytesWrittenThisWake;
+  else if (fail)
+    allowed = failBytes - bytesWrittenThisWake;
+
+  size_t written = fwrite(data, 1, allowed, impl->file);
+  bytesWrittenThisWake += written;
+  NativeHal::stats.flashBytesWritten += written;
+  NativeHal::advance(written / FS_WRITE_BYTES_PER_US + 1);
+  impl->written = true;
+  if (cut) {
+    fflush(impl->file);
+    printf("[native] Power cut %ld bytes into this wake's flash writes.\n",
+           cutBytes);
+    NativeHal::powerOff();
+  }
+  if (fail) {
+    writeFailed = true;
+    printf("[native] Flash write failed %ld bytes into this wake's writes.\n",
+           failBytes);
+  }
+  return written;
+}
+
+size_t File::read(uint8_t *data, size_t size) {
+  if (!impl || !impl->file)
+    return 0;
+  size_t read = fread(data, 1, size, impl->file);
+  NativeHal::advance(read / FS_READ_BYTES_PER_US + 1);
+  return read;
+}
+
+bool File::seek(uint32_t position) {
+  return impl && impl->file && fseek(impl->file, position, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+  return impl && impl->file ? ftell(impl->file) : 0;
+}
+
+size_t File::size() const {
+  if (!impl || !impl->file)
+    return 0;
+  fflush(impl->file);
+  struct stat info;
+  return fstat(fileno(impl->file), &info) == 0 ? info.st_size : 0;
+}
+
+void File::close() {
+  if (impl)
+    impl->close();
+  impl.reset();
+}
+
+const char *File::name() const { return impl ? impl->name.c_str() : ""; }
+
+bool File::isDirectory() const { return impl && impl->directory; }
+
+File File::openNextFile(const char *mode) {
+  if (!impl || !impl->directory)
+    return File();
+  struct dirent *entry;
+  while ((entry = readdir(impl->directory))) {
+    if (entry->d_name[0] == '.')
+      continue;
+    return File(openHost(impl->hostPath + "/" + entry->d_name, mode));
+  }
+  return File();
+}
+
+File::operator bool() const { return impl && (impl->file || impl->directory); }
+
+std::string FS::hostPath(const char *path) const { return root + path; }
+
+File FS::open(const char *path, const char *mode, bool create) {
+  return File(openHost(hostPath(path), mode));
+}
+
+bool FS::exists(const char *path) {
+  struct stat info;
+  return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path) {
+  NativeHal::advance(FS_COMMIT_US);
+  return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+  NativeHal::advance(FS_COMMIT_US);
+  return ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  NativeHal::advance(FS_COMMIT_US);
+  return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char *path) {
+  return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+/**
+ * @brief Deletes everything under a host directory, and the directory.
+ */
+static void removeTree(const std::string &path) {
+  DIR *directory = opendir(path.c_str());
+  if (!directory) {
+    unlink(path.c_str());
+    return;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(directory))) {
+    if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+      removeTree(path + "/" + entry->d_name);
+  }
+  closedir(directory);
+  ::rmdir(path.c_str());
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath,
+                       uint8_t maxOpenFiles, const char *partitionLabel) {
+  if (mounted)
+    return true;
+  NativeHal::advance(FS_MOUNT_US);
+  const char *directory = NativeHal::envString("STACY_NVS_DIR", "native_nvs");
+  ::mkdir(directory, 0755);
+  root = std::string(directory) + "/littlefs";
+  ::mkdir(root.c_str(), 0755);
+  mounted = true;
+  return true;
+}
+
+bool LittleFSFS::format() {
+  removeTree(root);
+  return ::mkdir(root.c_str(), 0755) == 0;
+}
+
+} // namespace fs
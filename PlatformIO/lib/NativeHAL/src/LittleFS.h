@@ -0,0 +1,29 @@
+#ifndef LITTLEFS_H
+#define LITTLEFS_H
+
+#include "FS.h"
+
+namespace fs {
+
+// LittleFS stand-in, backed by <STACY_NVS_DIR>/littlefs. Unlike LittleFS,
+// writes are not atomic: STACY_FS_CUT_BYTES cuts power that many bytes
+// into the flash writes of wake STACY_FS_CUT_WAKE, leaving a torn file,
+// which is the worst case the firmware has to recover from. Likewise,
+// STACY_FS_FAIL_BYTES makes one write of wake STACY_FS_FAIL_WAKE come up
+// short there, as on a flash error, and the wake goes on.
+class LittleFSFS : public FS {
+private:
+  bool mounted = false;
+
+public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs",
+             uint8_t maxOpenFiles = 10, const char *partitionLabel = "spiffs");
+  void end() { mounted = false; }
+  bool format();
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,411 @@
+#include "NativeHal.h"
+#include "Arduino.h"
+#include "EnergyModel.h"
+#include "LittleFS.h"
+#include "Preferences.h"
+#include "configuration.h"
+
+#include <array>
+#include <malloc.h>
+#include <math.h>
+#include <new>
+#include <string>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define NATIVE_HEAP_SIZE (320 * 1024)
+#define EXIT_POWER_OFF 0
+#define EXIT_RESTART 3
+#define EXIT_TIMEOUT 4
+#define WAKES_PER_DAY 17280
+
+// The benchmark runs eight uplink batches from a freshly provisioned device
+#ifdef NATIVE_BENCHMARK
+#define NATIVE_DEFAULT_WAKES (8 * READING_BUFFER_FLUSH_COUNT)
+#define NATIVE_DEFAULT_PROVISION 2
+#else
+#define NATIVE_DEFAULT_WAKES 1
+#define NATIVE_DEFAULT_PROVISION 0
+#endif
+
+uint64_t NativeHal::wakeStartReal = 0;
+uint64_t NativeHal::skippedMicros = 0;
+uint32_t NativeHal::wakeIndex = 0;
+bool NativeHal::deepSleepWake = false;
+NativeTimer NativeHal::timers[NATIVE_TIMERS];
+NativeHalStats NativeHal::stats;
+
+static size_t heapUsed = 0;
+static size_t heapPeak = 0;
+
+// RTC_DATA_ATTR and RTC_NOINIT_ATTR variables, see Arduino.h. Weak, for
+// programs that have none.
+extern char __start_native_rtc[] __attribute__((weak));
+extern char __stop_native_rtc[] __attribute__((weak));
+
+static std::string rtcPath() {
+  return std::string(NativeHal::envString("STACY_NVS_DIR", "native_nvs")) +
+         "/rtc.bin";
+}
+
+/**
+ * @brief Restores RTC memory saved by deep sleep at the end of the previous
+ * wake. The file is consumed, so any other end of a wake loses it.
+ * @return True if the wake is a timer wake from deep sleep.
+ */
+static bool loadRtc() {
+  size_t size = __stop_native_rtc - __start_native_rtc;
+  std::string path = rtcPath();
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+  bool loaded = size > 0 && fread(__start_native_rtc, 1, size, file) == size &&
+                fgetc(file) == EOF;
+  fclose(file);
+  unlink(path.c_str());
+  if (!loaded && size > 0)
+    memset(__start_native_rtc, 0, size);
+  return loaded;
+}
+
+static void saveRtc() {
+  size_t size = __stop_native_rtc - __start_native_rtc;
+  mkdir(NativeHal::envString("STACY_NVS_DIR", "native_nvs"), 0755);
+  FILE *file = fopen(rtcPath().c_str(), "wb");
+  if (!file)
+    return;
+  if (size > 0)
+    fwrite(__start_native_rtc, 1, size, file);
+  fclose(file);
+}
+
+static uint64_t realMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+void NativeHal::beginWake(uint32_t index) {
+  wakeIndex = index;
+  wakeStartReal = realMicros();
+  skippedMicros = 0;
+  stats = NativeHalStats();
+  deepSleepWake = loadRtc();
+  srand(index + 1);
+}
+
+uint64_t NativeHal::micros() {
+  uint64_t now = realMicros() - wakeStartReal + skippedMicros;
+  if (now / 1000 > (uint64_t)envLong("STACY_MAX_WAKE_MS", 60000)) {
+    printf("[native] Wake %u exceeded STACY_MAX_WAKE_MS.\n", wakeIndex);
+    fflush(stdout);
+    _exit(EXIT_TIMEOUT);
+  }
+  return now;
+}
+
+/**
+ * @brief Skips simulated time, then fires the timers that came due.
+ * @param micros The time to skip.
+ */
+void NativeHal::advance(uint64_t micros) {
+  skippedMicros += micros;
+  for (NativeTimer &timer : timers) {
+    if (timer.callback && timer.at <= NativeHal::micros()) {
+      void (*callback)() = timer.callback;
+      timer.callback = nullptr;
+      callback();
+    }
+  }
+}
+
+/**
+ * @brief Stand-in for the CPU blocking until an event: skips time up to the
+ * next timer, or the whole time if none comes first, as CPU idle time.
+ * @param micros The longest time to wait.
+ */
+void NativeHal::idle(uint64_t micros) {
+  uint64_t now = NativeHal::micros();
+  for (const NativeTimer &timer : timers) {
+    if (timer.callback && timer.at < now + micros)
+      micros = timer.at > now ? timer.at - now : 0;
+  }
+  EnergyModel::idle(micros);
+  advance(micros);
+}
+
+/**
+ * @brief Calls a function once the simulated time reaches a point,
+ * replacing any earlier schedule of the same function.
+ * @param at The time, in us since reset.
+ * @param callback The function.
+ */
+void NativeHal::schedule(uint64_t at, void (*callback)()) {
+  cancel(callback);
+  for (NativeTimer &timer : timers) {
+    if (!timer.callback) {
+      timer.at = at;
+      timer.callback = callback;
+      return;
+    }
+  }
+}
+
+void NativeHal::cancel(void (*callback)()) {
+  for (NativeTimer &timer : timers) {
+    if (timer.callback == callback)
+      timer.callback = nullptr;
+  }
+}
+
+uint32_t NativeHal::wake() { return wakeIndex; }
+
+bool NativeHal::wokeFromDeepSleep() { return deepSleepWake; }
+
+long NativeHal::envLong(const char *name, long fallback) {
+  const char *value = getenv(name);
+  return value ? strtol(value, nullptr, 0) : fallback;
+}
+
+const char *NativeHal::envString(const char *name, const char *fallback) {
+  const char *value = getenv(name);
+  return value ? value : fallback;
+}
+
+/**
+ * @brief Reads this wake's line of the STACY_TRACE replay file. Lines are
+ * "temperature,humidity,moisture_mv,battery_mv" and repeat once exhausted;
+ * lines starting with # and empty fields are skipped.
+ * @param column The value to read.
+ * @param value Set to the recorded value, if any.
+ * @param wake The wake whose line to read.
+ * @return True if the trace has a value for this wake.
+ */
+bool NativeHal::traceValue(NativeTraceColumn column, double &value,
+                           uint32_t wake) {
+  static std::vector<std::array<double, TRACE_COLUMNS>> rows;
+  static bool loaded = false;
+  if (!loaded) {
+    loaded = true;
+    const char *path = envString("STACY_TRACE", nullptr);
+    FILE *file = path ? fopen(path, "r") : nullptr;
+    char line[256];
+    while (file && fgets(line, sizeof(line), file)) {
+      if (line[0] == '#')
+        continue;
+      std::array<double, TRACE_COLUMNS> row;
+      row.fill(NAN);
+      char *cursor = line;
+      for (int i = 0; i < TRACE_COLUMNS && *cursor; i++) {
+        char *end;
+        double parsed = strtod(cursor, &end);
+        if (end != cursor)
+          row[i] = parsed;
+        cursor = strchr(end, ',');
+        if (!cursor)
+          break;
+        cursor++;
+      }
+      rows.push_back(row);
+    }
+    if (file)
+      fclose(file);
+  }
+
+  if (rows.empty())
+    return false;
+  double recorded = rows[wake % rows.size()][column];
+  if (isnan(recorded))
+    return false;
+  value = recorded;
+  return true;
+}
+
+/**
+ * @brief Recorded or simulated air conditions, without sensor noise: the
+ * STACY_TRACE values, or a daily cycle around STACY_TEMP_C and STACY_RH.
+ * @param wake The wake, with a fraction for points between wakes.
+ */
+void NativeHal::conditions(double wake, double &temperature,
+                           double &humidity) {
+  if (traceValue(TRACE_TEMPERATURE, temperature, (uint32_t)wake) &&
+      traceValue(TRACE_HUMIDITY, humidity, (uint32_t)wake))
+    return;
+
+  double phase =
+      2 * M_PI * wake / envLong("STACY_WAKES_PER_DAY", WAKES_PER_DAY);
+  temperature = envLong("STACY_TEMP_C", 22) + 3 * sin(phase);
+  humidity = envLong("STACY_RH", 45) - 8 * sin(phase);
+}
+
+/**
+ * @brief Ends the wake process, printing its counters.
+ * @param how What ended the wake.
+ * @param idle The rail drawing until the next wake.
+ */
+void NativeHal::endWake(const char *how, EnergyRail idle) {
+  EnergyModel::endWake(micros(), idle);
+  printf("[native] Wake %u %s after %.1f ms: nvs open/r/w "
+         "%u/%u/%u in %.1f ms, allocations %u (peak %zu B), tcp connects %u, "
+         "http requests %u, sent %u B, received %u B, flash written %u B\n",
+         wakeIndex, how, micros() / 1000.0, stats.nvsOpens, stats.nvsReads,
+         stats.nvsWrites, stats.nvsMicros / 1000.0,
+         stats.allocations, heapPeak, stats.tcpConnects, stats.httpRequests,
+         stats.bytesSent, stats.bytesReceived, stats.flashBytesWritten);
+  fflush(stdout);
+  _exit(EXIT_POWER_OFF);
+}
+
+/**
+ * @brief Stand-in for the TPL5110 cutting power: ends the wake process.
+ */
+void NativeHal::powerOff() { endWake("powered off", RAIL_OFF); }
+
+/**
+ * @brief Stand-in for deep sleep with a timer wake: keeps RTC memory for
+ * the next wake process and ends this one.
+ */
+void NativeHal::deepSleep() {
+  saveRtc();
+  endWake("went to deep sleep", RAIL_SLEEP);
+}
+
+void NativeHal::restart() {
+  printf("[native] Wake %u restarted.\n", wakeIndex);
+  fflush(stdout);
+  _exit(EXIT_RESTART);
+}
+
+uint32_t nativeFreeHeap() { return NATIVE_HEAP_SIZE - heapUsed; }
+uint32_t nativeMinFreeHeap() { return NATIVE_HEAP_SIZE - heapPeak; }
+
+// Heap accounting, so ESP.getFreeHeap() and the allocation count are real
+void *operator new(size_t size) {
+  void *pointer = malloc(size ? size : 1);
+  if (!pointer)
+    throw std::bad_alloc();
+  NativeHal::stats.allocations++;
+  heapUsed += malloc_usable_size(pointer);
+  if (heapUsed > heapPeak)
+    heapPeak = heapUsed;
+  return pointer;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *pointer) noexcept {
+  if (!pointer)
+    return;
+  heapUsed -= malloc_usable_size(pointer);
+  free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept { operator delete(pointer); }
+void operator delete(void *pointer, size_t) noexcept {
+  operator delete(pointer);
+}
+void operator delete[](void *pointer, size_t) noexcept {
+  operator delete(pointer);
+}
+
+/**
+ * @brief Runs wake cycles, each in its own process so that, as with the
+ * TPL5110, nothing but NVS survives from one wake to the next, and RTC
+ * memory too after deep sleep.
+ * @param wakes The number of wakes.
+ * @param wake Runs one wake, which must end by powering off, deep sleep or
+ * a restart.
+ * @return True if every wake ended cleanly.
+ */
+bool NativeHal::runWakes(long wakes, void (*wake)()) {
+  for (long i = 0; i < wakes; i++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return false;
+    }
+    if (pid == 0) {
+      NativeHal::beginWake(i);
+      wake();
+      printf("[native] Wake %ld returned without powering off.\n", i);
+      fflush(stdout);
+      _exit(EXIT_TIMEOUT);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == EXIT_TIMEOUT) {
+      printf("[native] Wake %ld did not power off cleanly.\n", i);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Stores the credentials the captive portal would have saved, so a
+ * fresh STACY_NVS_DIR starts straight in normal mode.
+ * @param erase Whether to drop everything else first (buffered readings,
+ * Wi-Fi cache), so runs do not depend on the previous one.
+ */
+void NativeHal::provision(bool erase) {
+  Preferences preferences;
+  preferences.begin("stacy", false);
+  if (erase) {
+    preferences.clear();
+    LittleFS.begin();
+    LittleFS.format();
+    LittleFS.end();
+    unlink(rtcPath().c_str());
+  }
+  preferences.putString("ssid", NativeHal::envString("STACY_SSID", "native"));
+  preferences.putString("wifi_password",
+                        NativeHal::envString("STACY_WIFI_PASSWORD", "native"));
+  preferences.putString("uid", NativeHal::envString("STACY_UID", "native"));
+  preferences.putString("bearer_token",
+                        NativeHal::envString("STACY_TOKEN", "native"));
+  preferences.putString("plant_name",
+                        NativeHal::envString("STACY_PLANT_NAME", "native"));
+  preferences.putString("plant_id",
+                        NativeHal::envString("STACY_PLANT_ID", "1"));
+  // Written in the layout the captive portal used to write, so the firmware
+  // migrates it to its configuration blob on the first wake
+  preferences.remove("config");
+  preferences.end();
+}
+
+// Tests in test/ bring their own main() and wakes
+#ifndef PIO_UNIT_TESTING
+void setup();
+void loop();
+
+static void firmwareWake() {
+  setup();
+  loop();
+}
+
+/**
+ * @brief Runs STACY_WAKES wake cycles of the firmware.
+ */
+int main() {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  long wakes = NativeHal::envLong("STACY_WAKES", NATIVE_DEFAULT_WAKES);
+  long provisioning =
+      NativeHal::envLong("STACY_PROVISION", NATIVE_DEFAULT_PROVISION);
+  if (provisioning)
+    NativeHal::provision(provisioning > 1);
+  EnergyModel::begin();
+
+  if (!NativeHal::runWakes(wakes, firmwareWake))
+    return 1;
+  EnergyModel::report();
+  return 0;
+}
+#endif
@@ -0,0 +1,81 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include "EnergyModel.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-wake counters, printed when the wake ends, by the TPL5110 stand-in
+// cutting power or by deep sleep.
+typedef struct NativeHalStats {
+  uint32_t nvsOpens;
+  uint32_t nvsReads;
+  uint32_t nvsWrites;
+  uint32_t nvsMicros; // simulated time spent in NVS
+  uint32_t allocations;
+  uint32_t tcpConnects;
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t httpRequests;
+  uint32_t flashBytesWritten;
+} NativeHalStats;
+
+// 12-bit range of the ESP32-C3 ADC at 11 dB attenuation
+#define NATIVE_ADC_FULL_SCALE_MV 3100
+
+// Columns of a STACY_TRACE file, one CSV line per wake
+typedef enum {
+  TRACE_TEMPERATURE,
+  TRACE_HUMIDITY,
+  TRACE_MOISTURE_MV,
+  TRACE_BATTERY_MV,
+  TRACE_COLUMNS
+} NativeTraceColumn;
+
+// Events a stand-in raises at a simulated time, such as Wi-Fi connecting
+#define NATIVE_TIMERS 4
+
+typedef struct NativeTimer {
+  uint64_t at; // us since reset
+  void (*callback)();
+} NativeTimer;
+
+// Simulated clock, configuration and bookkeeping shared by the stand-ins.
+// Time is the real elapsed time plus whatever delay() and the simulated
+// peripherals skipped, so waits cost no wall-clock time. Timers fire once
+// time has been skipped past them.
+class NativeHal {
+private:
+  static uint64_t wakeStartReal;
+  static uint64_t skippedMicros;
+  static NativeTimer timers[NATIVE_TIMERS];
+  static uint32_t wakeIndex;
+  static bool deepSleepWake;
+  static void endWake(const char *how, EnergyRail idle);
+
+public:
+  static NativeHalStats stats;
+  static void beginWake(uint32_t index);
+  static bool runWakes(long wakes, void (*wake)());
+  static uint64_t micros();
+  static void advance(uint64_t micros);
+  static void idle(uint64_t micros);
+  static void schedule(uint64_t at, void (*callback)());
+  static void cancel(void (*callback)());
+  static uint32_t wake();
+  static long envLong(const char *name, long fallback);
+  static const char *envString(const char *name, const char *fallback);
+  static bool traceValue(NativeTraceColumn column, double &value,
+                         uint32_t wake);
+  static bool traceValue(NativeTraceColumn column, double &value) {
+    return traceValue(column, value, wakeIndex);
+  }
+  static void conditions(double wake, double &temperature, double &humidity);
+  static bool wokeFromDeepSleep();
+  static void provision(bool erase);
+  static void powerOff();
+  static void deepSleep();
+  static void restart();
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "Preferences.h"
+#include "NativeHal.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Rough ESP32 NVS costs, the write includes the occasional page erase.
+// Values are stored in 32-byte entries, each adding to the cost.
+#define NVS_OPEN_US 300
+#define NVS_READ_US 100
+#define NVS_WRITE_US 2000
+#define NVS_ENTRY_SIZE 32
+#define NVS_ENTRY_READ_US 4
+#define NVS_ENTRY_WRITE_US 40
+
+/**
+ * @brief Advances the clock by the cost of an NVS operation.
+ * @param micros The cost.
+ */
+static void charge(uint64_t micros) {
+  NativeHal::stats.nvsMicros += micros;
+  NativeHal::advance(micros);
+}
+
+/**
+ * @brief Counts the entries a value takes.
+ * @param length The value length.
+ * @return The number of entries.
+ */
+static size_t entriesOf(size_t length) {
+  return (length + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE;
+}
+
+std::string Preferences::path() const {
+  const char *directory = NativeHal::envString("STACY_NVS_DIR", "native_nvs");
+  mkdir(directory, 0755);
+  return std::string(directory) + "/" + name + ".nvs";
+}
+
+/**
+ * @brief Reads the namespace file: for each entry, a u16 key length, the
+ * key, a u32 value length and the value.
+ */
+void Preferences::load() {
+  entries.clear();
+  FILE *file = fopen(path().c_str(), "rb");
+  if (!file)
+    return;
+
+  uint16_t keyLength;
+  while (fread(&keyLength, sizeof(keyLength), 1, file) == 1) {
+    std::string key(keyLength, '\0');
+    uint32_t valueLength;
+    if (fread(&key[0], 1, keyLength, file) != keyLength ||
+        fread(&valueLength, sizeof(valueLength), 1, file) != 1)
+      break;
+    std::vector<uint8_t> value(valueLength);
+    if (fread(value.data(), 1, valueLength, file) != valueLength)
+      break;
+    entries[key] = value;
+  }
+  fclose(file);
+}
+
+void Preferences::save() {
+  FILE *file = fopen(path().c_str(), "wb");
+  if (!file)
+    return;
+  for (const auto &entry : entries) {
+    uint16_t keyLength = entry.first.size();
+    uint32_t valueLength = entry.second.size();
+    fwrite(&keyLength, sizeof(keyLength), 1, file);
+    fwrite(entry.first.data(), 1, keyLength, file);
+    fwrite(&valueLength, sizeof(valueLength), 1, file);
+    fwrite(entry.second.data(), 1, valueLength, file);
+  }
+  fclose(file);
+  dirty = false;
+}
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  end();
+  this->name = name;
+  this->readOnly = readOnly;
+  opened = true;
+  NativeHal::stats.nvsOpens++;
+  charge(NVS_OPEN_US);
+  load();
+  return true;
+}
+
+void Preferences::end() {
+  if (opened && dirty)
+    save();
+  opened = false;
+}
+
+size_t Preferences::put(const char *key, const void *value, size_t length) {
+  if (!opened || readOnly || strlen(key) > 15)
+    return 0;
+  NativeHal::stats.nvsWrites++;
+  charge(NVS_WRITE_US + entriesOf(length) * NVS_ENTRY_WRITE_US);
+  const uint8_t *bytes = (const uint8_t *)value;
+  entries[key] = std::vector<uint8_t>(bytes, bytes + length);
+  dirty = true;
+  return length;
+}
+
+const std::vector<uint8_t> *Preferences::find(const char *key) {
+  if (!opened)
+    return nullptr;
+  NativeHal::stats.nvsReads++;
+  auto entry = entries.find(key);
+  if (entry == entries.end()) {
+    charge(NVS_READ_US);
+    return nullptr;
+  }
+  charge(NVS_READ_US + entriesOf(entry->second.size()) * NVS_ENTRY_READ_US);
+  return &entry->second;
+}
+
+bool Preferences::clear() {
+  if (!opened || readOnly)
+    return false;
+  entries.clear();
+  dirty = true;
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!opened || readOnly)
+    return false;
+  NativeHal::stats.nvsWrites++;
+  charge(NVS_WRITE_US);
+  dirty = entries.erase(key) > 0 || dirty;
+  return true;
+}
+
+bool Preferences::isKey(const char *key) { return find(key) != nullptr; }
+
+size_t Preferences::putString(const char *key, const char *value) {
+  return put(key, value, strlen(value));
+}
+
+size_t Preferences::putString(const char *key, const String &value) {
+  return putString(key, value.c_str());
+}
+
+size_t Preferences::putBytes(const char *key, const void *value,
+                             size_t length) {
+  return put(key, value, length);
+}
+
+size_t Preferences::putUChar(const char *key, uint8_t value) {
+  return put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUShort(const char *key, uint16_t value) {
+  return put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value) {
+  return put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putULong(const char *key, uint32_t value) {
+  return put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putBool(const char *key, bool value) {
+  return putUChar(key, value ? 1 : 0);
+}
+
+String Preferences::getString(const char *key, const String &defaultValue) {
+  const std::vector<uint8_t> *value = find(key);
+  if (!value)
+    return defaultValue;
+  return String(std::string(value->begin(), value->end()));
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  const std::vector<uint8_t> *value = find(key);
+  return value ? value->size() : 0;
+}
+
+/**
+ * @brief Copies a blob, failing like NVS when the buffer is too small.
+ */
+size_t Preferences::getBytes(const char *key, void *buffer, size_t length) {
+  const std::vector<uint8_t> *value = find(key);
+  if (!value || value->size() > length)
+    return 0;
+  memcpy(buffer, value->data(), value->size());
+  return value->size();
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+  uint8_t value = defaultValue;
+  getBytes(key, &value, sizeof(value));
+  return value;
+}
+
+uint16_t Preferences::getUShort(const char *key, uint16_t defaultValue) {
+  uint16_t value = defaultValue;
+  getBytes(key, &value, sizeof(value));
+  return value;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+  uint32_t value = defaultValue;
+  getBytes(key, &value, sizeof(value));
+  return value;
+}
+
+uint32_t Preferences::getULong(const char *key, uint32_t defaultValue) {
+  return getUInt(key, defaultValue);
+}
+
+bool Preferences::getBool(const char *key, bool defaultValue) {
+  return getUChar(key, defaultValue ? 1 : 0) != 0;
+}
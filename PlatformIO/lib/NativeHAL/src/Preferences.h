@@ -0,0 +1,52 @@
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+#include "WString.h"
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// NVS stand-in, one file per namespace under STACY_NVS_DIR.
+class Preferences {
+private:
+  std::string name;
+  bool readOnly = true;
+  bool opened = false;
+  bool dirty = false;
+  std::map<std::string, std::vector<uint8_t>> entries;
+  std::string path() const;
+  void load();
+  void save();
+  size_t put(const char *key, const void *value, size_t length);
+  const std::vector<uint8_t> *find(const char *key);
+
+public:
+  ~Preferences() { end(); }
+  bool begin(const char *name, bool readOnly = false);
+  void end();
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putString(const char *key, const char *value);
+  size_t putString(const char *key, const String &value);
+  size_t putBytes(const char *key, const void *value, size_t length);
+  size_t putUChar(const char *key, uint8_t value);
+  size_t putUShort(const char *key, uint16_t value);
+  size_t putUInt(const char *key, uint32_t value);
+  size_t putULong(const char *key, uint32_t value);
+  size_t putBool(const char *key, bool value);
+
+  String getString(const char *key, const String &defaultValue = String());
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buffer, size_t length);
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+  uint16_t getUShort(const char *key, uint16_t defaultValue = 0);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  uint32_t getULong(const char *key, uint32_t defaultValue = 0);
+  bool getBool(const char *key, bool defaultValue = false);
+};
+
+#endif
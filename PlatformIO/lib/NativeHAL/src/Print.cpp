@@ -0,0 +1,59 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--)
+    n += write(*buffer++);
+  return n;
+}
+
+size_t Print::write(const char *text) {
+  return text ? write((const uint8_t *)text, strlen(text)) : 0;
+}
+
+size_t Print::print(const char *text) { return write(text); }
+size_t Print::print(const String &text) { return write(text.c_str()); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(int number, int base) {
+  return print(String(number, base));
+}
+size_t Print::print(unsigned int number, int base) {
+  return print(String(number, base));
+}
+size_t Print::print(long number, int base) {
+  return print(String(number, base));
+}
+size_t Print::print(unsigned long number, int base) {
+  return print(String(number, base));
+}
+size_t Print::print(long long number, int base) {
+  return print(String(number, base));
+}
+size_t Print::print(unsigned long long number, int base) {
+  return print(String(number, base));
+}
+size_t Print::print(double number, int decimals) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, number);
+  return write(buffer);
+}
+size_t Print::print(const Printable &printable) {
+  return printable.printTo(*this);
+}
+size_t Print::println() { return write("\r\n"); }
+
+size_t Print::printf(const char *format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0)
+    return 0;
+  return write((const uint8_t *)buffer,
+               (size_t)length < sizeof(buffer) ? length : sizeof(buffer) - 1);
+}
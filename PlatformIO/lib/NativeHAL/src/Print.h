@@ -0,0 +1,49 @@
+#ifndef PRINT_H
+#define PRINT_H
+
+#include "WString.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEC 10
+#define HEX 16
+
+class Print;
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *text);
+  size_t print(const char *text);
+  size_t print(const String &text);
+  size_t print(char c);
+  size_t print(int number, int base = 10);
+  size_t print(unsigned int number, int base = 10);
+  size_t print(long number, int base = 10);
+  size_t print(unsigned long number, int base = 10);
+  size_t print(long long number, int base = 10);
+  size_t print(unsigned long long number, int base = 10);
+  size_t print(double number, int decimals = 2);
+  size_t print(const Printable &printable);
+  size_t println();
+  template <typename T> size_t println(const T &value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T> size_t println(const T &value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+  size_t printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static std::string formatInteger(unsigned long long number, unsigned char base,
+                                 bool negative) {
+  if (base < 2 || base > 36)
+    base = 10;
+  std::string digits;
+  do {
+    int digit = number % base;
+    digits.insert(digits.begin(), digit < 10 ? '0' + digit : 'a' + digit - 10);
+    number /= base;
+  } while (number);
+  if (negative)
+    digits.insert(digits.begin(), '-');
+  return digits;
+}
+
+String::String(int number, unsigned char base)
+    : String((long long)number, base) {}
+String::String(unsigned int number, unsigned char base)
+    : String((unsigned long long)number, base) {}
+String::String(long number, unsigned char base)
+    : String((long long)number, base) {}
+String::String(unsigned long number, unsigned char base)
+    : String((unsigned long long)number, base) {}
+
+String::String(long long number, unsigned char base) {
+  bool negative = number < 0 && base == 10;
+  value = formatInteger(negative ? -(unsigned long long)number : number, base,
+                        negative);
+}
+
+String::String(unsigned long long number, unsigned char base) {
+  value = formatInteger(number, base, false);
+}
+
+String::String(float number, unsigned int decimals)
+    : String((double)number, decimals) {}
+
+String::String(double number, unsigned int decimals) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, number);
+  value = buffer;
+}
+
+bool String::reserve(unsigned int size) {
+  value.reserve(size);
+  return true;
+}
+
+bool String::concat(const String &text) {
+  value += text.value;
+  return true;
+}
+
+bool String::concat(const char *text) {
+  if (!text)
+    return false;
+  value += text;
+  return true;
+}
+
+bool String::concat(const char *text, unsigned int length) {
+  if (!text)
+    return false;
+  value.append(text, length);
+  return true;
+}
+
+bool String::concat(char c) {
+  value += c;
+  return true;
+}
+
+String &String::operator+=(const String &text) {
+  concat(text);
+  return *this;
+}
+
+String &String::operator+=(const char *text) {
+  concat(text);
+  return *this;
+}
+
+String &String::operator+=(char c) {
+  concat(c);
+  return *this;
+}
+
+char String::operator[](unsigned int index) const {
+  return index < value.size() ? value[index] : '\0';
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t position = value.find(c, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::indexOf(const char *text, unsigned int from) const {
+  size_t position = value.find(text, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::indexOf(const String &text, unsigned int from) const {
+  return indexOf(text.c_str(), from);
+}
+
+bool String::startsWith(const String &prefix) const {
+  return value.compare(0, prefix.value.size(), prefix.value) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return value.size() >= suffix.value.size() &&
+         value.compare(value.size() - suffix.value.size(),
+                       suffix.value.size(), suffix.value) == 0;
+}
+
+String String::substring(unsigned int from) const {
+  return from < value.size() ? String(value.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= value.size())
+    return String();
+  return String(value.substr(from, to - from));
+}
+
+void String::toUpperCase() {
+  for (char &c : value)
+    c = toupper((unsigned char)c);
+}
+
+void String::toLowerCase() {
+  for (char &c : value)
+    c = tolower((unsigned char)c);
+}
+
+void String::trim() {
+  size_t first = value.find_first_not_of(" \t\r\n");
+  size_t last = value.find_last_not_of(" \t\r\n");
+  value = first == std::string::npos ? ""
+                                     : value.substr(first, last - first + 1);
+}
+
+long String::toInt() const { return strtol(value.c_str(), nullptr, 10); }
+
+float String::toFloat() const { return strtof(value.c_str(), nullptr); }
+
+String operator+(const String &left, const String &right) {
+  String result(left);
+  result += right;
+  return result;
+}
+
+String operator+(const String &left, const char *right) {
+  String result(left);
+  result += right;
+  return result;
+}
+
+String operator+(const char *left, const String &right) {
+  String result(left);
+  result += right;
+  return result;
+}
+
+String operator+(const String &left, char right) {
+  String result(left);
+  result += right;
+  return result;
+}
@@ -0,0 +1,64 @@
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Arduino String on top of std::string, allocations go through the
+// counting operator new in NativeHal.cpp.
+class String {
+private:
+  std::string value;
+
+public:
+  String() {}
+  String(const char *text) : value(text ? text : "") {}
+  String(const std::string &text) : value(text) {}
+  String(char c) : value(1, c) {}
+  String(int number, unsigned char base = 10);
+  String(unsigned int number, unsigned char base = 10);
+  String(long number, unsigned char base = 10);
+  String(unsigned long number, unsigned char base = 10);
+  String(long long number, unsigned char base = 10);
+  String(unsigned long long number, unsigned char base = 10);
+  String(float number, unsigned int decimals = 2);
+  String(double number, unsigned int decimals = 2);
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+  bool isEmpty() const { return value.empty(); }
+  bool reserve(unsigned int size);
+  bool concat(const String &text);
+  bool concat(const char *text);
+  bool concat(const char *text, unsigned int length);
+  bool concat(char c);
+  String &operator+=(const String &text);
+  String &operator+=(const char *text);
+  String &operator+=(char c);
+  bool operator==(const String &other) const { return value == other.value; }
+  bool operator==(const char *other) const { return value == other; }
+  bool operator!=(const String &other) const { return value != other.value; }
+  bool operator!=(const char *other) const { return value != other; }
+  char operator[](unsigned int index) const;
+  char charAt(unsigned int index) const { return (*this)[index]; }
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const char *text, unsigned int from = 0) const;
+  int indexOf(const String &text, unsigned int from = 0) const;
+  bool startsWith(const String &prefix) const;
+  bool endsWith(const String &suffix) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  void toUpperCase();
+  void toLowerCase();
+  void trim();
+  long toInt() const;
+  float toFloat() const;
+};
+
+String operator+(const String &left, const String &right);
+String operator+(const String &left, const char *right);
+String operator+(const char *left, const String &right);
+String operator+(const String &left, char right);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef WEBSERVER_H
+#define WEBSERVER_H
+
+#include "Arduino.h"
+#include <functional>
+
+typedef enum {
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_POST,
+  HTTP_PUT,
+  HTTP_DELETE
+} HTTPMethod;
+
+// Captive portal stand-in, no client ever connects.
+class WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  WebServer(int port = 80) {}
+  void on(const String &uri, THandlerFunction handler) {}
+  void on(const String &uri, HTTPMethod method, THandlerFunction handler) {}
+  void onNotFound(THandlerFunction handler) {}
+  void begin() {}
+  void stop() {}
+  void handleClient() {}
+  String arg(const String &name) { return String(); }
+  void send(int code, const char *contentType, const String &content) {}
+  void sendHeader(const String &name, const String &value,
+                  bool first = false) {}
+};
+
+#endif
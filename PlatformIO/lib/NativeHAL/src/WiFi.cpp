@@ -0,0 +1,135 @@
+#include "WiFi.h"
+#include "EnergyModel.h"
+
+#include <string.h>
+
+WiFiClass WiFi;
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase,
+                             int32_t channel, const uint8_t *bssid,
+                             bool connect) {
+  currentMode = WIFI_STA;
+  if (!ssid || !*ssid || NativeHal::envLong("STACY_WIFI_DOWN", 0)) {
+    associating = false;
+    return WL_NO_SSID_AVAIL;
+  }
+
+  bool targeted = bssid && channel > 0;
+  uint64_t duration =
+      targeted ? NativeHal::envLong("STACY_FAST_ASSOC_MS", 250)
+               : NativeHal::envLong("STACY_SCAN_ASSOC_MS", 2200);
+  if (!staticIP)
+    duration += NativeHal::envLong("STACY_DHCP_MS", 400);
+  // STACY_WIFI_MOVED simulates the cached access point being gone
+  if (targeted && NativeHal::envLong("STACY_WIFI_MOVED", 0))
+    duration = UINT32_MAX;
+
+  // Authentication, association and key handshake, then DHCP, and probe
+  // requests on every channel when scanning
+  EnergyModel::radioStart();
+  EnergyModel::transmit(0, (targeted ? 4 : 4 + 13) + (staticIP ? 0 : 2));
+  associating = true;
+  connectedAt = NativeHal::micros() + duration * 1000;
+  NativeHal::schedule(connectedAt, gotIP);
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet,
+                       IPAddress dns1, IPAddress dns2) {
+  staticIP = (uint32_t)local != 0;
+  this->local = local;
+  this->gateway = gateway;
+  this->subnet = subnet;
+  this->dns = dns1;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAP) {
+  NativeHal::cancel(gotIP);
+  if (associating)
+    dispatch(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  associating = false;
+  if (wifiOff) {
+    currentMode = WIFI_OFF;
+    EnergyModel::radioStop();
+  }
+  return true;
+}
+
+/**
+ * @brief Reports the association state. Polling costs 1 ms of simulated
+ * time, so busy-wait loops progress without burning wall-clock time.
+ */
+wl_status_t WiFiClass::status() {
+  if (!associating)
+    return WL_DISCONNECTED;
+  if (NativeHal::micros() < connectedAt) {
+    NativeHal::advance(1000);
+    return WL_DISCONNECTED;
+  }
+  if (!staticIP) {
+    local = IPAddress(192, 168, 1, 50);
+    gateway = IPAddress(192, 168, 1, 1);
+    subnet = IPAddress(255, 255, 255, 0);
+    dns = IPAddress(192, 168, 1, 1);
+  }
+  return WL_CONNECTED;
+}
+
+/**
+ * @brief Registers an event handler, called from the simulated clock as the
+ * Arduino event task would call it.
+ * @param callback The handler.
+ * @param event The event it is for, ARDUINO_EVENT_MAX for every event.
+ * @return The handler id, 0 if there is no room left.
+ */
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb callback,
+                                   arduino_event_id_t event) {
+  for (size_t i = 0; i < NATIVE_WIFI_HANDLERS; i++) {
+    if (!handlers[i].callback) {
+      handlers[i].callback = callback;
+      handlers[i].event = event;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+void WiFiClass::dispatch(arduino_event_id_t event) {
+  for (size_t i = 0; i < NATIVE_WIFI_HANDLERS; i++) {
+    if (handlers[i].callback && (handlers[i].event == event ||
+                                 handlers[i].event == ARDUINO_EVENT_MAX))
+      handlers[i].callback(event);
+  }
+}
+
+/**
+ * @brief Timer of the association, due when it completes.
+ */
+void WiFiClass::gotIP() {
+  if (WiFi.status() == WL_CONNECTED)
+    WiFi.dispatch(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+  currentMode = mode;
+  if (mode == WIFI_OFF)
+    EnergyModel::radioStop();
+  else
+    EnergyModel::radioStart();
+  return true;
+}
+
+/**
+ * @brief Returns STACY_MAC, so several simulated stations can run at once.
+ */
+esp_err_t esp_wifi_get_mac(wifi_interface_t interface, uint8_t mac[6]) {
+  const char *text = NativeHal::envString("STACY_MAC", "F0:9E:9E:20:EF:44");
+  unsigned int bytes[6];
+  if (sscanf(text, "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2],
+             &bytes[3], &bytes[4], &bytes[5]) != 6)
+    return -1;
+  for (int i = 0; i < 6; i++)
+    mac[i] = bytes[i];
+  return ESP_OK;
+}
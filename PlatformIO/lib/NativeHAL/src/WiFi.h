@@ -0,0 +1,98 @@
+#ifndef WIFI_H
+#define WIFI_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "esp_wifi.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+// The Wi-Fi events the firmware listens to, numbered as in Arduino 2.x
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+  ARDUINO_EVENT_MAX = 40
+} arduino_event_id_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+typedef size_t wifi_event_id_t;
+
+#define NATIVE_WIFI_HANDLERS 4
+
+// Association stand-in: a targeted connect (BSSID and channel known)
+// takes STACY_FAST_ASSOC_MS, a scan takes STACY_SCAN_ASSOC_MS, and DHCP
+// adds STACY_DHCP_MS unless a static IP was configured. Handlers get
+// ARDUINO_EVENT_WIFI_STA_GOT_IP when it completes.
+class WiFiClass {
+private:
+  struct {
+    WiFiEventCb callback;
+    arduino_event_id_t event;
+  } handlers[NATIVE_WIFI_HANDLERS] = {};
+  static void gotIP();
+  void dispatch(arduino_event_id_t event);
+  wifi_mode_t currentMode = WIFI_OFF;
+  bool associating = false;
+  bool staticIP = false;
+  uint64_t connectedAt = 0;
+  IPAddress local;
+  IPAddress gateway;
+  IPAddress subnet;
+  IPAddress dns;
+  uint8_t bssid[6] = {0x24, 0x0A, 0xC4, 0x12, 0x34, 0x56};
+
+public:
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr,
+                    int32_t channel = 0, const uint8_t *bssid = nullptr,
+                    bool connect = true);
+  wl_status_t begin(const String &ssid, const String &passphrase,
+                    int32_t channel = 0, const uint8_t *bssid = nullptr,
+                    bool connect = true) {
+    return begin(ssid.c_str(), passphrase.c_str(), channel, bssid, connect);
+  }
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet,
+              IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+  bool disconnect(bool wifiOff = false, bool eraseAP = false);
+  wl_status_t status();
+  wifi_event_id_t onEvent(WiFiEventCb callback,
+                          arduino_event_id_t event = ARDUINO_EVENT_MAX);
+  bool mode(wifi_mode_t mode);
+  wifi_mode_t getMode() { return currentMode; }
+
+  IPAddress localIP() { return local; }
+  IPAddress gatewayIP() { return gateway; }
+  IPAddress subnetMask() { return subnet; }
+  IPAddress dnsIP(uint8_t index = 0) { return dns; }
+  uint8_t *BSSID() { return bssid; }
+  int32_t channel() { return 6; }
+  int8_t RSSI() { return -58; }
+
+  bool softAP(const String &ssid) { return true; }
+  bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) {
+    return true;
+  }
+  bool softAPdisconnect(bool wifiOff = false) { return true; }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+  int16_t scanNetworks() { return 0; }
+  String SSID(uint8_t index) { return String(); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
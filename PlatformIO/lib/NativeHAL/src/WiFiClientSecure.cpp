@@ -0,0 +1,137 @@
+#include "WiFiClientSecure.h"
+#include "EnergyModel.h"
+#include "NativeHal.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define SOCKET_TIMEOUT_MS 5000
+// Typical TLS 1.2 handshake: hellos and key exchange out, certificates in
+#define TLS_HANDSHAKE_SENT 400
+#define TLS_HANDSHAKE_RECEIVED 4000
+
+int WiFiClientSecure::connect(const char *host, uint16_t port) {
+  stop();
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[6];
+  snprintf(service, sizeof(service), "%u", port);
+
+  struct addrinfo *addresses;
+  if (getaddrinfo(host, service, &hints, &addresses) != 0)
+    return 0;
+
+  for (struct addrinfo *address = addresses; address;
+       address = address->ai_next) {
+    int fd = socket(address->ai_family, address->ai_socktype,
+                    address->ai_protocol);
+    if (fd < 0)
+      continue;
+    if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+      socketFd = fd;
+      break;
+    }
+    close(fd);
+  }
+  freeaddrinfo(addresses);
+
+  if (socketFd < 0)
+    return 0;
+  NativeHal::stats.tcpConnects++;
+  NativeHal::advance(NativeHal::envLong("STACY_TLS_MS", 900) * 1000);
+  EnergyModel::transmit(TLS_HANDSHAKE_SENT, 3);
+  EnergyModel::received(TLS_HANDSHAKE_RECEIVED);
+  return 1;
+}
+
+/**
+ * @brief Reads more bytes from the socket into the buffer.
+ * @param wait Whether to block until data arrives or the timeout expires.
+ * @return True if bytes were added.
+ */
+bool WiFiClientSecure::fill(bool wait) {
+  if (socketFd < 0)
+    return false;
+  if (bufferStart == bufferEnd)
+    bufferStart = bufferEnd = 0;
+  if (bufferEnd == sizeof(buffer))
+    return false;
+
+  struct pollfd descriptor = {socketFd, POLLIN, 0};
+  if (poll(&descriptor, 1, wait ? SOCKET_TIMEOUT_MS : 0) <= 0)
+    return false;
+
+  ssize_t received =
+      recv(socketFd, buffer + bufferEnd, sizeof(buffer) - bufferEnd, 0);
+  if (received <= 0) {
+    // Peer closed the connection, keep what is already buffered
+    close(socketFd);
+    socketFd = -1;
+    return false;
+  }
+  bufferEnd += received;
+  NativeHal::stats.bytesReceived += received;
+  EnergyModel::received(received);
+  return true;
+}
+
+uint8_t WiFiClientSecure::connected() {
+  if (bufferEnd > bufferStart)
+    return 1;
+  if (socketFd < 0)
+    return 0;
+  fill(false);
+  return socketFd >= 0 || bufferEnd > bufferStart;
+}
+
+void WiFiClientSecure::stop() {
+  if (socketFd >= 0)
+    close(socketFd);
+  socketFd = -1;
+  bufferStart = bufferEnd = 0;
+}
+
+int WiFiClientSecure::available() {
+  if (bufferEnd == bufferStart)
+    fill(false);
+  return bufferEnd - bufferStart;
+}
+
+int WiFiClientSecure::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClientSecure::read(uint8_t *destination, size_t size) {
+  if (bufferEnd == bufferStart && !fill(true))
+    return -1;
+  size_t count = bufferEnd - bufferStart;
+  if (count > size)
+    count = size;
+  memcpy(destination, buffer + bufferStart, count);
+  bufferStart += count;
+  return count;
+}
+
+size_t WiFiClientSecure::write(const uint8_t *source, size_t size) {
+  size_t sent = 0;
+  while (socketFd >= 0 && sent < size) {
+    ssize_t result = send(socketFd, source + sent, size - sent, MSG_NOSIGNAL);
+    if (result <= 0) {
+      stop();
+      break;
+    }
+    sent += result;
+  }
+  NativeHal::stats.bytesSent += sent;
+  EnergyModel::sent(sent);
+  return sent;
+}
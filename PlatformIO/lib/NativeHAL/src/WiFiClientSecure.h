@@ -0,0 +1,33 @@
+#ifndef WIFI_CLIENT_SECURE_H
+#define WIFI_CLIENT_SECURE_H
+
+#include "Client.h"
+
+// Plain TCP socket standing in for the TLS client: point SERVER_URL at a
+// local HTTP server. Each connect() also costs STACY_TLS_MS of simulated
+// handshake time.
+class WiFiClientSecure : public Client {
+private:
+  int socketFd = -1;
+  uint8_t buffer[1024];
+  size_t bufferStart = 0;
+  size_t bufferEnd = 0;
+  bool fill(bool wait);
+
+public:
+  ~WiFiClientSecure() { stop(); }
+  void setInsecure() {}
+  void setCACert(const char *rootCA) {}
+  void setHandshakeTimeout(unsigned long seconds) {}
+  int connect(const char *host, uint16_t port) override;
+  uint8_t connected() override;
+  void stop() override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *destination, size_t size) override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *source, size_t size) override;
+  using Print::write;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "Wire.h"
+#include "EnergyModel.h"
+
+#define I2C_ADDRESSES 128
+
+TwoWire Wire;
+
+static NativeI2cDevice *devices[I2C_ADDRESSES];
+
+static NativeI2cDevice *deviceAt(uint8_t address) {
+  return address < I2C_ADDRESSES ? devices[address] : nullptr;
+}
+
+void TwoWire::attach(uint8_t address, NativeI2cDevice *device) {
+  if (address < I2C_ADDRESSES)
+    devices[address] = device;
+}
+
+/**
+ * @brief Spends the bus time of a transaction: the address byte and the
+ * data bytes, 9 clocks each.
+ */
+void TwoWire::transfer(size_t bytes) {
+  uint64_t micros = (bytes + 1) * 9 * 1000000ULL / frequency;
+  NativeHal::advance(micros);
+  EnergyModel::consume(RAIL_I2C, micros);
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  if (frequency)
+    this->frequency = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  this->address = address;
+  txSize = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txSize >= NATIVE_I2C_BUFFER_SIZE)
+    return 0;
+  txBuffer[txSize++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t size) {
+  size_t written = 0;
+  while (written < size && write(data[written]))
+    written++;
+  return written;
+}
+
+/**
+ * @brief Ends a write transaction.
+ * @return 0 on success, 2 if no device acknowledged the address.
+ */
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  transfer(txSize);
+  NativeI2cDevice *device = deviceAt(address);
+  if (!device || !device->receive(txBuffer, txSize))
+    return 2;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t size, bool sendStop) {
+  rxIndex = 0;
+  rxSize = 0;
+  if (size > NATIVE_I2C_BUFFER_SIZE)
+    size = NATIVE_I2C_BUFFER_SIZE;
+  NativeI2cDevice *device = deviceAt(address);
+  if (device)
+    rxSize = device->respond(rxBuffer, size);
+  // A NACKed read ends after the address byte
+  transfer(rxSize);
+  return rxSize;
+}
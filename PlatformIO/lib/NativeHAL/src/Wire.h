@@ -0,0 +1,47 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "Arduino.h"
+
+#define NATIVE_I2C_BUFFER_SIZE 32
+
+// A simulated device on the I2C bus.
+class NativeI2cDevice {
+public:
+  virtual ~NativeI2cDevice() {}
+  // Handles a write transaction, returns false to NACK it
+  virtual bool receive(const uint8_t *data, size_t size) = 0;
+  // Fills a read transaction, returns the number of bytes sent
+  virtual size_t respond(uint8_t *data, size_t size) = 0;
+};
+
+// I2C stand-in. Transactions go to the simulated devices attached to
+// their address and take their time on the bus at the configured clock.
+class TwoWire {
+private:
+  uint32_t frequency = 100000;
+  uint8_t address = 0;
+  uint8_t txBuffer[NATIVE_I2C_BUFFER_SIZE];
+  size_t txSize = 0;
+  uint8_t rxBuffer[NATIVE_I2C_BUFFER_SIZE];
+  size_t rxSize = 0;
+  size_t rxIndex = 0;
+  void transfer(size_t bytes);
+
+public:
+  static void attach(uint8_t address, NativeI2cDevice *device);
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  void setClock(uint32_t frequency) { this->frequency = frequency; }
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(bool sendStop = true);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t size);
+  uint8_t requestFrom(uint8_t address, size_t size, bool sendStop = true);
+  int available() { return rxSize - rxIndex; }
+  int read() { return rxIndex < rxSize ? rxBuffer[rxIndex++] : -1; }
+};
+
+extern TwoWire Wire;
+
+#endif
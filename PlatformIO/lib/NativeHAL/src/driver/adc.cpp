@@ -0,0 +1,170 @@
+#include "driver/adc.h"
+#include "EnergyModel.h"
+#include "NativeHal.h"
+#include "esp_adc_cal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define CONVERSION_BYTES 4
+
+uint32_t nativeAdcMilliVolts(uint8_t pin);
+
+static bool initialized = false;
+static bool running = false;
+static uint32_t storeBytes = 0;
+static uint32_t sampleFrequency = 0;
+static std::vector<adc_digi_pattern_config_t> patterns;
+static uint64_t startedAt = 0;
+static uint64_t delivered = 0;
+
+/**
+ * @brief Gets a conversion of the STACY_ADC_STREAM replay file, whose lines
+ * are "channel,millivolts". Each wake starts further into the stream.
+ * @param channel The channel being converted.
+ * @param index The conversion index within this wake.
+ * @param milliVolts Set to the recorded value.
+ * @return True if the stream has a value for this channel.
+ */
+static bool streamValue(uint8_t channel, uint64_t index, uint32_t &milliVolts) {
+  static std::vector<std::vector<uint32_t>> channels;
+  static bool loaded = false;
+  if (!loaded) {
+    loaded = true;
+    const char *path = NativeHal::envString("STACY_ADC_STREAM", nullptr);
+    FILE *file = path ? fopen(path, "r") : nullptr;
+    unsigned int recordedChannel, value;
+    char line[64];
+    while (file && fgets(line, sizeof(line), file)) {
+      if (sscanf(line, "%u,%u", &recordedChannel, &value) != 2)
+        continue;
+      if (recordedChannel >= channels.size())
+        channels.resize(recordedChannel + 1);
+      channels[recordedChannel].push_back(value);
+    }
+    if (file)
+      fclose(file);
+  }
+
+  if (channel >= channels.size() || channels[channel].empty())
+    return false;
+  const std::vector<uint32_t> &values = channels[channel];
+  size_t perWake = (size_t)NativeHal::envLong("STACY_ADC_STREAM_PER_WAKE", 64);
+  milliVolts = values[(NativeHal::wake() * perWake + index) % values.size()];
+  return true;
+}
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config) {
+  if (initialized)
+    return ESP_ERR_INVALID_STATE;
+  initialized = true;
+  storeBytes = init_config->max_store_buf_size;
+  return ESP_OK;
+}
+
+esp_err_t
+adc_digi_controller_configure(const adc_digi_configuration_t *config) {
+  if (!initialized || !config->pattern_num || !config->sample_freq_hz)
+    return ESP_ERR_INVALID_STATE;
+  patterns.assign(config->adc_pattern,
+                  config->adc_pattern + config->pattern_num);
+  sampleFrequency = config->sample_freq_hz;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_start() {
+  if (!initialized || patterns.empty())
+    return ESP_ERR_INVALID_STATE;
+  running = true;
+  startedAt = NativeHal::micros();
+  delivered = 0;
+  return ESP_OK;
+}
+
+/**
+ * @brief Returns the conversions completed since the start, waiting on the
+ * simulated clock for more when the buffer holds fewer than requested.
+ * Conversions beyond the store buffer size are lost, as on the chip.
+ */
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max,
+                              uint32_t *out_length, uint32_t timeout_ms) {
+  *out_length = 0;
+  if (!running)
+    return ESP_ERR_INVALID_STATE;
+
+  uint64_t wanted = length_max / CONVERSION_BYTES;
+  uint64_t deadline = timeout_ms == ADC_MAX_DELAY
+                          ? UINT64_MAX
+                          : NativeHal::micros() + timeout_ms * 1000ULL;
+  uint64_t completed =
+      (NativeHal::micros() - startedAt) * sampleFrequency / 1000000;
+  if (completed - delivered < wanted) {
+    uint64_t readyAt =
+        startedAt + (delivered + wanted) * 1000000 / sampleFrequency + 1;
+    uint64_t now = NativeHal::micros();
+    uint64_t until = readyAt < deadline ? readyAt : deadline;
+    if (until > now)
+      NativeHal::advance(until - now);
+    completed = (NativeHal::micros() - startedAt) * sampleFrequency / 1000000;
+  }
+
+  uint64_t stored = storeBytes / CONVERSION_BYTES;
+  if (completed - delivered > stored)
+    delivered = completed - stored;
+  uint64_t count = completed - delivered;
+  if (count > wanted)
+    count = wanted;
+  if (count == 0)
+    return ESP_ERR_TIMEOUT;
+
+  adc_digi_output_data_t *output = (adc_digi_output_data_t *)buf;
+  for (uint64_t i = 0; i < count; i++) {
+    const adc_digi_pattern_config_t &pattern =
+        patterns[(delivered + i) % patterns.size()];
+    uint32_t milliVolts;
+    if (!streamValue(pattern.channel, delivered + i, milliVolts))
+      milliVolts = nativeAdcMilliVolts(pattern.channel);
+    output[i].val = 0;
+    output[i].type2.data = milliVolts >= NATIVE_ADC_FULL_SCALE_MV
+                               ? 4095
+                               : milliVolts * 4095 / NATIVE_ADC_FULL_SCALE_MV;
+    output[i].type2.channel = pattern.channel;
+    output[i].type2.unit = 0;
+  }
+  delivered += count;
+  *out_length = count * CONVERSION_BYTES;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_stop() {
+  if (!running)
+    return ESP_ERR_INVALID_STATE;
+  running = false;
+  EnergyModel::consume(RAIL_ADC, NativeHal::micros() - startedAt);
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize() {
+  if (running)
+    adc_digi_stop();
+  initialized = false;
+  patterns.clear();
+  return ESP_OK;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(
+    adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+    uint32_t default_vref, esp_adc_cal_characteristics_t *chars) {
+  chars->adc_num = adc_num;
+  chars->atten = atten;
+  chars->bit_width = bit_width;
+  chars->vref = default_vref;
+  return ESP_ADC_CAL_VAL_EFUSE_TP;
+}
+
+uint32_t
+esp_adc_cal_raw_to_voltage(uint32_t adc_reading,
+                           const esp_adc_cal_characteristics_t *chars) {
+  return adc_reading * NATIVE_ADC_FULL_SCALE_MV / 4095;
+}
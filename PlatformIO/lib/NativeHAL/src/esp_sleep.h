@@ -0,0 +1,31 @@
+#ifndef ESP_SLEEP_H
+#define ESP_SLEEP_H
+
+#include "Arduino.h"
+#include "NativeHal.h"
+#include <stdint.h>
+
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED,
+  ESP_SLEEP_WAKEUP_ALL,
+  ESP_SLEEP_WAKEUP_EXT0,
+  ESP_SLEEP_WAKEUP_EXT1,
+  ESP_SLEEP_WAKEUP_TIMER,
+} esp_sleep_wakeup_cause_t;
+
+// The wake period is TIME_TO_SLEEP either way, the timer is not simulated
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  return ESP_OK;
+}
+
+[[noreturn]] inline void esp_deep_sleep_start() {
+  NativeHal::deepSleep();
+  __builtin_unreachable();
+}
+
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return NativeHal::wokeFromDeepSleep() ? ESP_SLEEP_WAKEUP_TIMER
+                                        : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#include "NativeHal.h"
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+// Every wake starts from power on, the TPL5110 having cut power, unless
+// the previous one went to deep sleep
+inline esp_reset_reason_t esp_reset_reason() {
+  return NativeHal::wokeFromDeepSleep() ? ESP_RST_DEEPSLEEP : ESP_RST_POWERON;
+}
+
+#endif
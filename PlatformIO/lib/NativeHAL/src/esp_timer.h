@@ -0,0 +1,10 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include "NativeHal.h"
+#include <stdint.h>
+
+// Microseconds since reset, the simulated wake clock
+inline int64_t esp_timer_get_time() { return NativeHal::micros(); }
+
+#endif
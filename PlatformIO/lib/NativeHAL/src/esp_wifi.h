@@ -0,0 +1,15 @@
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t interface, uint8_t mac[6]);
+
+#endif
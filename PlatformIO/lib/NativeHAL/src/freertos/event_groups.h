@@ -0,0 +1,56 @@
+#ifndef EVENT_GROUPS_H
+#define EVENT_GROUPS_H
+
+#include "NativeHal.h"
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+
+typedef struct NativeEventGroup {
+  EventBits_t bits;
+} *EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() {
+  return new NativeEventGroup();
+}
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+  return group->bits;
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group,
+                                      EventBits_t bits) {
+  return group->bits |= bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group,
+                                        EventBits_t bits) {
+  EventBits_t previous = group->bits;
+  group->bits &= ~bits;
+  return previous;
+}
+
+// Blocks as CPU idle time until the bits are set by a stand-in's timer,
+// such as a Wi-Fi event, or the ticks run out
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,
+                                       EventBits_t bits,
+                                       BaseType_t clearOnExit,
+                                       BaseType_t waitForAll,
+                                       TickType_t ticks) {
+  uint64_t deadline =
+      NativeHal::micros() + (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+  for (;;) {
+    EventBits_t set = group->bits;
+    bool satisfied =
+        waitForAll ? (set & bits) == bits : (set & bits) != 0;
+    uint64_t now = NativeHal::micros();
+    if (satisfied || now >= deadline) {
+      if (satisfied && clearOnExit)
+        group->bits &= ~bits;
+      return set;
+    }
+    NativeHal::idle(deadline - now);
+  }
+}
+
+#endif
@@ -0,0 +1,223 @@
+#include "adc_sampler.h"
+#include "logger.h"
+#include "phase_profiler.h"
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+#define ADC_CONVERSION_BYTES 4
+
+static const uint8_t continuousPins[ADC_CONTINUOUS_PINS] = {CAPACITANCE_PIN,
+                                                            BATTERY_PIN};
+static esp_adc_cal_characteristics_t adcCharacteristics;
+
+bool AdcSampler::continuousRunning = false;
+uint16_t AdcSampler::continuousSamples[ADC_CONTINUOUS_PINS][ADC_MAX_SAMPLES];
+size_t AdcSampler::continuousCount[ADC_CONTINUOUS_PINS];
+
+/**
+ * @brief Sorts samples in place. Insertion sort, the buffers are small.
+ * @param samples The samples to sort.
+ * @param count The number of samples.
+ */
+void AdcSampler::sort(uint16_t *samples, size_t count) {
+  for (size_t i = 1; i < count; i++) {
+    uint16_t sample = samples[i];
+    size_t j = i;
+    while (j > 0 && samples[j - 1] > sample) {
+      samples[j] = samples[j - 1];
+      j--;
+    }
+    samples[j] = sample;
+  }
+}
+
+/**
+ * @brief Starts converting the moisture and battery pins in the background
+ * with the continuous (DMA) driver, ADC_CONTINUOUS_SAMPLES each.
+ * @return True if the driver started, false to fall back to one-shot reads.
+ */
+bool AdcSampler::beginContinuous() {
+  if (!ADC_CONTINUOUS || continuousRunning)
+    return continuousRunning;
+  PhaseTimer timer(PHASE_ADC);
+
+  adc_digi_pattern_config_t pattern[ADC_CONTINUOUS_PINS];
+  uint32_t channelMask = 0;
+  for (size_t i = 0; i < ADC_CONTINUOUS_PINS; i++) {
+    int8_t channel = digitalPinToAnalogChannel(continuousPins[i]);
+    pattern[i].atten = ADC_ATTEN_DB_11;
+    pattern[i].channel = channel;
+    pattern[i].unit = 0;
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    channelMask |= 1 << channel;
+    continuousCount[i] = 0;
+  }
+
+  adc_digi_init_config_t initConfig = {};
+  initConfig.max_store_buf_size = 2 * ADC_CONTINUOUS_PINS *
+                                  ADC_CONTINUOUS_SAMPLES * ADC_CONVERSION_BYTES;
+  initConfig.conv_num_each_intr =
+      ADC_CONTINUOUS_PINS * ADC_CONTINUOUS_SAMPLES * ADC_CONVERSION_BYTES;
+  initConfig.adc1_chan_mask = channelMask;
+
+  adc_digi_configuration_t digitalConfig = {};
+  digitalConfig.conv_limit_en = false;
+  digitalConfig.conv_limit_num = 250;
+  digitalConfig.pattern_num = ADC_CONTINUOUS_PINS;
+  digitalConfig.adc_pattern = pattern;
+  digitalConfig.sample_freq_hz = ADC_CONTINUOUS_FREQ_HZ;
+  digitalConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digitalConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+
+  if (adc_digi_initialize(&initConfig) != ESP_OK) {
+    LOG_WARN("Continuous ADC unavailable. Using one-shot reads.");
+    return false;
+  }
+  if (adc_digi_controller_configure(&digitalConfig) != ESP_OK ||
+      adc_digi_start() != ESP_OK) {
+    LOG_WARN("Continuous ADC unavailable. Using one-shot reads.");
+    adc_digi_deinitialize();
+    return false;
+  }
+  esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                           1100, &adcCharacteristics);
+  continuousRunning = true;
+  return true;
+}
+
+/**
+ * @brief Waits for the background conversions, sorts them by pin and
+ * releases the driver so one-shot reads work again.
+ */
+void AdcSampler::collectContinuous() {
+  uint8_t frame[ADC_CONTINUOUS_PINS * ADC_CONTINUOUS_SAMPLES *
+                ADC_CONVERSION_BYTES];
+  unsigned long startTime = millis();
+
+  while (millis() - startTime < ADC_CONTINUOUS_TIMEOUT_MS) {
+    bool complete = true;
+    for (size_t i = 0; i < ADC_CONTINUOUS_PINS; i++) {
+      complete = complete && continuousCount[i] >= ADC_CONTINUOUS_SAMPLES;
+    }
+    if (complete)
+      break;
+
+    uint32_t length = 0;
+    if (adc_digi_read_bytes(frame, sizeof(frame), &length,
+                            ADC_CONTINUOUS_TIMEOUT_MS) != ESP_OK)
+      break;
+    for (uint32_t offset = 0; offset + ADC_CONVERSION_BYTES <= length;
+         offset += ADC_CONVERSION_BYTES) {
+      adc_digi_output_data_t *conversion =
+          (adc_digi_output_data_t *)&frame[offset];
+      for (size_t i = 0; i < ADC_CONTINUOUS_PINS; i++) {
+        if (conversion->type2.channel !=
+                digitalPinToAnalogChannel(continuousPins[i]) ||
+            continuousCount[i] >= ADC_CONTINUOUS_SAMPLES)
+          continue;
+        continuousSamples[i][continuousCount[i]++] = conversion->type2.data;
+      }
+    }
+  }
+
+  adc_digi_stop();
+  adc_digi_deinitialize();
+  continuousRunning = false;
+}
+
+/**
+ * @brief Finds the continuous buffer of a pin.
+ * @param pin The ADC pin.
+ * @return The buffer index, or -1 if the pin has no continuous samples.
+ */
+int AdcSampler::continuousIndex(uint8_t pin) {
+  for (size_t i = 0; i < ADC_CONTINUOUS_PINS; i++) {
+    if (continuousPins[i] == pin && continuousCount[i] > 0)
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Filters an ADC pin, from the continuous samples when the driver
+ * was started, or from blocking one-shot reads otherwise.
+ * @param pin The ADC pin.
+ * @param config The number of samples, filter and unit to use.
+ * @return The filtered value, in raw counts or in millivolts if calibrated.
+ */
+float AdcSampler::read(uint8_t pin, const AdcSamplerConfig &config) {
+  PhaseTimer timer(PHASE_ADC);
+  uint16_t samples[ADC_MAX_SAMPLES];
+  size_t count = config.samples < 1               ? 1
+                 : config.samples > ADC_MAX_SAMPLES ? ADC_MAX_SAMPLES
+                                                    : config.samples;
+
+  if (continuousRunning)
+    collectContinuous();
+
+  int index = continuousIndex(pin);
+  if (index >= 0) {
+    count = min(count, continuousCount[index]);
+    for (size_t i = 0; i < count; i++) {
+      uint16_t raw = continuousSamples[index][i];
+      samples[i] = config.calibrated
+                       ? esp_adc_cal_raw_to_voltage(raw, &adcCharacteristics)
+                       : raw;
+    }
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      samples[i] =
+          config.calibrated ? analogReadMilliVolts(pin) : analogRead(pin);
+    }
+  }
+
+  return reduce(samples, count, config);
+}
+
+/**
+ * @brief Reduces samples with the configured filter. The final sum runs
+ * over a contiguous window without branches, so the compiler can unroll it.
+ * @param samples The samples, sorted in place.
+ * @param count The number of samples.
+ * @param config The filter to use.
+ * @return The filtered value.
+ */
+float AdcSampler::reduce(uint16_t *samples, size_t count,
+                         const AdcSamplerConfig &config) {
+  size_t first = 0;
+  size_t last = count;
+  if (config.filter != ADC_FILTER_MEAN) {
+    sort(samples, count);
+    if (config.filter == ADC_FILTER_MEDIAN) {
+      return count % 2 ? samples[count / 2]
+                       : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+    }
+    // Keep at least one sample whatever the trim
+    size_t trim = min((size_t)config.trim, (count - 1) / 2);
+    first = trim;
+    last = count - trim;
+  }
+
+  uint32_t sum = 0;
+  for (size_t i = first; i < last; i++) {
+    sum += samples[i];
+  }
+  return (float)sum / (last - first);
+}
+
+/**
+ * @brief Maps a value linearly from one range to another, in floating point
+ * and clamped to the target range.
+ * @param value The value to map.
+ * @param fromLow The value mapped to toLow.
+ * @param fromHigh The value mapped to toHigh.
+ * @param toLow The lower end of the target range.
+ * @param toHigh The upper end of the target range.
+ * @return The mapped value.
+ */
+float AdcSampler::mapClamped(float value, float fromLow, float fromHigh,
+                             float toLow, float toHigh) {
+  float mapped =
+      toLow + (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow);
+  return constrain(mapped, min(toLow, toHigh), max(toLow, toHigh));
+}
@@ -1,6 +1,8 @@
 #include "battery_monitor.h"
+#include "adc_sampler.h"
 #include "configuration.h"
-#include "debug.h"
+#include "logger.h"
+#include "phase_profiler.h"
 #include <Arduino.h>
 
 /**
@@ -8,12 +10,11 @@
  * @return The battery voltage.
  */
 float BatteryMonitor::readBatteryVoltage() {
-  uint32_t Vbatt = 0;
-  for (int i = 0; i < 16; i++) {
-    Vbatt = Vbatt + analogReadMilliVolts(BATTERY_PIN);
-  }
+  static const AdcSamplerConfig sampling = {BATTERY_SAMPLES, BATTERY_FILTER,
+                                            BATTERY_TRIM, true};
+  float Vbatt = AdcSampler::read(BATTERY_PIN, sampling);
   // attenuation ratio 1/2, mV --> V
-  float Vbattf = 2 * Vbatt / 16 / 1000.0;
+  float Vbattf = 2 * Vbatt / 1000.0;
 
   return Vbattf;
 }
@@ -39,6 +40,7 @@ float BatteryMonitor::calculateBatteryPercentage(float voltage) {
  * @param percentage Reference to store the battery percentage.
  */
 void BatteryMonitor::getBatteryStatus(SensorData &sensorData) {
+  PhaseTimer timer(PHASE_BATTERY);
   sensorData.batteryVoltage = readBatteryVoltage();
   sensorData.batteryPercentage =
       calculateBatteryPercentage(sensorData.batteryVoltage);
@@ -0,0 +1,59 @@
+#include "bme280_sensor.h"
+#include "i2c_scheduler.h"
+#include "logger.h"
+#include <Wire.h>
+
+#if SENSOR_BME280
+
+// Maximum forced conversion time of temperature, pressure and humidity at 1x
+#define BME280_CONVERSION_US 9300
+
+// Forced mode, 1x oversampling, address 0x76
+static BME280I2C::Settings settings;
+BME280I2C Bme280Sensor::bme280(settings);
+
+/**
+ * @brief Initializes the BME280 sensor.
+ * @return True if a BME280 answered, false otherwise.
+ */
+bool Bme280Sensor::begin() {
+  Wire.begin();
+  if (!bme280.begin() || bme280.chipModel() != BME280::ChipModel_BME280) {
+    LOG_ERROR("BME280 sensor initialization failed.");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Starts a forced conversion by writing the settings again.
+ * @param sensorData Reference to the SensorData struct to populate.
+ * @return Always true.
+ */
+bool Bme280Sensor::trigger(SensorData &sensorData) {
+  bme280.setSettings(settings);
+  I2cScheduler::expect(BME280_CONVERSION_US);
+  return true;
+}
+
+/**
+ * @brief Reads the temperature and humidity. In forced mode, read() starts
+ * another conversion and reads the data registers right away, so it
+ * returns the one started by trigger().
+ * @param sensorData Reference to the SensorData struct to populate.
+ * @return True if a measurement was read.
+ */
+bool Bme280Sensor::collect(SensorData &sensorData) {
+  float pressure, temperature, humidity;
+  bme280.read(pressure, temperature, humidity, BME280::TempUnit_Celsius,
+              BME280::PresUnit_hPa);
+  if (isnan(temperature) || isnan(humidity)) {
+    LOG_ERROR("Failed to read temperature and humidity from BME280 sensor.");
+    return false;
+  }
+  sensorData.temperature = temperature;
+  sensorData.humidity = humidity;
+  return true;
+}
+
+#endif
@@ -1,7 +1,8 @@
 #include "captive_portal.h"
 
 #include "configuration.h"
-#include "debug.h"
+#include "device_config.h"
+#include "logger.h"
 
 #include <ArduinoJson.h>
 #include <DNSServer.h>
@@ -11,12 +12,8 @@
 #include <WiFi.h>
 #include <network_handler.h>
 
-DNSServer dnsServer;
-WebServer server(80);
-Preferences initialModePreferences;
-
 void CaptivePortal::begin() {
-  DEBUGLN("Starting Initial Mode (Captive Portal)");
+  LOG_INFO("Starting Initial Mode (Captive Portal)");
 
   // random 4 digit suffix for the SSID
   String randomSuffix = String(random(1000, 9999));
@@ -27,9 +24,9 @@ void CaptivePortal::begin() {
   WiFi.softAP(SSID);
   IPAddress apIP(192, 168, 4, 1);
   if (!WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0))) {
-    DEBUGLN("Failed to configure AP");
+    LOG_ERROR("Failed to configure AP");
   }
-  DEBUGLN("AP IP address: " + apIP.toString());
+  LOG_INFO("AP IP address: %s", apIP.toString().c_str());
   dnsServer.start(DNS_PORT, "*", apIP);
 
   startServer();
@@ -44,7 +41,7 @@ void CaptivePortal::startServer() {
   server.onNotFound([this]() { handleNotFound(); });
 
   server.begin();
-  DEBUGLN("HTTP server started.");
+  LOG_INFO("HTTP server started.");
 
   while (true) {
     if (WiFi.getMode() == WIFI_AP) {
@@ -64,13 +61,13 @@ void CaptivePortal::handleCredentials() {
     return;
   }
 
-  DEBUGLN("Received body: " + body);
+  LOG_DEBUG("Received body: %s", body.c_str());
 
   JsonDocument doc;
   DeserializationError error = deserializeJson(doc, body);
 
   if (error) {
-    DEBUGLN("JSON parsing failed: " + String(error.c_str()));
+    LOG_WARN("JSON parsing failed: %s", error.c_str());
     server.send(400, "application/json",
                 R"({"success":false,"error":"Invalid JSON"})");
     return;
@@ -86,14 +83,12 @@ void CaptivePortal::handleCredentials() {
     return;
   }
 
-  DEBUGLN("UID: " + uid);
-  DEBUGLN("Bearer Token: " + bearer_token);
+  LOG_DEBUG("UID: %s", uid.c_str());
+  LOG_DEBUG("Bearer Token: %s", bearer_token.c_str());
 
-  initialModePreferences.begin("stacy", false);
-  initialModePreferences.putString("uid", uid);
-  initialModePreferences.putString("bearer_token", bearer_token);
-  initialModePreferences.putString("plant_name", plant_name);
-  initialModePreferences.end();
+  DeviceConfig::setAccount(uid.c_str(), bearer_token.c_str());
+  DeviceConfig::setPlantName(plant_name.c_str());
+  DeviceConfig::commit();
 
   delay(DELAY_SHORT);
   NetworkHandler::createPlant(String(plant_name));
@@ -115,25 +110,24 @@ void CaptivePortal::handleConnect() {
 
   if (error) {
     // If parsing fails, send an error response
-    DEBUG("deserializeJson() failed: ");
-    DEBUGLN(error.c_str());
+    LOG_WARN("deserializeJson() failed: %s", error.c_str());
     server.send(400, "application/json",
                 R"({"success":false, "error":"Invalid JSON"})");
     return;
   }
 
-  DEBUGLN("Credentials received.");
-  DEBUGLN("Request body: " + doc.as<String>());
+  LOG_INFO("Credentials received.");
+  LOG_DEBUG("Request body: %s", doc.as<String>().c_str());
 
   const char *ssid = doc["ssid"];
   const char *wifi_password = doc["wifi_password"];
   const char *plant_name = doc["plant_name"];
 
-  DEBUGLN("SSID: " + String(ssid));
-  DEBUGLN("wifi_password: " + String(wifi_password));
-  DEBUGLN("plant_name: " + String(plant_name));
-  // DEBUGLN("email: " + String(email));
-  // DEBUGLN("user_password: " + String(user_password));
+  LOG_DEBUG("SSID: %s", ssid ? ssid : "");
+  LOG_DEBUG("wifi_password: %s", wifi_password ? wifi_password : "");
+  LOG_DEBUG("plant_name: %s", plant_name ? plant_name : "");
+  // LOG_DEBUG("email: %s", email);
+  // LOG_DEBUG("user_password: %s", user_password);
 
   if (!plant_name || !ssid || !wifi_password) {
     server.send(400, "application/json",
@@ -141,10 +135,11 @@ void CaptivePortal::handleConnect() {
     return;
   }
 
+  DeviceConfig::setWiFi(ssid, wifi_password);
+  DeviceConfig::setPlantName(plant_name);
+  DeviceConfig::commit();
   initialModePreferences.begin("stacy", false);
-  initialModePreferences.putString("ssid", ssid);
-  initialModePreferences.putString("wifi_password", wifi_password);
-  initialModePreferences.putString("plant_name", plant_name);
+  initialModePreferences.remove("wifi_cache");
   initialModePreferences.end();
 
   server.send(200, "application/json", R"({"success":true})");
@@ -156,7 +151,7 @@ void CaptivePortal::handleConnect() {
   server.stop();
   WiFi.softAPdisconnect(true);
   WiFi.mode(WIFI_STA);
-  DEBUGLN("Captive portal stopped.");
+  LOG_INFO("Captive portal stopped.");
 
   CaptivePortal::startMDNS();
   return;
@@ -167,26 +162,24 @@ void CaptivePortal::startMDNS() {
   delay(DELAY_SHORT);
 
   if (WiFi.status() != WL_CONNECTED) {
-    DEBUGLN("Failed to connect to WiFi. Cannot start mDNS.");
-    initialModePreferences.begin("stacy", false);
-    initialModePreferences.remove("ssid");
-    initialModePreferences.remove("wifi_password");
-    initialModePreferences.end();
+    LOG_ERROR("Failed to connect to WiFi. Cannot start mDNS.");
+    DeviceConfig::clearWiFi();
+    DeviceConfig::commit();
     return;
   }
 
   if (!MDNS.begin("plantstation")) {
-    DEBUGLN("Error setting up mDNS responder!");
+    LOG_ERROR("Error setting up mDNS responder!");
     return;
   }
-  DEBUGLN("mDNS responder started: http://plantstation.local");
+  LOG_INFO("mDNS responder started: http://plantstation.local");
   MDNS.addService("http", "tcp", 80);
 
   startServer();
 }
 
 void CaptivePortal::handleScan() {
-  DEBUGLN("Scanning for WiFi networks...");
+  LOG_DEBUG("Scanning for WiFi networks...");
   int n = WiFi.scanNetworks();
   String json = "[";
   for (int i = 0; i < n; ++i) {
@@ -196,7 +189,7 @@ void CaptivePortal::handleScan() {
   }
   json += "]";
   server.send(200, "application/json", json);
-  DEBUGLN("Scan complete. Sent " + String(n) + " networks.");
+  LOG_DEBUG("Scan complete. Sent %d networks.", n);
 }
 
 void CaptivePortal::handleNotFound() {
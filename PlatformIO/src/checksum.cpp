@@ -0,0 +1,18 @@
+#include "checksum.h"
+
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3) of a buffer.
+ * @param data The bytes to check.
+ * @param size The number of bytes.
+ * @return The CRC.
+ */
+uint32_t Checksum::crc32(const uint8_t *data, size_t size) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,261 @@
+#include "device_config.h"
+#include "checksum.h"
+#include "logger.h"
+#include "phase_profiler.h"
+#include <Preferences.h>
+
+#define DEVICE_CONFIG_MAGIC 0x53544346 // "STCF"
+#define DEVICE_CONFIG_VERSION 1
+
+// Keys of the layout used before the configuration blob
+static const char *const legacyKeys[] = {
+    "ssid", "wifi_password", "uid", "bearer_token", "plant_name", "plant_id"};
+
+Preferences configPreferences;
+DeviceConfigData DeviceConfig::data;
+bool DeviceConfig::loaded = false;
+bool DeviceConfig::dirty = false;
+bool DeviceConfig::migrated = false;
+uint8_t DeviceConfig::storedMode = BOOT_MODE_UNKNOWN;
+bool DeviceConfig::modeRead = false;
+
+/**
+ * @brief Computes the CRC of the settings, the header excluded.
+ * @param config The configuration.
+ * @return The CRC.
+ */
+uint32_t DeviceConfig::checksum(const DeviceConfigData &config) {
+  size_t offset = offsetof(DeviceConfigData, crc) + sizeof(config.crc);
+  return Checksum::crc32((const uint8_t *)&config + offset,
+                         sizeof(DeviceConfigData) - offset);
+}
+
+/**
+ * @brief Checks that a stored configuration is intact and of this layout.
+ * @param config The configuration read from NVS.
+ * @param length The number of bytes read.
+ * @return True if the configuration can be used, false otherwise.
+ */
+bool DeviceConfig::isValid(const DeviceConfigData &config, size_t length) {
+  return length == sizeof(DeviceConfigData) &&
+         config.magic == DEVICE_CONFIG_MAGIC &&
+         config.version == DEVICE_CONFIG_VERSION &&
+         config.size == sizeof(DeviceConfigData) &&
+         config.crc == checksum(config);
+}
+
+/**
+ * @brief Reads the settings from the former one-key-per-setting layout.
+ * The preferences must be open.
+ * @return True if any setting was found.
+ */
+bool DeviceConfig::loadLegacy() {
+  if (!configPreferences.isKey("ssid") && !configPreferences.isKey("uid"))
+    return false;
+  set(data.ssid, sizeof(data.ssid),
+      configPreferences.getString("ssid").c_str());
+  set(data.wifiPassword, sizeof(data.wifiPassword),
+      configPreferences.getString("wifi_password").c_str());
+  set(data.uid, sizeof(data.uid), configPreferences.getString("uid").c_str());
+  set(data.bearerToken, sizeof(data.bearerToken),
+      configPreferences.getString("bearer_token").c_str());
+  set(data.plantName, sizeof(data.plantName),
+      configPreferences.getString("plant_name").c_str());
+  set(data.plantId, sizeof(data.plantId),
+      configPreferences.getString("plant_id").c_str());
+  return true;
+}
+
+/**
+ * @brief Loads the configuration from NVS, once per wake.
+ */
+void DeviceConfig::begin() {
+  if (loaded)
+    return;
+  loaded = true;
+
+  PhaseTimer timer(PHASE_NVS);
+  configPreferences.begin("stacy", true);
+  size_t length =
+      configPreferences.getBytes("config", &data, sizeof(DeviceConfigData));
+  if (!modeRead) {
+    storedMode = configPreferences.getUChar("boot_mode", BOOT_MODE_UNKNOWN);
+    modeRead = true;
+  }
+  if (!isValid(data, length)) {
+    memset(&data, 0, sizeof(DeviceConfigData));
+    if (loadLegacy()) {
+      LOG_INFO("Device configuration migrated from separate keys.");
+      migrated = true;
+      dirty = true;
+    } else if (length > 0) {
+      LOG_WARN("Stored device configuration is invalid. Ignoring it.");
+    }
+  }
+  configPreferences.end();
+}
+
+/**
+ * @brief Gets the stored boot mode, without loading the configuration.
+ * @return The mode the last commit() derived, BOOT_MODE_UNKNOWN if none.
+ */
+BootMode DeviceConfig::bootMode() {
+  if (!modeRead) {
+    PhaseTimer timer(PHASE_NVS);
+    configPreferences.begin("stacy", true);
+    storedMode = configPreferences.getUChar("boot_mode", BOOT_MODE_UNKNOWN);
+    configPreferences.end();
+    modeRead = true;
+  }
+  return (BootMode)storedMode;
+}
+
+/**
+ * @brief Derives the boot mode from a configuration, with the conditions
+ * setup() uses to choose between the portal, mDNS and normal mode.
+ * @param config The configuration.
+ * @return BOOT_MODE_NORMAL if a wake can go straight to the sensors.
+ */
+BootMode DeviceConfig::modeOf(const DeviceConfigData &config) {
+  bool provisioned = strlen(config.ssid) > 1 &&
+                     strlen(config.wifiPassword) > 1 &&
+                     strlen(config.uid) > 1 &&
+                     strlen(config.bearerToken) > 1 && config.plantId[0];
+  return provisioned ? BOOT_MODE_NORMAL : BOOT_MODE_SETUP;
+}
+
+/**
+ * @brief Gets the configuration snapshot.
+ * @return The configuration.
+ */
+const DeviceConfigData &DeviceConfig::get() {
+  begin();
+  return data;
+}
+
+/**
+ * @brief Copies a setting into its field.
+ * @param field The field.
+ * @param size The size of the field.
+ * @param value The new value.
+ * @return True if the value fit, false if it was truncated.
+ */
+bool DeviceConfig::set(char *field, size_t size, const char *value) {
+  if (strncmp(field, value, size) != 0) {
+    strncpy(field, value, size - 1);
+    field[size - 1] = '\0';
+    dirty = true;
+  }
+  if (strlen(value) >= size) {
+    LOG_WARN("Setting too long for the device configuration. Truncated.");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Sets the Wi-Fi credentials.
+ * @param ssid The network name.
+ * @param wifiPassword The network password.
+ * @return True if both fit.
+ */
+bool DeviceConfig::setWiFi(const char *ssid, const char *wifiPassword) {
+  begin();
+  bool ssidFits = set(data.ssid, sizeof(data.ssid), ssid);
+  return set(data.wifiPassword, sizeof(data.wifiPassword), wifiPassword) &&
+         ssidFits;
+}
+
+/**
+ * @brief Forgets the Wi-Fi credentials.
+ */
+void DeviceConfig::clearWiFi() { setWiFi("", ""); }
+
+/**
+ * @brief Sets the account the device reports to.
+ * @param uid The user ID.
+ * @param bearerToken The bearer token.
+ * @return True if both fit.
+ */
+bool DeviceConfig::setAccount(const char *uid, const char *bearerToken) {
+  begin();
+  bool uidFits = set(data.uid, sizeof(data.uid), uid);
+  return set(data.bearerToken, sizeof(data.bearerToken), bearerToken) &&
+         uidFits;
+}
+
+/**
+ * @brief Sets the bearer token, after a refresh.
+ * @param bearerToken The bearer token.
+ * @return True if it fits.
+ */
+bool DeviceConfig::setBearerToken(const char *bearerToken) {
+  begin();
+  return set(data.bearerToken, sizeof(data.bearerToken), bearerToken);
+}
+
+/**
+ * @brief Sets the plant name.
+ * @param plantName The plant name.
+ * @return True if it fits.
+ */
+bool DeviceConfig::setPlantName(const char *plantName) {
+  begin();
+  return set(data.plantName, sizeof(data.plantName), plantName);
+}
+
+/**
+ * @brief Sets the plant ID returned by the server.
+ * @param plantId The plant ID.
+ * @return True if it fits.
+ */
+bool DeviceConfig::setPlantId(const char *plantId) {
+  begin();
+  return set(data.plantId, sizeof(data.plantId), plantId);
+}
+
+/**
+ * @brief Writes the configuration to NVS if it changed since it was loaded,
+ * in a single write, and the boot mode if it no longer matches. Call before
+ * power is cut.
+ * @return True if nothing needed writing or the write succeeded.
+ */
+bool DeviceConfig::commit() {
+  BootMode mode = modeOf(data);
+  if (!loaded || (!dirty && mode == storedMode))
+    return true;
+
+  PhaseTimer timer(PHASE_NVS);
+  configPreferences.begin("stacy", false);
+  bool written = true;
+  if (dirty) {
+    data.magic = DEVICE_CONFIG_MAGIC;
+    data.version = DEVICE_CONFIG_VERSION;
+    data.size = sizeof(DeviceConfigData);
+    data.crc = checksum(data);
+    written = configPreferences.putBytes("config", &data,
+                                         sizeof(DeviceConfigData)) ==
+              sizeof(DeviceConfigData);
+  }
+  // The blob is in place before the keys it replaces are dropped
+  if (written && migrated) {
+    for (const char *key : legacyKeys) {
+      configPreferences.remove(key);
+    }
+    migrated = false;
+  }
+  // and before the mode that lets the next wake rely on it
+  if (written && mode != storedMode) {
+    configPreferences.putUChar("boot_mode", mode);
+    storedMode = mode;
+  }
+  configPreferences.end();
+
+  if (!written) {
+    LOG_ERROR("Failed to write the device configuration.");
+    return false;
+  }
+  dirty = false;
+  LOG_DEBUG("Device configuration saved.");
+  return true;
+}
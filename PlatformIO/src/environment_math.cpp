@@ -0,0 +1,91 @@
+#include "environment_math.h"
+#include <math.h>
+
+// Magnus coefficients of Alduchov and Eskridge
+#define MAGNUS_A 17.625f
+#define MAGNUS_B 243.04f
+
+#define LN_2 0.69314718f
+#define FLOAT_MANTISSA 0x007FFFFF
+#define FLOAT_ONE 0x3F800000
+#define FLOAT_HALF 0x3F000000
+#define SQRT_2_MANTISSA 0x003504F3 // mantissa bits of sqrt(2)
+
+/**
+ * @brief Natural logarithm of a positive, normal float. The value is split
+ * into m * 2^e with m in [sqrt(1/2), sqrt(2)) using integer operations,
+ * then ln(m) = 2 atanh(s), with s = (m - 1) / (m + 1) and |s| < 0.172, is
+ * summed to the s^7 term. The series error is below 2 * 0.172^9 / 9,
+ * 3e-8, less than the float rounding.
+ * @param value The value.
+ * @return Its logarithm.
+ */
+float EnvironmentMath::logarithm(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int32_t exponent = (int32_t)(bits >> 23) - 127;
+  uint32_t mantissa = bits & FLOAT_MANTISSA;
+  if (mantissa > SQRT_2_MANTISSA) {
+    bits = mantissa | FLOAT_HALF;
+    exponent++;
+  } else {
+    bits = mantissa | FLOAT_ONE;
+  }
+  float m;
+  memcpy(&m, &bits, sizeof(m));
+
+  float s = (m - 1.0f) / (m + 1.0f);
+  float s2 = s * s;
+  float series =
+      1.0f + s2 * (1.0f / 3.0f + s2 * (1.0f / 5.0f + s2 * (1.0f / 7.0f)));
+  return exponent * LN_2 + 2.0f * s * series;
+}
+
+/**
+ * @brief Dew point, from the Magnus formula.
+ * @param celsius The temperature, in °C.
+ * @param humidity The relative humidity, in %.
+ * @return The dew point in °C, NaN if the humidity is not above 0.
+ */
+float EnvironmentMath::dewPoint(float celsius, float humidity) {
+  if (!(humidity > 0.0f) || isnan(celsius))
+    return NAN;
+  float gamma = logarithm(humidity * 0.01f) +
+                MAGNUS_A * celsius / (MAGNUS_B + celsius);
+  return MAGNUS_B * gamma / (MAGNUS_A - gamma);
+}
+
+/**
+ * @brief NWS heat index: Steadman's simple formula, then the Rothfusz
+ * regression and its adjustments above 79 °F. The regression is evaluated
+ * as a polynomial in the humidity whose coefficients are polynomials in the
+ * temperature, with 8 multiplications instead of 16.
+ * @param celsius The temperature, in °C.
+ * @param humidity The relative humidity, in %.
+ * @return The heat index in °C.
+ */
+float EnvironmentMath::heatIndex(float celsius, float humidity) {
+  if (isnan(celsius) || isnan(humidity))
+    return NAN;
+
+  float t = celsius * 1.8f + 32.0f;
+  float heatIndex = t;
+
+  if (t > 40.0f) {
+    heatIndex = 1.1f * t - 10.3f + 0.047f * humidity;
+    if (heatIndex >= 79.0f) {
+      float c0 = -42.379f + t * (2.04901523f - 0.00683783f * t);
+      float c1 = 10.14333127f + t * (-0.22475541f + 0.00122874f * t);
+      float c2 = -0.05481717f + t * (0.00085282f - 0.00000199f * t);
+      heatIndex = c0 + humidity * (c1 + humidity * c2);
+      if (humidity < 13.0f && t >= 80.0f && t <= 112.0f) {
+        heatIndex -= (13.0f - humidity) * 0.25f *
+                     sqrtf((17.0f - fabsf(t - 95.0f)) * 0.05882f);
+      } else if (humidity > 85.0f && t >= 80.0f && t <= 87.0f) {
+        heatIndex += 0.02f * (humidity - 85.0f) * (87.0f - t);
+      }
+    }
+  }
+
+  return (heatIndex - 32.0f) * (5.0f / 9.0f);
+}
@@ -0,0 +1,190 @@
+#include "hdc3022_sensor.h"
+#include "i2c_scheduler.h"
+#include "logger.h"
+
+#if SENSOR_HDC3022
+
+#define HDC_LOW_POWER_LEVELS 4
+#define HDC_READ_MIN_TEMPERATURE 0xE002
+#define HDC_READ_MAX_TEMPERATURE 0xE003
+#define HDC_READ_MIN_HUMIDITY 0xE004
+#define HDC_READ_MAX_HUMIDITY 0xE005
+
+Adafruit_HDC302x Hdc3022Sensor::hdc3022;
+uint8_t Hdc3022Sensor::level = 0;
+bool Hdc3022Sensor::converting = false;
+
+// LP0 (slowest, lowest noise) to LP3 (fastest)
+static const hdcTriggerMode triggerModes[HDC_LOW_POWER_LEVELS] = {
+    TRIGGERMODE_LP0, TRIGGERMODE_LP1, TRIGGERMODE_LP2, TRIGGERMODE_LP3};
+static const hdcAutoMode autoModes[HDC_LOW_POWER_LEVELS] = {
+    AUTO_MEASUREMENT_0_5MPS_LP0, AUTO_MEASUREMENT_0_5MPS_LP1,
+    AUTO_MEASUREMENT_0_5MPS_LP2, AUTO_MEASUREMENT_0_5MPS_LP3};
+// Maximum conversion time of each level, in µs
+static const uint16_t conversionMicros[HDC_LOW_POWER_LEVELS] = {12500, 7500,
+                                                                5000, 3700};
+// Approximate temperature repeatability of each level, in °C
+static const float repeatability[HDC_LOW_POWER_LEVELS] = {0.01, 0.015, 0.025,
+                                                          0.04};
+
+/**
+ * @brief Initializes the HDC3022 sensor.
+ * @return True if the sensor is initialized successfully, false otherwise.
+ */
+bool Hdc3022Sensor::begin() {
+  if (!hdc3022.begin(HDC3022_ADDR)) {
+    LOG_ERROR("HDC3022 sensor initialization failed.");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Chooses the HDC3022 low-power level: the cheapest one meeting
+ * HDC_PRECISION_C, one level cheaper on low battery, LP3 on critical.
+ * @param batteryPercentage The battery level.
+ * @return The level, 0 (LP0) to 3 (LP3).
+ */
+uint8_t Hdc3022Sensor::selectLowPowerLevel(float batteryPercentage) {
+  uint8_t level = 0;
+  while (level + 1 < HDC_LOW_POWER_LEVELS &&
+         repeatability[level + 1] <= HDC_PRECISION_C) {
+    level++;
+  }
+  if (batteryPercentage < REPORT_CRITICAL_BATTERY) {
+    level = HDC_LOW_POWER_LEVELS - 1;
+  } else if (batteryPercentage < REPORT_LOW_BATTERY &&
+             level + 1 < HDC_LOW_POWER_LEVELS) {
+    level++;
+  }
+  return level;
+}
+
+/**
+ * @brief Checks the CRC of a 16-bit word sent by the sensor.
+ * @param data The two data bytes followed by their CRC.
+ * @return True if the CRC matches.
+ */
+bool Hdc3022Sensor::checkCrc(const uint8_t *data) {
+  // CRC-8, polynomial 0x31, initial value 0xFF
+  uint8_t crc = 0xFF;
+  for (int i = 0; i < 2; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+    }
+  }
+  return crc == data[2];
+}
+
+/**
+ * @brief Converts a raw temperature, in single precision.
+ * @param raw The 16-bit value sent by the sensor.
+ * @return The temperature in °C.
+ */
+static float toCelsius(uint16_t raw) {
+  return -45.0f + raw * (175.0f / 65535.0f);
+}
+
+/**
+ * @brief Converts a raw relative humidity, in single precision.
+ * @param raw The 16-bit value sent by the sensor.
+ * @return The relative humidity in %.
+ */
+static float toHumidity(uint16_t raw) { return raw * (100.0f / 65535.0f); }
+
+/**
+ * @brief Reads one of the auto-measurement min/max history registers.
+ * @param command The register read command.
+ * @param value Set to the value in °C or %RH.
+ * @return True if the read succeeded and its CRC matched.
+ */
+bool Hdc3022Sensor::readHistoryValue(uint16_t command, float &value) {
+  uint8_t data[3];
+  if (!I2cScheduler::command(HDC3022_ADDR, command) ||
+      !I2cScheduler::read(HDC3022_ADDR, data, sizeof(data)) ||
+      !checkCrc(data))
+    return false;
+
+  uint16_t raw = data[0] << 8 | data[1];
+  value = command <= HDC_READ_MAX_TEMPERATURE ? toCelsius(raw)
+                                              : toHumidity(raw);
+  return true;
+}
+
+/**
+ * @brief Reads the extremes measured by the sensor since the previous wake.
+ * @param sensorData Reference to the SensorData struct to populate.
+ */
+void Hdc3022Sensor::readHistory(SensorData &sensorData) {
+  sensorData.hasHistory =
+      readHistoryValue(HDC_READ_MIN_TEMPERATURE, sensorData.temperatureMin) &&
+      readHistoryValue(HDC_READ_MAX_TEMPERATURE, sensorData.temperatureMax) &&
+      readHistoryValue(HDC_READ_MIN_HUMIDITY, sensorData.humidityMin) &&
+      readHistoryValue(HDC_READ_MAX_HUMIDITY, sensorData.humidityMax);
+  if (!sensorData.hasHistory) {
+    LOG_WARN("Failed to read HDC3022 min/max history.");
+  }
+}
+
+/**
+ * @brief Starts a measurement. In auto-measurement mode, the latest
+ * measurement and the history are read right away; otherwise an on-demand
+ * conversion is triggered, to be read by collect().
+ * @param sensorData Reference to the SensorData struct to populate, with the
+ * battery already read.
+ * @return True if a measurement was read or triggered.
+ */
+bool Hdc3022Sensor::trigger(SensorData &sensorData) {
+  LOG_DEBUG("Reading HDC3022 sensor...");
+  level = selectLowPowerLevel(sensorData.batteryPercentage);
+  converting = false;
+  LOG_DEBUG("HDC3022 low-power level: LP%u", level);
+
+  double temperature, humidity;
+  if (HDC_AUTO_MODE && hdc3022.readAutoTempRH(temperature, humidity)) {
+    sensorData.temperature = temperature;
+    sensorData.humidity = humidity;
+    readHistory(sensorData);
+    // Restarting the mode clears the history and applies the new level
+    hdc3022.setAutoMode(EXIT_AUTO_MODE);
+    hdc3022.setAutoMode(autoModes[level]);
+    return true;
+  }
+
+  if (!I2cScheduler::command(HDC3022_ADDR, triggerModes[level])) {
+    LOG_ERROR("Failed to trigger an HDC3022 conversion.");
+    return false;
+  }
+  I2cScheduler::expect(conversionMicros[level]);
+  converting = true;
+  return true;
+}
+
+/**
+ * @brief Reads the conversion started by trigger(), if any.
+ * @param sensorData Reference to the SensorData struct to populate.
+ * @return True if a measurement was read.
+ */
+bool Hdc3022Sensor::collect(SensorData &sensorData) {
+  if (!converting)
+    return true;
+  converting = false;
+
+  // Temperature then humidity, each followed by its CRC
+  uint8_t data[6];
+  if (!I2cScheduler::read(HDC3022_ADDR, data, sizeof(data)) ||
+      !checkCrc(data) || !checkCrc(data + 3)) {
+    LOG_ERROR("Failed to read temperature and humidity from HDC3022 sensor.");
+    return false;
+  }
+  sensorData.temperature = toCelsius(data[0] << 8 | data[1]);
+  sensorData.humidity = toHumidity(data[3] << 8 | data[4]);
+
+  if (HDC_AUTO_MODE) {
+    hdc3022.setAutoMode(autoModes[level]);
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "i2c_scheduler.h"
+#include "logger.h"
+#include <Wire.h>
+
+uint32_t I2cScheduler::firstTransaction = 0;
+uint32_t I2cScheduler::readyTime = 0;
+bool I2cScheduler::pending = false;
+I2cTransaction I2cScheduler::log[I2C_LOG_SIZE];
+size_t I2cScheduler::logCount = 0;
+
+/**
+ * @brief Adds a transaction to the log, dropping it once the log is full.
+ * @param address The device address.
+ * @param size The number of bytes written or read.
+ * @param read True for a read, false for a write.
+ * @param acknowledged True if the device acknowledged it.
+ * @param start The micros() at which it started.
+ */
+void I2cScheduler::record(uint8_t address, size_t size, bool read,
+                          bool acknowledged, uint32_t start) {
+  uint32_t end = micros();
+  if (logCount == 0)
+    firstTransaction = start;
+  if (logCount >= I2C_LOG_SIZE)
+    return;
+  I2cTransaction &entry = log[logCount++];
+  entry.address = address;
+  entry.size = size;
+  entry.read = read;
+  entry.acknowledged = acknowledged;
+  entry.start = start - firstTransaction;
+  entry.duration = end - start;
+}
+
+/**
+ * @brief Writes bytes to a device.
+ * @param address The device address.
+ * @param data The bytes to write.
+ * @param size The number of bytes.
+ * @return True if the device acknowledged the write.
+ */
+bool I2cScheduler::write(uint8_t address, const uint8_t *data, size_t size) {
+  uint32_t start = micros();
+  Wire.beginTransmission(address);
+  Wire.write(data, size);
+  bool acknowledged = Wire.endTransmission() == 0;
+  record(address, size, false, acknowledged, start);
+  return acknowledged;
+}
+
+/**
+ * @brief Writes a 16-bit command, most significant byte first.
+ * @param address The device address.
+ * @param command The command.
+ * @return True if the device acknowledged the command.
+ */
+bool I2cScheduler::command(uint8_t address, uint16_t command) {
+  uint8_t data[2] = {(uint8_t)(command >> 8), (uint8_t)(command & 0xFF)};
+  return write(address, data, sizeof(data));
+}
+
+/**
+ * @brief Reads bytes from a device. A device still converting NACKs the
+ * read, which is retried I2C_READ_RETRIES times I2C_RETRY_US apart.
+ * @param address The device address.
+ * @param data Filled with the bytes read.
+ * @param size The number of bytes to read.
+ * @return True if all the bytes were read.
+ */
+bool I2cScheduler::read(uint8_t address, uint8_t *data, size_t size) {
+  for (int attempt = 0; attempt <= I2C_READ_RETRIES; attempt++) {
+    if (attempt > 0)
+      delayMicroseconds(I2C_RETRY_US);
+    uint32_t start = micros();
+    bool acknowledged = Wire.requestFrom(address, (uint8_t)size) == size;
+    record(address, size, true, acknowledged, start);
+    if (acknowledged) {
+      for (size_t i = 0; i < size; i++) {
+        data[i] = Wire.read();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Declares a conversion triggered just now.
+ * @param conversionMicros How long the device needs before it can be read.
+ */
+void I2cScheduler::expect(uint32_t conversionMicros) {
+  uint32_t ready = micros() + conversionMicros;
+  if (!pending || (int32_t)(ready - readyTime) > 0)
+    readyTime = ready;
+  pending = true;
+}
+
+/**
+ * @brief Waits until the slowest expected conversion is done. delay()
+ * yields, so the Wi-Fi task runs in the meantime.
+ */
+void I2cScheduler::waitForConversions() {
+  if (!pending)
+    return;
+  pending = false;
+  int32_t remaining = readyTime - micros();
+  if (remaining <= 0)
+    return;
+  delay(remaining / 1000);
+  delayMicroseconds(remaining % 1000);
+}
+
+/**
+ * @brief Gets the number of logged transactions.
+ * @return The number of transactions, at most I2C_LOG_SIZE.
+ */
+size_t I2cScheduler::transactions() { return logCount; }
+
+/**
+ * @brief Gets a logged transaction.
+ * @param index The transaction index, 0 being the first of the wake.
+ * @return The transaction.
+ */
+const I2cTransaction &I2cScheduler::transaction(size_t index) {
+  return log[index];
+}
+
+/**
+ * @brief Clears the log and the expected conversions, for a new wake.
+ */
+void I2cScheduler::reset() {
+  logCount = 0;
+  pending = false;
+}
+
+/**
+ * @brief Prints the transaction log.
+ */
+void I2cScheduler::report() {
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  LOG_DEBUG("I2C transactions (us):");
+  for (size_t i = 0; i < logCount; i++) {
+    const I2cTransaction &entry = log[i];
+    LOG_DEBUG("  %lu 0x%02x %s %u B, %lu%s", (unsigned long)entry.start,
+              entry.address, entry.read ? "read" : "write", entry.size,
+              (unsigned long)entry.duration,
+              entry.acknowledged ? "" : " (NACK)");
+  }
+#endif
+}
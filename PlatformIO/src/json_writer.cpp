@@ -0,0 +1,164 @@
+#include "json_writer.h"
+#include <math.h>
+
+/**
+ * @brief Creates a writer on top of a fixed buffer.
+ * @param buffer The destination buffer.
+ * @param capacity The size of the destination buffer, including the
+ * terminating null character.
+ */
+JsonWriter::JsonWriter(char *buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), length(0), overflow(false),
+      needsComma(false) {
+  if (capacity > 0)
+    buffer[0] = '\0';
+}
+
+/**
+ * @brief Appends a character, flagging an overflow when the buffer is full.
+ * @param c The character to append.
+ */
+void JsonWriter::append(char c) {
+  if (length + 1 >= capacity) {
+    overflow = true;
+    return;
+  }
+  buffer[length++] = c;
+  buffer[length] = '\0';
+}
+
+/**
+ * @brief Appends a raw string.
+ * @param text The string to append.
+ */
+void JsonWriter::append(const char *text) {
+  while (*text)
+    append(*text++);
+}
+
+/**
+ * @brief Appends a quoted string, escaping the characters JSON requires.
+ * @param text The string to append.
+ */
+void JsonWriter::appendEscaped(const char *text) {
+  append('"');
+  for (; *text; text++) {
+    char c = *text;
+    if (c == '"' || c == '\\') {
+      append('\\');
+      append(c);
+    } else if (c == '\n') {
+      append("\\n");
+    } else if (c == '\r') {
+      append("\\r");
+    } else if (c == '\t') {
+      append("\\t");
+    } else if ((uint8_t)c < 0x20) {
+      char escaped[7];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      append(escaped);
+    } else {
+      append(c);
+    }
+  }
+  append('"');
+}
+
+/**
+ * @brief Appends a comma when a value was already written at this level.
+ */
+void JsonWriter::appendSeparator() {
+  if (needsComma)
+    append(',');
+}
+
+/**
+ * @brief Appends an object key and its colon.
+ * @param key The key to append.
+ */
+void JsonWriter::appendKey(const char *key) {
+  appendSeparator();
+  appendEscaped(key);
+  append(':');
+  needsComma = true;
+}
+
+void JsonWriter::beginObject() {
+  appendSeparator();
+  append('{');
+  needsComma = false;
+}
+
+void JsonWriter::endObject() {
+  append('}');
+  needsComma = true;
+}
+
+void JsonWriter::beginArray() {
+  appendSeparator();
+  append('[');
+  needsComma = false;
+}
+
+void JsonWriter::endArray() {
+  append(']');
+  needsComma = true;
+}
+
+/**
+ * @brief Adds a string member to the current object.
+ * @param key The member name.
+ * @param value The member value.
+ */
+void JsonWriter::add(const char *key, const char *value) {
+  appendKey(key);
+  appendEscaped(value);
+}
+
+/**
+ * @brief Adds a number member to the current object.
+ * NaN and infinity are written as null, since JSON cannot represent them.
+ * @param key The member name.
+ * @param value The member value.
+ * @param decimals The number of decimals to write.
+ */
+void JsonWriter::add(const char *key, double value, uint8_t decimals) {
+  appendKey(key);
+  if (isnan(value) || isinf(value)) {
+    append("null");
+    return;
+  }
+  char number[JSON_NUMBER_MAX_SIZE + 1];
+  snprintf(number, sizeof(number), "%.*f", decimals, value);
+  append(number);
+}
+
+/**
+ * @brief Adds an unsigned integer member to the current object.
+ * @param key The member name.
+ * @param value The member value.
+ */
+void JsonWriter::add(const char *key, uint32_t value) {
+  appendKey(key);
+  char number[11];
+  snprintf(number, sizeof(number), "%lu", (unsigned long)value);
+  append(number);
+}
+
+/**
+ * @brief Gets the JSON written so far.
+ * @return The null-terminated JSON string.
+ */
+const char *JsonWriter::c_str() const { return buffer; }
+
+/**
+ * @brief Gets the length of the JSON written so far.
+ * @return The length in bytes, without the terminating null character.
+ */
+size_t JsonWriter::size() const { return length; }
+
+/**
+ * @brief Tells whether some output was dropped because the buffer was full.
+ * @return True if the JSON is incomplete.
+ */
+bool JsonWriter::overflowed() const { return overflow; }
@@ -0,0 +1,131 @@
+#include "logger.h"
+#include <esp_system.h>
+#include <stdarg.h>
+
+#define LOG_RING_MAGIC 0x53544C47 // "STLG"
+
+static const char levelTags[] = {'-', 'E', 'W', 'I', 'D'};
+
+char Logger::buffer[LOG_BUFFER_SIZE];
+bool Logger::crashed = false;
+#if LOG_RING_LEVEL > LOG_LEVEL_NONE
+RTC_NOINIT_ATTR LogRing logRing;
+#endif
+
+/**
+ * @brief Starts the serial port when anything is printed, and after a crash
+ * prints the records the crashed boot left in the ring. Call early in
+ * setup(), before anything is logged.
+ */
+void Logger::begin() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  crashed = reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+            reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT ||
+            reason == ESP_RST_BROWNOUT;
+#if LOG_RING_LEVEL > LOG_LEVEL_NONE
+  if (logRing.magic != LOG_RING_MAGIC || logRing.head >= LOG_RING_SIZE ||
+      logRing.count > LOG_RING_SIZE) {
+    memset(&logRing, 0, sizeof(logRing));
+    logRing.magic = LOG_RING_MAGIC;
+  }
+  logRing.boot++;
+#endif
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  Serial.begin(115200);
+  Serial.setDebugOutput(true);
+  if (crashed)
+    dumpRing(Serial);
+#else
+  // Production builds only open the port to show what led to a crash
+  if (crashed && LOG_RING_LEVEL > LOG_LEVEL_NONE) {
+    Serial.begin(115200);
+    dumpRing(Serial);
+  }
+#endif
+}
+
+/**
+ * @brief Waits for a serial monitor in builds that print, so that nothing
+ * logged afterwards is lost. Timer wakes do not wait.
+ */
+void Logger::waitForSerial() {
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  while (!Serial)
+    delay(10);
+#endif
+}
+
+/**
+ * @brief Formats a record and passes it to the outputs its level is enabled
+ * for. Called through the LOG_* macros, which skip disabled levels.
+ * @param level The LOG_LEVEL_* severity.
+ * @param format The printf format, followed by its arguments.
+ */
+void Logger::write(uint8_t level, const char *format, ...) {
+  int prefix = snprintf(buffer, sizeof(buffer), "[%c] ", levelTags[level]);
+  va_list args;
+  va_start(args, format);
+  int length =
+      vsnprintf(buffer + prefix, sizeof(buffer) - prefix - 1, format, args);
+  va_end(args);
+  if (length < 0)
+    return;
+  size_t size = min((size_t)length, sizeof(buffer) - prefix - 2);
+
+  if (level <= LOG_RING_LEVEL)
+    record(level, buffer + prefix, size);
+  if (level <= LOG_LEVEL) {
+    size += prefix;
+    buffer[size++] = '\n';
+    Serial.write((const uint8_t *)buffer, size);
+  }
+}
+
+/**
+ * @brief Appends a message to the crash ring, overwriting the oldest record
+ * when it is full.
+ * @param level The severity.
+ * @param text The formatted message.
+ * @param length Its length, truncated to fit a record.
+ */
+void Logger::record(uint8_t level, const char *text, size_t length) {
+#if LOG_RING_LEVEL > LOG_LEVEL_NONE
+  LogRecord &entry = logRing.records[logRing.head];
+  entry.time = millis();
+  entry.boot = logRing.boot;
+  entry.level = level;
+  entry.length = min(length, sizeof(entry.text));
+  memcpy(entry.text, text, entry.length);
+  logRing.head = (logRing.head + 1) % LOG_RING_SIZE;
+  if (logRing.count < LOG_RING_SIZE)
+    logRing.count++;
+#endif
+}
+
+/**
+ * @brief Whether the last reset was a panic, a watchdog or a brownout.
+ * @return True when the ring may explain a crash.
+ */
+bool Logger::resetByCrash() { return crashed; }
+
+/**
+ * @brief Prints the crash ring, oldest record first. Records of the current
+ * boot are marked with the boot number like the others.
+ * @param output Where to print.
+ */
+void Logger::dumpRing(Print &output) {
+#if LOG_RING_LEVEL > LOG_LEVEL_NONE
+  output.printf("Log ring, %u records, boot %u:\n", logRing.count,
+                logRing.boot);
+  size_t first = (logRing.head + LOG_RING_SIZE - logRing.count) % LOG_RING_SIZE;
+  for (size_t i = 0; i < logRing.count; i++) {
+    const LogRecord &entry = logRing.records[(first + i) % LOG_RING_SIZE];
+    output.printf("  #%u [%6lu][%c] %.*s\n", entry.boot,
+                  (unsigned long)entry.time,
+                  levelTags[min(entry.level, (uint8_t)LOG_LEVEL_DEBUG)],
+                  (int)min(entry.length, (uint8_t)LOG_RING_TEXT_SIZE),
+                  entry.text);
+  }
+#endif
+}
@@ -1,66 +1,75 @@
 #include "configuration.h"
 #include "credentials.h"
-#include "debug.h"
-#include <Preferences.h>
+#include "logger.h"
 #include <WiFi.h>
 
-Preferences preferences;
-
-#include <battery_monitor.h>
+#include <adc_sampler.h>
 #include <captive_portal.h>
+#include <device_config.h>
+#include <i2c_scheduler.h>
 #include <network_handler.h>
+#include <offline_queue.h>
+#include <phase_profiler.h>
+#include <power_manager.h>
+#include <reading_buffer.h>
+#include <report_policy.h>
 #include <sensor_handler.h>
 
 // --- Function Prototypes ---
-void powerOff();
 void startNormalMode();
 
+// Whether this wake took the fast lane, which has a time budget
+bool fastLane = false;
+
 void setup() {
-  SERIAL_BEGIN(115200);
-  SERIAL_WAIT_FOR_SERIAL;
-  SERIAL_SET_DEBUG_OUTPUT(true);
+  PhaseProfiler::begin();
+  Logger::begin();
+  PowerManager::begin();
+
+  // Fast lane for the timer wakes of a provisioned device: no serial wait,
+  // no settling delay and no configuration until an uplink needs it
+  if (DeviceConfig::bootMode() == BOOT_MODE_NORMAL) {
+    fastLane = true;
+    LOG_INFO("ESP32 Woke Up! Normal Mode.");
+    startNormalMode();
+    return;
+  }
 
+  Logger::waitForSerial();
   delay(DELAY_SHORT);
 
-  DEBUGLN("ESP32 Woke Up!");
+  LOG_INFO("ESP32 Woke Up!");
 
-  pinMode(TPL5110_DONE_PIN, OUTPUT);
+  const DeviceConfigData &config = DeviceConfig::get();
 
-  preferences.begin("stacy", false);
-  String storedSSID = preferences.getString("ssid");
-  String storedWifiPWD = preferences.getString("wifi_password");
-  String storedUID = preferences.getString("uid");
-  String storedBearerToken = preferences.getString("bearer_token");
-  String storedPlantName = preferences.getString("plant_name");
-  String storedPlantId = preferences.getString("plant_id");
-  preferences.end();
-
-  DEBUGLN("Stored Wi-Fi SSID: " + storedSSID);
-  DEBUGLN("Stored Wi-Fi Password: " + storedWifiPWD);
-  DEBUGLN("Stored UID: " + storedUID);
-  DEBUGLN("Stored Bearer Token: " + storedBearerToken);
-  DEBUGLN("Stored Plant Name: " + storedPlantName);
-  DEBUGLN("Stored Plant ID: " + storedPlantId);
+  LOG_DEBUG("Stored Wi-Fi SSID: %s", config.ssid);
+  LOG_DEBUG("Stored Wi-Fi Password: %s", config.wifiPassword);
+  LOG_DEBUG("Stored UID: %s", config.uid);
+  LOG_DEBUG("Stored Bearer Token: %s", config.bearerToken);
+  LOG_DEBUG("Stored Plant Name: %s", config.plantName);
+  LOG_DEBUG("Stored Plant ID: %s", config.plantId);
 
   // if uid is stored but no plant_id, create one
-  if (storedUID.length() > 1 && storedPlantId.length() < 1) {
-    DEBUGLN("No Plant ID found but UID and Plant Name are present. Attempting "
-            "to create Plant ID.");
-    NetworkHandler::createPlant(storedPlantName);
+  if (strlen(config.uid) > 1 && strlen(config.plantId) < 1) {
+    LOG_INFO("No Plant ID found but UID and Plant Name are present. "
+             "Attempting to create Plant ID.");
+    NetworkHandler::createPlant(config.plantName);
   }
 
-  if (storedSSID.length() > 1 && storedWifiPWD.length() > 1 &&
-      storedUID.length() > 1 && storedBearerToken.length() > 1) {
-    DEBUGLN("Stored Wi-Fi credentials found. Starting Normal Mode.");
+  if (strlen(config.ssid) > 1 && strlen(config.wifiPassword) > 1 &&
+      strlen(config.uid) > 1 && strlen(config.bearerToken) > 1) {
+    LOG_INFO("Stored Wi-Fi credentials found. Starting Normal Mode.");
     startNormalMode();
-  } else if (storedSSID.length() > 1 && storedWifiPWD.length() > 1 &&
-             storedUID.length() < 1) {
-    DEBUGLN("No UID found but Wi-Fi credentials are present. Starting "
-            "mDNS.");
+  } else if (strlen(config.ssid) > 1 && strlen(config.wifiPassword) > 1 &&
+             strlen(config.uid) < 1) {
+    LOG_INFO("No UID found but Wi-Fi credentials are present. Starting "
+             "mDNS.");
+    DeviceConfig::commit();
     CaptivePortal captivePortal;
     captivePortal.startMDNS();
   } else {
-    DEBUGLN("No stored Wi-Fi credentials found. Starting Captive Portal.");
+    LOG_INFO("No stored Wi-Fi credentials found. Starting Captive Portal.");
+    DeviceConfig::commit();
     CaptivePortal captivePortal;
     captivePortal.begin();
   }
@@ -72,37 +81,100 @@ void loop() {}
 // --- Helper Functions ---
 
 void startNormalMode() {
-  DEBUGLN("Normal Mode Sequence Started");
-  NetworkHandler::connectToWiFi();
+  LOG_DEBUG("Normal Mode Sequence Started");
+
+  ReportPolicy::begin();
+  if (!ReportPolicy::isSampleDue()) {
+    LOG_INFO("Low battery. Skipping this wake.");
+    ReportPolicy::skipWake();
+    PowerManager::sleep();
+    return;
+  }
+
+  // Moisture and battery conversions run in the background from here on
+  AdcSampler::beginContinuous();
+
+  ReadingBuffer::begin(ReportPolicy::now());
+  // Start associating first when the uplink does not depend on the reading,
+  // the Wi-Fi task then runs while sensors are sampled
+  bool connecting = ReadingBuffer::shouldFlush() ||
+                    (ReportPolicy::isHeartbeatDue() &&
+                     ReadingBuffer::shouldFlushAfterPush());
+  if (connecting) {
+    NetworkHandler::beginConnection();
+  }
 
   SensorData data;
-  if (!SensorHandler::initHDC()) {
-    DEBUGLN("Failed to initialize HDC3022 sensor.");
-    data.temperature = 0.0;
-    data.humidity = 0.0;
-    data.moisture = 0.0;
-    data.hic = 0.0;
-    // return;
+  // The HDC3022 acquisition mode depends on the battery. The last sample's
+  // level selects it, so that the conversion is triggered before the
+  // battery is read, which then overlaps it
+  data.batteryPercentage = ReportPolicy::batteryEstimate();
+  PhaseProfiler::stop(PHASE_STARTUP);
+  unsigned long startup = PhaseProfiler::total(PHASE_STARTUP);
+  if (fastLane && startup > BOOT_SENSOR_BUDGET_US) {
+    LOG_WARN("Boot to first sensor trigger took %lu us, over the %d us "
+             "budget.",
+             startup, BOOT_SENSOR_BUDGET_US);
   } else {
-    SensorHandler::readSensorData(data);
+    LOG_DEBUG("Boot to first sensor trigger: %lu us", startup);
+  }
+  if (!SensorHandler::readSensorData(data)) {
+    LOG_WARN("Failed to read some sensors. Their values are left at 0.");
   }
-  BatteryMonitor::getBatteryStatus(data);
-  // data.batteryPercentage = 1.0;
-  // data.batteryVoltage = 1.0;
 
-  NetworkHandler::sendDataToServer(data);
+  bool report = ReportPolicy::shouldReport(data);
+  if (report) {
+    ReadingBuffer::push(data);
+  } else {
+    LOG_DEBUG("Reading within deadbands. Not reported.");
+  }
+  ReportPolicy::sampled(data, report);
 
-  // Signal the TPL5110 to turn off power
-  powerOff();
-}
+  // A heartbeat or a full buffer was anticipated, so connecting implies an
+  // uplink; otherwise the radio only starts now, if at all
+  bool uplink = ReadingBuffer::shouldFlush();
+  if (uplink && !connecting) {
+    NetworkHandler::beginConnection();
+  }
+  if (uplink) {
+    bool connected = NetworkHandler::finishConnection();
+    UploadResult result =
+        connected ? NetworkHandler::sendBufferedData() : UPLOAD_FAILED;
+    if (result != UPLOAD_FAILED) {
+      // A rejected batch would be rejected again, so it is not queued
+      if (result == UPLOAD_REJECTED) {
+        LOG_ERROR("Server rejected the buffered readings. Dropping them.");
+      }
+      ReadingBuffer::clear();
+      NetworkHandler::sendQueuedData();
+    } else {
+      // Kept in flash until an uplink succeeds, and the radio stays off
+      // until the buffer fills again
+      PackedReading readings[READING_BUFFER_CAPACITY];
+      uint32_t epoch;
+      size_t count = ReadingBuffer::copy(readings, epoch);
+      if (OfflineQueue::append(readings, count, epoch)) {
+        ReadingBuffer::clear();
+        LOG_WARN("Batch upload failed. Readings moved to the offline queue.");
+      } else {
+        // A failed append queues none of them, so they are not sent twice
+        LOG_WARN("Batch upload failed. Keeping readings for the next wake.");
+      }
+    }
+    NetworkHandler::closeConnection();
+    // Sent with the next batch
+    PhaseProfiler::save();
+  } else {
+    LOG_DEBUG("No uplink due. Skipping uplink this wake.");
+  }
+
+  PhaseProfiler::report();
+  LOG_DEBUG("TLS handshakes: %u (%lu ms)",
+            NetworkHandler::getHandshakeCount(),
+            NetworkHandler::getHandshakeTime());
+  I2cScheduler::report();
+  LOG_HEAP("end of wake");
 
-/**
- * @brief Turn off power by controlling the TPL5110 DONE pin.
- * This function sets the TPL5110 DONE pin to LOW and then HIGH to signal
- * the TPL5110 to turn off power.
- */
-void powerOff() {
-  digitalWrite(TPL5110_DONE_PIN, LOW);
-  digitalWrite(TPL5110_DONE_PIN, HIGH);
-  delay(100);
+  // Power off or deep sleep until the next wake
+  PowerManager::sleep();
 }
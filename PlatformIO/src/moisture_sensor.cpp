@@ -0,0 +1,38 @@
+#include "moisture_sensor.h"
+#include "adc_sampler.h"
+
+#if SENSOR_MOISTURE
+
+/**
+ * @brief Nothing to set up, the probe is read through AdcSampler.
+ * @return Always true.
+ */
+bool MoistureSensor::begin() { return true; }
+
+/**
+ * @brief Reads the moisture from the capacitive probe. Done here rather than
+ * in collect(), so the ADC work overlaps the I2C conversions.
+ * @param sensorData Reference to the SensorData struct to populate.
+ * @return Always true.
+ */
+bool MoistureSensor::trigger(SensorData &sensorData) {
+  static const AdcSamplerConfig sampling = {
+      MOISTURE_SAMPLES, MOISTURE_FILTER, MOISTURE_TRIM, MOISTURE_CALIBRATED};
+  float sensorValue = AdcSampler::read(CAPACITANCE_PIN, sampling);
+  sensorData.moisture =
+      MOISTURE_CALIBRATED
+          ? AdcSampler::mapClamped(sensorValue, AIR_VALUE_MV, WATER_VALUE_MV,
+                                   0.0, 100.0)
+          : AdcSampler::mapClamped(sensorValue, AIR_VALUE, WATER_VALUE, 0.0,
+                                   100.0);
+  return true;
+}
+
+/**
+ * @brief Nothing left to read, see trigger().
+ * @param sensorData Reference to the SensorData struct to populate.
+ * @return Always true.
+ */
+bool MoistureSensor::collect(SensorData &sensorData) { return true; }
+
+#endif
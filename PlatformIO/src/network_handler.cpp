@@ -1,6 +1,13 @@
 #include "network_handler.h"
 #include "credentials.h"
-#include "debug.h"
+#include "device_config.h"
+#include "json_writer.h"
+#include "logger.h"
+#include "offline_queue.h"
+#include "phase_profiler.h"
+#include "reading_buffer.h"
+#include "reading_record.h"
+#include "telemetry_encoder.h"
 
 #include <ArduinoJson.h>
 #include <HTTPClient.h>
@@ -11,116 +18,596 @@
 
 Preferences networkPreferences;
 
+// JSON buffer sizes. A reading is about 130 bytes, but its buffer holds the
+// longest one: the member names of writeReading(), every number as long as
+// JsonWriter writes them, and a comma
+#define JSON_READING_SIZE 256
+#define JSON_READING_MAX_SIZE                                                  \
+  (sizeof("{\"temperature\":,\"humidity\":,\"moisture\":,\"hic\":,"            \
+          "\"batteryPercentage\":,\"batteryVoltage\":,\"age\":},") -            \
+   1 + 7 * JSON_NUMBER_MAX_SIZE)
+#define JSON_CREDENTIALS_SIZE 256
+#define AUTHORIZATION_SIZE 512
+
+// The payload buffers hold the worst case. A batch that still fails to
+// encode is not one the server refused, so it is kept as UPLOAD_FAILED
+static_assert(JSON_READING_SIZE >= JSON_READING_MAX_SIZE,
+              "JSON buffer too small for a reading");
+static_assert(JSON_READING_SIZE * READING_BUFFER_CAPACITY >=
+                  2 + READING_BUFFER_CAPACITY * JSON_READING_MAX_SIZE,
+              "JSON batch buffer too small for a full reading buffer");
+static_assert(TELEMETRY_MAX_SIZE >=
+                  TELEMETRY_SERIES_HEADER_SIZE + 1 +
+                      READING_BUFFER_CAPACITY * SERIES_MAX_READING_SIZE +
+                      TELEMETRY_PROFILE_SIZE,
+              "telemetry buffer too small for a full series");
+static_assert(TELEMETRY_MAX_SIZE >=
+                  TELEMETRY_HEADER_SIZE +
+                      READING_BUFFER_CAPACITY * TELEMETRY_READING_SIZE +
+                      TELEMETRY_PROFILE_SIZE,
+              "telemetry buffer too small for a full buffer of records");
+static_assert(READING_BUFFER_CAPACITY <= UINT8_MAX,
+              "telemetry counts readings in a byte");
+
+// Shared keep-alive connection, reused by every request within a wake
+WiFiClientSecure secureClient;
+HTTPClient httpClient;
+
+unsigned long NetworkHandler::lastConnectTime = 0;
+uint8_t NetworkHandler::handshakeCount = 0;
+unsigned long NetworkHandler::handshakeTime = 0;
+unsigned long NetworkHandler::connectStartTime = 0;
+bool NetworkHandler::connectHasCache = false;
+WiFiCache NetworkHandler::connectCache;
+WiFiCache NetworkHandler::pendingCache;
+bool NetworkHandler::cacheDirty = false;
+String NetworkHandler::connectSsid;
+String NetworkHandler::connectPassword;
+EventGroupHandle_t NetworkHandler::wifiEvents = nullptr;
+
+/**
+ * @brief Sets the event group bits from the Arduino event task.
+ * @param event The Wi-Fi event.
+ */
+void NetworkHandler::onWiFiEvent(WiFiEvent_t event) {
+  if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+    xEventGroupSetBits(wifiEvents, WIFI_GOT_IP_BIT);
+}
+
 /**
  * @brief Connects the ESP32 to the configured Wi-Fi network.
- * Has a timeout to avoid getting stuck.
+ * Tries a targeted connect with the cached BSSID, channel and static IP
+ * first, then falls back to a full scan with DHCP. Has a timeout to avoid
+ * getting stuck.
  */
 void NetworkHandler::connectToWiFi() {
-  networkPreferences.begin("stacy", true);
-  String ssid = networkPreferences.getString("ssid");
-  String password = networkPreferences.getString("wifi_password");
-  networkPreferences.end();
+  beginConnection();
+  finishConnection();
+}
+
+/**
+ * @brief Starts the Wi-Fi association without waiting for it.
+ * Uses the cached BSSID, channel and static IP when available. Call
+ * finishConnection() to wait for the result.
+ */
+void NetworkHandler::beginConnection() {
+  PhaseProfiler::start(PHASE_WIFI);
+  const DeviceConfigData &config = DeviceConfig::get();
+  connectSsid = config.ssid;
+  connectPassword = config.wifiPassword;
+
+  LOG_INFO("Connecting to WiFi: %s", connectSsid.c_str());
+
+  connectStartTime = millis();
+  connectHasCache = loadWiFiCache(connectCache);
+
+  if (WIFI_WAIT_EVENTS && !wifiEvents) {
+    wifiEvents = xEventGroupCreate();
+    if (wifiEvents)
+      WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  }
+  if (wifiEvents)
+    xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT);
+
+  if (connectHasCache) {
+    LOG_DEBUG("Using cached BSSID, channel and IP address.");
+    WiFi.config(IPAddress(connectCache.localIP),
+                IPAddress(connectCache.gateway),
+                IPAddress(connectCache.subnet), IPAddress(connectCache.dns));
+    WiFi.begin(connectSsid, connectPassword, connectCache.channel,
+               connectCache.bssid);
+  } else {
+    WiFi.begin(connectSsid, connectPassword);
+  }
+}
+
+/**
+ * @brief Waits for the association started by beginConnection().
+ * Falls back to a full scan if the targeted connect fails, and updates the
+ * Wi-Fi cache once connected.
+ * @return True if connected, false if the timeout expired.
+ */
+bool NetworkHandler::finishConnection() {
+  if (connectHasCache &&
+      !waitForConnection(connectStartTime, WIFI_FAST_CONNECT_TIMEOUT)) {
+    LOG_WARN("Fast reconnect failed. Falling back to a full scan.");
+    connectCache.misses++;
+    if (connectCache.misses >= WIFI_CACHE_MAX_MISSES) {
+      LOG_WARN("Too many misses. Invalidating Wi-Fi cache.");
+      clearWiFiCache();
+      connectHasCache = false;
+    } else {
+      saveWiFiCache(connectCache);
+    }
+    WiFi.disconnect();
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    if (wifiEvents)
+      xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT);
+    WiFi.begin(connectSsid, connectPassword);
+  }
 
-  DEBUG("Connecting to WiFi: ");
-  DEBUGLN(ssid);
-  WiFi.begin(ssid, password);
+  bool connected = waitForConnection(millis(), WIFI_CONNECT_TIMEOUT);
+  PhaseProfiler::stop(PHASE_WIFI);
+  if (!connected) {
+    LOG_ERROR("WiFi Connection Timeout!");
+    return false;
+  }
+
+  lastConnectTime = millis() - connectStartTime;
+
+  LOG_INFO("WiFi Connected!");
+  LOG_DEBUG("IP Address: %s", WiFi.localIP().toString().c_str());
+  LOG_DEBUG("Time to associate (ms): %lu", lastConnectTime);
+
+  // Only rewrite the cache when the association changed, to spare flash
+  WiFiCache current;
+  memset(&current, 0, sizeof(WiFiCache));
+  memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+  current.channel = WiFi.channel();
+  current.localIP = WiFi.localIP();
+  current.gateway = WiFi.gatewayIP();
+  current.subnet = WiFi.subnetMask();
+  current.dns = WiFi.dnsIP(0);
+
+  if (!connectHasCache ||
+      memcmp(&current, &connectCache, sizeof(WiFiCache)) != 0) {
+    saveWiFiCache(current);
+  }
+  return true;
+}
 
-  unsigned long startTime = millis();
-  while (WiFi.status() != WL_CONNECTED) {
-    // Timeout after 5 seconds
-    if (millis() - startTime > 5000) {
-      DEBUGLN("\nWiFi Connection Timeout!");
-      return;
+/**
+ * @brief Waits for the Wi-Fi association to complete.
+ * Blocks on the got-IP event with the CPU clocked down, so it idles while
+ * the Wi-Fi task works. Without the event group, polls WiFi.status()
+ * every millisecond instead.
+ * @param startTime The time the wait is measured from, in milliseconds.
+ * @param timeout The maximum time to wait in milliseconds.
+ * @return True if connected, false if the timeout expired.
+ */
+bool NetworkHandler::waitForConnection(unsigned long startTime,
+                                       unsigned long timeout) {
+  if (!wifiEvents) {
+    while (WiFi.status() != WL_CONNECTED) {
+      if (millis() - startTime > timeout) {
+        return false;
+      }
+      delay(1);
     }
+    return true;
   }
 
-  if (WiFi.status() != WL_CONNECTED) {
-    DEBUGLN("Failed to connect to WiFi. Going back to sleep.");
+  unsigned long elapsed = millis() - startTime;
+  TickType_t ticks = elapsed < timeout ? pdMS_TO_TICKS(timeout - elapsed) : 0;
+  uint32_t clock = getCpuFrequencyMhz();
+  if (WIFI_WAIT_CPU_MHZ && WIFI_WAIT_CPU_MHZ < clock) {
+    setCpuFrequencyMhz(WIFI_WAIT_CPU_MHZ);
+  }
+  EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_GOT_IP_BIT,
+                                         pdFALSE, pdFALSE, ticks);
+  if (getCpuFrequencyMhz() != clock) {
+    setCpuFrequencyMhz(clock);
+  }
+  return bits & WIFI_GOT_IP_BIT;
+}
+
+/**
+ * @brief Gets the time the last successful connectToWiFi() call took.
+ * @return The time to associate in milliseconds, 0 if never connected.
+ */
+unsigned long NetworkHandler::getLastConnectTime() { return lastConnectTime; }
+
+/**
+ * @brief Loads the cached Wi-Fi association from preferences.
+ * @param cache Reference to the WiFiCache struct to populate.
+ * @return True if a cache entry was found, false otherwise.
+ */
+bool NetworkHandler::loadWiFiCache(WiFiCache &cache) {
+  memset(&cache, 0, sizeof(WiFiCache));
+  PhaseTimer timer(PHASE_NVS);
+  networkPreferences.begin("stacy", true);
+  size_t length =
+      networkPreferences.getBytes("wifi_cache", &cache, sizeof(WiFiCache));
+  networkPreferences.end();
+
+  return length == sizeof(WiFiCache) && cache.channel > 0 &&
+         cache.localIP != 0;
+}
+
+/**
+ * @brief Keeps the Wi-Fi association for commitWiFiCache() to store.
+ * @param cache The WiFiCache struct to store.
+ */
+void NetworkHandler::saveWiFiCache(const WiFiCache &cache) {
+  pendingCache = cache;
+  cacheDirty = true;
+}
+
+/**
+ * @brief Drops the cached Wi-Fi association, from preferences once
+ * commitWiFiCache() runs.
+ */
+void NetworkHandler::clearWiFiCache() {
+  memset(&pendingCache, 0, sizeof(WiFiCache));
+  cacheDirty = true;
+}
+
+/**
+ * @brief Writes the last Wi-Fi cache change of this wake to preferences, if
+ * any. Call before power is cut.
+ */
+void NetworkHandler::commitWiFiCache() {
+  if (!cacheDirty)
     return;
+  cacheDirty = false;
+  PhaseTimer timer(PHASE_NVS);
+  networkPreferences.begin("stacy", false);
+  if (pendingCache.channel > 0) {
+    networkPreferences.putBytes("wifi_cache", &pendingCache,
+                                sizeof(WiFiCache));
+  } else {
+    networkPreferences.remove("wifi_cache");
+  }
+  networkPreferences.end();
+}
+
+/**
+ * @brief Starts a request on the shared keep-alive connection.
+ * The TLS handshake only happens when the connection is not already open.
+ * The session is not resumed across wakes: WiFiClientSecure sets up
+ * mbedTLS and handshakes in one call, leaving no place to restore a ticket.
+ * @param path The endpoint path, e.g. "/weather".
+ * @return True if the request could be started, false otherwise.
+ */
+bool NetworkHandler::beginRequest(const char *path) {
+  if (!secureClient.connected()) {
+    String host = String(SERVER_URL);
+    uint16_t port = host.startsWith("http://") ? 80 : 443;
+    int schemeEnd = host.indexOf("://");
+    if (schemeEnd >= 0)
+      host = host.substring(schemeEnd + 3);
+    int pathStart = host.indexOf('/');
+    if (pathStart >= 0)
+      host = host.substring(0, pathStart);
+    int portStart = host.indexOf(':');
+    if (portStart >= 0) {
+      port = host.substring(portStart + 1).toInt();
+      host = host.substring(0, portStart);
+    }
+
+    secureClient.setInsecure();
+    unsigned long startTime = millis();
+    PhaseTimer timer(PHASE_TLS);
+    if (!secureClient.connect(host.c_str(), port)) {
+      LOG_ERROR("TLS connection to %s failed.", host.c_str());
+      return false;
+    }
+    handshakeCount++;
+    handshakeTime += millis() - startTime;
+    LOG_DEBUG("TLS handshake took (ms): %lu", millis() - startTime);
   }
 
-  DEBUGLN("\nWiFi Connected!");
-  DEBUG("IP Address: ");
-  DEBUGLN(WiFi.localIP());
+  httpClient.setReuse(true);
+  return httpClient.begin(secureClient, String(SERVER_URL) + path);
+}
+
+/**
+ * @brief Sends the started request as a POST and waits for the response.
+ * @param payload The request body.
+ * @param size The size of the body.
+ * @return The HTTP status code, or a negative HTTPClient error.
+ */
+int NetworkHandler::post(const uint8_t *payload, size_t size) {
+  PhaseTimer timer(PHASE_POST);
+  return httpClient.POST((uint8_t *)payload, size);
+}
+
+/**
+ * @brief Adds the headers every authenticated device request carries.
+ * The Authorization value is formatted on the stack instead of by String
+ * concatenation.
+ * @param contentType The request Content-Type.
+ * @param bearerToken The bearer token.
+ * @param uid The user ID.
+ */
+void NetworkHandler::addDeviceHeaders(const char *contentType,
+                                      const char *bearerToken,
+                                      const char *uid) {
+  char authorization[AUTHORIZATION_SIZE];
+  snprintf(authorization, sizeof(authorization), "Bearer %s", bearerToken);
+
+  httpClient.addHeader("Content-Type", contentType);
+  httpClient.addHeader("Authorization", authorization);
+  httpClient.addHeader("Device-ID", getMacAddress());
+  httpClient.addHeader("UID", uid);
+}
+
+/**
+ * @brief Writes one reading as a JSON object.
+ * @param json The writer to write to.
+ * @param sensorData The reading to write.
+ * @param age The age of the reading in seconds, omitted when 0.
+ */
+void NetworkHandler::writeReading(JsonWriter &json,
+                                  const SensorData &sensorData, uint32_t age) {
+  json.beginObject();
+  json.add("temperature", sensorData.temperature);
+  json.add("humidity", sensorData.humidity);
+  json.add("moisture", sensorData.moisture);
+  json.add("hic", sensorData.hic);
+  json.add("batteryPercentage", sensorData.batteryPercentage);
+  json.add("batteryVoltage", sensorData.batteryVoltage);
+  if (age > 0)
+    json.add("age", age);
+  json.endObject();
+}
+
+/**
+ * @brief Closes the shared connection, e.g. before powering off.
+ */
+void NetworkHandler::closeConnection() {
+  httpClient.end();
+  secureClient.stop();
 }
 
+/**
+ * @brief Gets the number of TLS handshakes done during this wake.
+ * @return The handshake count.
+ */
+uint8_t NetworkHandler::getHandshakeCount() { return handshakeCount; }
+
+/**
+ * @brief Gets the total time spent in TLS handshakes during this wake.
+ * @return The handshake time in milliseconds.
+ */
+unsigned long NetworkHandler::getHandshakeTime() { return handshakeTime; }
+
 /**
  * @brief Sends the provided temperature and humidity data to the server via
  * HTTP POST.
  * @param temperature The temperature value.
  * @param humidity The humidity value.
+ * @param refreshed Whether the token was already refreshed for this reading,
+ * in which case a 403 is not retried again.
  */
-void NetworkHandler::sendDataToServer(SensorData sensorData) {
+void NetworkHandler::sendDataToServer(SensorData sensorData, bool refreshed) {
   if (WiFi.status() != WL_CONNECTED) {
-    DEBUGLN("WiFi not connected. Attempting to connect...");
+    LOG_WARN("WiFi not connected. Attempting to connect...");
     NetworkHandler::connectToWiFi();
     delay(DELAY_STANDARD);
   }
 
-  HTTPClient http;
-  WiFiClientSecure client;
-  client.setInsecure();
+  HTTPClient &http = httpClient;
 
   // Begin HTTP connection
-  if (http.begin(client, String(SERVER_URL) + "/weather")) {
-    DEBUG("Connecting to server: ");
-    DEBUGLN(String(SERVER_URL) + "/weather");
+  if (beginRequest("/weather")) {
+    LOG_DEBUG("Connecting to server: %s/weather", SERVER_URL);
 
-    networkPreferences.begin("stacy", true);
-    String bearerToken = networkPreferences.getString("bearer_token", "");
-    String uid = networkPreferences.getString("uid", "");
-    networkPreferences.end();
+    const DeviceConfigData &config = DeviceConfig::get();
 
-    DEBUG("Bearer Token: ");
-    DEBUGLN(bearerToken);
-    DEBUG("UID: ");
-    DEBUGLN(uid);
+    LOG_DEBUG("Bearer Token: %s", config.bearerToken);
+    LOG_DEBUG("UID: %s", config.uid);
 
     // Set headers
-    http.addHeader("Content-Type", "application/json");
-    http.addHeader("Authorization", "Bearer " + bearerToken);
-    http.addHeader("Device-id", getMacAddress());
-    http.addHeader("UID", uid);
-
-    String jsonPayload =
-        "{\"temperature\":" + String(sensorData.temperature) +
-        ",\"humidity\":" + String(sensorData.humidity) +
-        ",\"moisture\":" + String(sensorData.moisture) +
-        ",\"hic\":" + String(sensorData.hic) +
-        ",\"batteryPercentage\":" + String(sensorData.batteryPercentage) +
-        ",\"batteryVoltage\":" + String(sensorData.batteryVoltage) + "}";
-
-    DEBUG("Sending JSON payload: ");
-    DEBUGLN(jsonPayload);
+    addDeviceHeaders("application/json", config.bearerToken, config.uid);
+
+    char payload[JSON_READING_SIZE];
+    JsonWriter json(payload, sizeof(payload));
+    writeReading(json, sensorData);
+
+    LOG_DEBUG("Sending JSON payload: %s", json.c_str());
+    LOG_HEAP("before POST");
 
     // Send POST request
-    int httpResponseCode = http.POST(jsonPayload);
+    int httpResponseCode = post((const uint8_t *)payload, json.size());
 
     // Check response
     if (httpResponseCode > 0) {
-      DEBUGLN(String("HTTP POST response code: ") + String(httpResponseCode));
-      if (httpResponseCode == HTTP_CODE_FORBIDDEN) {
-        DEBUGLN("Expired or invalid token. Refreshing token...");
+      LOG_DEBUG("HTTP POST response code: %d", httpResponseCode);
+      if (httpResponseCode == HTTP_CODE_FORBIDDEN && refreshed) {
+        LOG_ERROR("Token refused again after a refresh. Cannot send data.");
+      } else if (httpResponseCode == HTTP_CODE_FORBIDDEN) {
+        LOG_WARN("Expired or invalid token. Refreshing token...");
+        http.end();
         bool worked = NetworkHandler::refreshToken();
 
         if (!worked) {
-          DEBUGLN("Failed to refresh token. Cannot send data.");
+          LOG_ERROR("Failed to refresh token. Cannot send data.");
           return;
         }
-        DEBUGLN("Re-attempting to send data after token refresh.");
-        NetworkHandler::sendDataToServer(sensorData);
+        LOG_INFO("Re-attempting to send data after token refresh.");
+        NetworkHandler::sendDataToServer(sensorData, true);
+        return;
       }
     } else {
-      DEBUGLN(String("HTTP POST failed, error: ") +
-              http.errorToString(httpResponseCode));
+      LOG_ERROR("HTTP POST failed, error: %s",
+                http.errorToString(httpResponseCode).c_str());
     }
     // End HTTP connection
     http.end();
   } else {
-    DEBUGLN("HTTP connection failed. Unable to begin.");
+    LOG_ERROR("HTTP connection failed. Unable to begin.");
   }
 }
 
+/**
+ * @brief Sends every buffered reading to the server in a single HTTP POST,
+ * with the profile of the last uplink wake.
+ * @return Whether the server accepted or rejected the batch, or the upload
+ * should be retried later.
+ */
+UploadResult NetworkHandler::sendBufferedData() {
+  PackedReading readings[READING_BUFFER_CAPACITY];
+  uint32_t epoch;
+  size_t count = ReadingBuffer::copy(readings, epoch);
+  WakeProfile profile;
+  bool profiled = PhaseProfiler::lastUplink(profile);
+  return sendReadings(readings, count, epoch,
+                      profiled ? &profile : nullptr);
+}
+
+/**
+ * @brief Replays the offline queue, oldest first, in batches of up to
+ * READING_BUFFER_CAPACITY readings and at most OFFLINE_QUEUE_DRAIN_BATCHES
+ * batches per wake. A batch leaves the queue once the server accepts it, or
+ * rejects it for good, so that one bad batch cannot hold back the rest.
+ * @return True if no batch needs a retry.
+ */
+bool NetworkHandler::sendQueuedData() {
+  for (int batch = 0; batch < OFFLINE_QUEUE_DRAIN_BATCHES; batch++) {
+    if (OfflineQueue::count() == 0)
+      return true;
+    PackedReading readings[READING_BUFFER_CAPACITY];
+    uint32_t epoch;
+    size_t count =
+        OfflineQueue::read(readings, READING_BUFFER_CAPACITY, epoch);
+    LOG_INFO("Replaying %zu queued readings.", count);
+    UploadResult result =
+        count > 0 ? sendReadings(readings, count, epoch) : UPLOAD_ACCEPTED;
+    if (result == UPLOAD_FAILED)
+      return false;
+    if (result == UPLOAD_REJECTED) {
+      LOG_ERROR("Server rejected %zu queued readings. Dropping them.",
+                count);
+    }
+    OfflineQueue::commit();
+  }
+  return true;
+}
+
+/**
+ * @brief Sends readings to the server in a single HTTP POST. The payload is
+ * either the binary telemetry format or a JSON array, oldest reading first,
+ * where each reading carries its age in seconds.
+ * @param readings The readings, oldest first.
+ * @param count The number of readings, at most READING_BUFFER_CAPACITY.
+ * @param epoch The wake clock the reading deltas count from.
+ * @param profile A wake profile to attach to a binary payload, or nullptr.
+ * @param refreshed Whether the token was already refreshed for this batch,
+ * in which case a 403 is not retried again.
+ * @return UPLOAD_ACCEPTED if the server stored the batch, UPLOAD_REJECTED
+ * if it refused the batch itself, so that sending it again cannot succeed,
+ * or UPLOAD_FAILED if the upload should be retried later.
+ */
+UploadResult NetworkHandler::sendReadings(const PackedReading *readings,
+                                          size_t count, uint32_t epoch,
+                                          const WakeProfile *profile,
+                                          bool refreshed) {
+  if (WiFi.status() != WL_CONNECTED) {
+    LOG_WARN("WiFi not connected. Attempting to connect...");
+    NetworkHandler::connectToWiFi();
+    delay(DELAY_STANDARD);
+  }
+
+  HTTPClient &http = httpClient;
+
+  if (!beginRequest("/weather")) {
+    LOG_ERROR("HTTP connection failed. Unable to begin.");
+    return UPLOAD_FAILED;
+  }
+
+  const DeviceConfigData &config = DeviceConfig::get();
+  addDeviceHeaders(TELEMETRY_BINARY ? TELEMETRY_CONTENT_TYPE
+                                    : "application/json",
+                   config.bearerToken, config.uid);
+
+  int httpResponseCode;
+  if (TELEMETRY_BINARY) {
+    uint8_t payload[TELEMETRY_MAX_SIZE];
+    size_t length = TelemetryEncoder::encodeReadings(
+        readings, count, epoch, profile, payload, sizeof(payload));
+
+    if (length == 0) {
+      LOG_ERROR("Failed to encode the telemetry payload.");
+      http.end();
+      return UPLOAD_FAILED;
+    }
+
+    LOG_DEBUG("Sending binary batch of %zu readings, bytes: %zu", count,
+              length);
+
+    httpResponseCode = post(payload, length);
+  } else {
+    // Static, as it is too large for the loop task stack
+    static char payload[JSON_READING_SIZE * READING_BUFFER_CAPACITY];
+    JsonWriter json(payload, sizeof(payload));
+    json.beginArray();
+    for (size_t i = 0; i < count; i++) {
+      SensorData sensorData;
+      if (!ReadingRecord::unpack(readings[i], sensorData))
+        continue;
+      writeReading(json, sensorData,
+                   ReadingBuffer::age(epoch + readings[i].delta));
+    }
+    json.endArray();
+
+    if (json.overflowed()) {
+      LOG_ERROR("JSON payload does not fit its buffer.");
+      http.end();
+      return UPLOAD_FAILED;
+    }
+
+    LOG_DEBUG("Sending batch of %zu readings: %s", count, json.c_str());
+    LOG_HEAP("before POST");
+
+    httpResponseCode = post((const uint8_t *)payload, json.size());
+  }
+  http.end();
+
+  if (httpResponseCode == HTTP_CODE_FORBIDDEN && refreshed) {
+    LOG_ERROR("Token refused again after a refresh. Cannot send data.");
+    return UPLOAD_FAILED;
+  }
+  if (httpResponseCode == HTTP_CODE_FORBIDDEN) {
+    LOG_WARN("Expired or invalid token. Refreshing token...");
+    if (!NetworkHandler::refreshToken()) {
+      LOG_ERROR("Failed to refresh token. Cannot send data.");
+      return UPLOAD_FAILED;
+    }
+    LOG_INFO("Re-attempting to send batch after token refresh.");
+    return NetworkHandler::sendReadings(readings, count, epoch, profile,
+                                        true);
+  }
+
+  if (httpResponseCode == HTTP_CODE_CREATED) {
+    LOG_DEBUG("HTTP POST response code: %d", httpResponseCode);
+    return UPLOAD_ACCEPTED;
+  }
+
+  // The batch itself is at fault, it would be refused again
+  if (httpResponseCode == HTTP_CODE_BAD_REQUEST ||
+      httpResponseCode == HTTP_CODE_PAYLOAD_TOO_LARGE ||
+      httpResponseCode == HTTP_CODE_UNSUPPORTED_MEDIA_TYPE) {
+    LOG_ERROR("Server rejected batch of %zu readings, code: %d", count,
+              httpResponseCode);
+    return UPLOAD_REJECTED;
+  }
+
+  LOG_ERROR("HTTP POST failed, code: %d, error: %s", httpResponseCode,
+            http.errorToString(httpResponseCode).c_str());
+  return UPLOAD_FAILED;
+}
+
 /**
  * @brief Logs in the user with the provided email and password.
  * @param email The user's email.
@@ -135,36 +622,36 @@ bool NetworkHandler::loginUser(const String &email, const String &password) {
   }
 
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    WiFiClientSecure client;
-    client.setInsecure();
+    HTTPClient &http = httpClient;
 
-    DEBUG("Logging in user: ");
-    DEBUGLN(email);
+    LOG_INFO("Logging in user: %s", email.c_str());
 
     // Begin HTTP connection
-    if (http.begin(client, String(SERVER_URL) + "/login")) {
+    if (beginRequest("/login")) {
       http.addHeader("Content-Type", "application/json");
 
-      String jsonPayload =
-          "{\"email\":\"" + email + "\",\"password\":\"" + password + "\"}";
+      char payload[JSON_CREDENTIALS_SIZE];
+      JsonWriter json(payload, sizeof(payload));
+      json.beginObject();
+      json.add("email", email.c_str());
+      json.add("password", password.c_str());
+      json.endObject();
 
-      DEBUG("Sending JSON payload: ");
-      DEBUGLN(jsonPayload);
+      LOG_DEBUG("Sending JSON payload: %s", json.c_str());
 
       // Send POST request and get response headers for auth_token
       const char *headerKeys[] = {"auth_token"};
       const size_t headerKeysCount = sizeof(headerKeys) / sizeof(headerKeys[0]);
       http.collectHeaders(headerKeys, headerKeysCount);
 
-      int httpResponseCode = http.POST(jsonPayload);
+      int httpResponseCode = post((const uint8_t *)payload, json.size());
 
       // Check response
       if (httpResponseCode > 0) {
         String response = http.getString();
         String authToken = http.header("auth_token");
-        DEBUGLN(String("HTTP POST response code: ") + String(httpResponseCode));
-        DEBUGLN("Response: " + response);
+        LOG_DEBUG("HTTP POST response code: %d", httpResponseCode);
+        LOG_DEBUG("Response: %s", response.c_str());
         http.end();
 
         // Parse the user ID from the response (assuming it's in JSON format :
@@ -172,125 +659,124 @@ bool NetworkHandler::loginUser(const String &email, const String &password) {
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, response);
         if (!error) {
-          DEBUGLN("Parsed JSON successfully.");
+          LOG_DEBUG("Parsed JSON successfully.");
           // Show the document content
-          DEBUGLN("Document content: " + doc.as<String>());
+          LOG_DEBUG("Document content: %s", doc.as<String>().c_str());
           String uid = doc["uid"].as<String>();
-          DEBUGLN("User ID: " + uid);
+          LOG_INFO("User ID: %s", uid.c_str());
 
-          // Store the auth token and user ID in preferences
-          networkPreferences.begin("stacy", false);
-          networkPreferences.putString("bearer_token", authToken);
-          networkPreferences.putString("uid", uid);
-          networkPreferences.end();
+          // Store the auth token and user ID in the configuration
+          DeviceConfig::setAccount(uid.c_str(), authToken.c_str());
+          DeviceConfig::commit();
 
           if (uid.isEmpty())
             return false;
 
           return true;
         } else {
-          DEBUGLN("Failed to parse JSON response: " + String(error.c_str()));
+          LOG_ERROR("Failed to parse JSON response: %s", error.c_str());
           return false;
         }
       } else {
-        DEBUGLN(String("HTTP POST failed, error: ") +
-                http.errorToString(httpResponseCode));
+        LOG_ERROR("HTTP POST failed, error: %s",
+                  http.errorToString(httpResponseCode).c_str());
         http.end();
         return false;
       }
     } else {
-      DEBUGLN("HTTP connection failed. Unable to begin.");
+      LOG_ERROR("HTTP connection failed. Unable to begin.");
       return false;
     }
   } else {
-    DEBUGLN("WiFi not connected. Cannot log in.");
+    LOG_ERROR("WiFi not connected. Cannot log in.");
     return false;
   }
 }
 
-void NetworkHandler::createPlant(String plantName) {
+/**
+ * @brief Creates the plant on the server and stores the plant ID it returns.
+ * @param plantName The name of the plant.
+ * @param refreshed Whether the token was already refreshed for this plant,
+ * in which case a 403 is not retried again.
+ */
+void NetworkHandler::createPlant(String plantName, bool refreshed) {
   if (WiFi.status() != WL_CONNECTED) {
     NetworkHandler::connectToWiFi();
     delay(DELAY_STANDARD);
   }
 
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    WiFiClientSecure client;
-    client.setInsecure();
-
-    if (http.begin(client, String(SERVER_URL) + "/plants")) {
-      DEBUG("Creating plant on server: ");
-      DEBUGLN(String(SERVER_URL) + "/plants");
+    HTTPClient &http = httpClient;
 
-      networkPreferences.begin("stacy", true);
-      String uid = networkPreferences.getString("uid", "");
-      String bearerToken = networkPreferences.getString("bearer_token", "");
-      networkPreferences.end();
+    if (beginRequest("/plants")) {
+      LOG_INFO("Creating plant on server: %s/plants", SERVER_URL);
 
-      http.addHeader("Content-Type", "application/json");
-      http.addHeader("Authorization", "Bearer " + bearerToken);
-      http.addHeader("Device-ID", getMacAddress());
-      http.addHeader("UID", uid);
+      const DeviceConfigData &config = DeviceConfig::get();
+      addDeviceHeaders("application/json", config.bearerToken, config.uid);
 
-      String jsonPayload = "{\"plant_name\":\"" + plantName + "\"}";
+      char payload[JSON_CREDENTIALS_SIZE];
+      JsonWriter json(payload, sizeof(payload));
+      json.beginObject();
+      json.add("plant_name", plantName.c_str());
+      json.endObject();
 
-      DEBUG("Sending JSON payload: ");
-      DEBUGLN(jsonPayload);
-      DEBUG("UID: ");
-      DEBUGLN(uid);
-      DEBUG("Bearer Token: ");
-      DEBUGLN(bearerToken);
+      LOG_DEBUG("Sending JSON payload: %s", json.c_str());
+      LOG_DEBUG("UID: %s", config.uid);
+      LOG_DEBUG("Bearer Token: %s", config.bearerToken);
 
       // Send POST request
-      int httpResponseCode = http.POST(jsonPayload);
+      int httpResponseCode = post((const uint8_t *)payload, json.size());
 
-      if (httpResponseCode == HTTP_CODE_FORBIDDEN) {
-        DEBUGLN("Expired or invalid token. Refreshing token...");
+      if (httpResponseCode == HTTP_CODE_FORBIDDEN && refreshed) {
+        LOG_ERROR("Token refused again after a refresh. Cannot create "
+                  "plant.");
+      } else if (httpResponseCode == HTTP_CODE_FORBIDDEN) {
+        LOG_WARN("Expired or invalid token. Refreshing token...");
+        http.end();
         bool worked = NetworkHandler::refreshToken();
 
         if (!worked) {
-          DEBUGLN("Failed to refresh token. Cannot create plant.");
+          LOG_ERROR("Failed to refresh token. Cannot create plant.");
           return;
         }
-        DEBUGLN("Re-attempting to create plant after token refresh.");
-        NetworkHandler::createPlant(plantName);
+        LOG_INFO("Re-attempting to create plant after token refresh.");
+        NetworkHandler::createPlant(plantName, true);
+        return;
       } else if (httpResponseCode == HTTP_CODE_CREATED) {
-        DEBUGLN(String("HTTP POST response code: ") + String(httpResponseCode));
+        LOG_DEBUG("HTTP POST response code: %d", httpResponseCode);
 
         String response = http.getString();
-        DEBUGLN("Response: " + response);
+        LOG_DEBUG("Response: %s", response.c_str());
 
         // Parse the plant ID from the response (assuming it's in JSON format)
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, response);
         if (!error) {
           String plantId = doc["plant_id"].as<String>();
-          DEBUGLN("Parsed JSON successfully.");
-          DEBUGLN("Plant ID: " + plantId);
-          // Store the plant ID in preferences
-          networkPreferences.begin("stacy", false);
-          networkPreferences.putString("plant_id", plantId);
-          networkPreferences.end();
+          LOG_DEBUG("Parsed JSON successfully.");
+          LOG_DEBUG("Plant ID: %s", plantId.c_str());
+          // Store the plant ID, written with the rest before power-off
+          DeviceConfig::setPlantId(plantId.c_str());
 
           if (plantId.isEmpty()) {
-            DEBUGLN("Failed to create plant. Plant ID is empty.");
+            LOG_ERROR("Failed to create plant. Plant ID is empty.");
           } else {
-            DEBUGLN("Plant created successfully with ID: " + plantId);
+            LOG_INFO("Plant created successfully with ID: %s",
+                     plantId.c_str());
           }
         } else {
-          DEBUGLN("Failed to parse JSON response: " + String(error.c_str()));
+          LOG_ERROR("Failed to parse JSON response: %s", error.c_str());
         }
       } else {
-        DEBUGLN(String("HTTP POST failed, code: ") + String(httpResponseCode) +
-                ", error: " + http.errorToString(httpResponseCode));
+        LOG_ERROR("HTTP POST failed, code: %d, error: %s", httpResponseCode,
+                  http.errorToString(httpResponseCode).c_str());
       }
       http.end();
     } else {
-      DEBUGLN("HTTP connection failed. Unable to begin.");
+      LOG_ERROR("HTTP connection failed. Unable to begin.");
     }
   } else {
-    DEBUGLN("WiFi not connected. Cannot create plant.");
+    LOG_ERROR("WiFi not connected. Cannot create plant.");
   }
 }
 
@@ -307,58 +793,49 @@ bool NetworkHandler::refreshToken() {
   }
 
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    WiFiClientSecure client;
-    client.setInsecure();
+    HTTPClient &http = httpClient;
 
-    DEBUGLN("Refreshing bearer token...");
+    LOG_INFO("Refreshing bearer token...");
 
-    if (http.begin(client, String(SERVER_URL) + "/refresh")) {
-      networkPreferences.begin("stacy", true);
-      String bearerToken = networkPreferences.getString("bearer_token", "");
-      String uid = networkPreferences.getString("uid", "");
-      networkPreferences.end();
+    if (beginRequest("/refresh")) {
+      const DeviceConfigData &config = DeviceConfig::get();
+      addDeviceHeaders("application/json", config.bearerToken, config.uid);
 
-      http.addHeader("Content-Type", "application/json");
-      http.addHeader("Authorization", "Bearer " + bearerToken);
-      http.addHeader("Device-ID", getMacAddress());
-      http.addHeader("UID", uid);
-
-      int httpResponseCode = http.POST("{}");
+      int httpResponseCode = post((const uint8_t *)"{}", 2);
 
       if (httpResponseCode == HTTP_CODE_OK) {
         String response = http.getString();
-        DEBUGLN(String("HTTP POST response code: ") + String(httpResponseCode));
-        DEBUGLN("Response: " + response);
+        http.end();
+        LOG_DEBUG("HTTP POST response code: %d", httpResponseCode);
+        LOG_DEBUG("Response: %s", response.c_str());
 
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, response);
         if (!error) {
           String newToken = doc["auth_token"].as<String>();
-          DEBUGLN("Parsed JSON successfully.");
-          DEBUGLN("New Bearer Token: " + newToken);
+          LOG_DEBUG("Parsed JSON successfully.");
+          LOG_DEBUG("New Bearer Token: %s", newToken.c_str());
 
-          networkPreferences.begin("stacy", false);
-          networkPreferences.putString("bearer_token", newToken);
-          networkPreferences.end();
+          // Written with the rest of the configuration before power-off
+          DeviceConfig::setBearerToken(newToken.c_str());
 
           return true;
         } else {
-          DEBUGLN("Failed to parse JSON response: " + String(error.c_str()));
+          LOG_ERROR("Failed to parse JSON response: %s", error.c_str());
           return false;
         }
       } else {
-        DEBUGLN(String("HTTP POST failed, code: ") + String(httpResponseCode) +
-                ", error: " + http.errorToString(httpResponseCode));
+        LOG_ERROR("HTTP POST failed, code: %d, error: %s", httpResponseCode,
+                  http.errorToString(httpResponseCode).c_str());
+        http.end();
         return false;
       }
-      http.end();
     } else {
-      DEBUGLN("HTTP connection failed. Unable to begin.");
+      LOG_ERROR("HTTP connection failed. Unable to begin.");
       return false;
     }
   } else {
-    DEBUGLN("WiFi not connected. Cannot refresh token.");
+    LOG_ERROR("WiFi not connected. Cannot refresh token.");
     return false;
   }
 }
@@ -369,7 +846,6 @@ bool NetworkHandler::refreshToken() {
  * @return The MAC address as a String.
  */
 String NetworkHandler::getMacAddress() {
-  DEBUG("Reading MAC address... ");
   uint8_t baseMac[6];
   esp_err_t ret = esp_wifi_get_mac(WIFI_IF_STA, baseMac);
 
@@ -380,12 +856,11 @@ String NetworkHandler::getMacAddress() {
              baseMac[5]);
     String macAddress = String(macStr);
     macAddress.toUpperCase();
-    DEBUGLN("MAC Address: " + macAddress);
+    LOG_DEBUG("MAC Address: %s", macAddress.c_str());
 
     return macAddress;
   } else {
-    DEBUGLN("Failed to read MAC address");
-    DEBUGLN("Error code: " + String(ret));
+    LOG_ERROR("Failed to read MAC address, error code: %d", ret);
 
     return "00:00:00:00:00:00";
   }
@@ -0,0 +1,476 @@
+#include "offline_queue.h"
+#include "checksum.h"
+#include "logger.h"
+#include "phase_profiler.h"
+#include <LittleFS.h>
+#include <Preferences.h>
+
+#define OFFLINE_QUEUE_MAGIC 0x53545146 // "STQF"
+#define SEGMENT_MAGIC 0x53545153         // "STQS"
+#define OFFLINE_QUEUE_DIR "/queue"
+
+Preferences queuePreferences;
+bool OfflineQueue::mounted = false;
+bool OfflineQueue::loaded = false;
+OfflineQueueState OfflineQueue::state;
+OfflineQueueState OfflineQueue::readState;
+uint32_t OfflineQueue::firstSegment = 0;
+uint32_t OfflineQueue::lastSegment = 0;
+size_t OfflineQueue::lastSegmentRecords = 0;
+bool OfflineQueue::lastSegmentTorn = false;
+uint32_t OfflineQueue::lastSegmentEpoch = 0;
+bool OfflineQueue::hasSegments = false;
+
+/**
+ * @brief Restores the queue position from NVS.
+ */
+void OfflineQueue::load() {
+  if (loaded)
+    return;
+  loaded = true;
+  PhaseTimer timer(PHASE_NVS);
+  queuePreferences.begin("stacy", true);
+  size_t length =
+      queuePreferences.getBytes("queue", &state, sizeof(OfflineQueueState));
+  queuePreferences.end();
+  if (length != sizeof(OfflineQueueState) ||
+      state.magic != OFFLINE_QUEUE_MAGIC) {
+    memset(&state, 0, sizeof(OfflineQueueState));
+    state.magic = OFFLINE_QUEUE_MAGIC;
+  }
+}
+
+/**
+ * @brief Writes the queue position to NVS.
+ */
+void OfflineQueue::save() {
+  PhaseTimer timer(PHASE_NVS);
+  queuePreferences.begin("stacy", false);
+  queuePreferences.putBytes("queue", &state, sizeof(OfflineQueueState));
+  queuePreferences.end();
+}
+
+/**
+ * @brief Gets the path of a segment file.
+ * @param segment The segment number.
+ * @return The path.
+ */
+String OfflineQueue::segmentPath(uint32_t segment) {
+  return String(OFFLINE_QUEUE_DIR "/") + String(segment) + ".log";
+}
+
+/**
+ * @brief Mounts LittleFS, formatting it if it cannot be mounted, and finds
+ * the segments on it.
+ * @return True if the filesystem is usable.
+ */
+bool OfflineQueue::mount() {
+  if (mounted)
+    return true;
+  if (!LittleFS.begin(true)) {
+    LOG_ERROR("LittleFS mount failed. Offline queue unavailable.");
+    return false;
+  }
+  mounted = true;
+  if (!LittleFS.exists(OFFLINE_QUEUE_DIR)) {
+    LittleFS.mkdir(OFFLINE_QUEUE_DIR);
+  }
+  scan();
+  return true;
+}
+
+/**
+ * @brief Lists the segment files, deletes the ones already sent and any
+ * leftover copy, and recounts the queued records from the file sizes.
+ */
+void OfflineQueue::scan() {
+  hasSegments = false;
+  size_t lastSize = 0;
+  size_t stored = 0;
+  uint32_t staleFrom = state.segment;
+  String leftover;
+
+  File directory = LittleFS.open(OFFLINE_QUEUE_DIR);
+  File file = directory.openNextFile();
+  while (file) {
+    char *end;
+    uint32_t segment = strtoul(file.name(), &end, 10);
+    if (strcmp(end, ".log") == 0) {
+      if (segment < state.segment) {
+        // Sent, but power was lost before it was deleted
+        staleFrom = min(staleFrom, segment);
+      } else {
+        if (file.size() >= sizeof(SegmentHeader))
+          stored +=
+              (file.size() - sizeof(SegmentHeader)) / sizeof(QueuedRecord);
+        if (!hasSegments || segment < firstSegment)
+          firstSegment = segment;
+        if (!hasSegments || segment > lastSegment) {
+          lastSegment = segment;
+          lastSize = file.size();
+        }
+        hasSegments = true;
+      }
+    } else if (strcmp(end, ".log.tmp") == 0) {
+      // Copy of a segment being cut back when power was lost
+      leftover = String(OFFLINE_QUEUE_DIR "/") + file.name();
+    }
+    file = directory.openNextFile();
+  }
+  directory.close();
+  if (leftover.length() > 0)
+    LittleFS.remove(leftover);
+
+  for (uint32_t segment = staleFrom; segment < state.segment; segment++) {
+    LittleFS.remove(segmentPath(segment));
+  }
+
+  if (!hasSegments) {
+    state.count = 0;
+    state.offset = 0;
+    return;
+  }
+  if (state.segment < firstSegment) {
+    state.segment = firstSegment;
+    state.offset = 0;
+  }
+  lastSegmentRecords = 0;
+  lastSegmentTorn = true;
+  if (lastSize >= sizeof(SegmentHeader)) {
+    size_t records = lastSize - sizeof(SegmentHeader);
+    lastSegmentRecords = records / sizeof(QueuedRecord);
+    File last = LittleFS.open(segmentPath(lastSegment), FILE_READ);
+    lastSegmentTorn = records % sizeof(QueuedRecord) != 0 || !last ||
+                      !readHeader(last, lastSegmentEpoch);
+    if (last)
+      last.close();
+  }
+  state.count = stored > state.offset ? stored - state.offset : 0;
+}
+
+/**
+ * @brief Reads the header at the start of a segment file.
+ * @param file The segment file, open for reading.
+ * @param epoch Set to the wake clock the segment's deltas count from.
+ * @return True if the header is intact.
+ */
+bool OfflineQueue::readHeader(File &file, uint32_t &epoch) {
+  SegmentHeader header;
+  if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+      header.magic != SEGMENT_MAGIC)
+    return false;
+  epoch = header.epoch;
+  return true;
+}
+
+/**
+ * @brief Starts a new segment after the last one, evicting the oldest
+ * segment if the queue is full.
+ * @param epoch The wake clock the segment's deltas count from.
+ * @return True if the segment header was written.
+ */
+bool OfflineQueue::startSegment(uint32_t epoch) {
+  uint32_t segment = hasSegments ? lastSegment + 1 : state.segment;
+  if (!hasSegments) {
+    firstSegment = segment;
+    state.offset = 0;
+  }
+  hasSegments = true;
+  lastSegment = segment;
+  lastSegmentRecords = 0;
+  lastSegmentEpoch = epoch;
+  lastSegmentTorn = true; // until the header is written
+  if (lastSegment - firstSegment >= OFFLINE_QUEUE_MAX_SEGMENTS) {
+    evictOldest();
+  }
+
+  File file = LittleFS.open(segmentPath(segment), FILE_WRITE);
+  if (!file)
+    return false;
+  SegmentHeader header = {SEGMENT_MAGIC, epoch};
+  lastSegmentTorn =
+      file.write((const uint8_t *)&header, sizeof(header)) != sizeof(header);
+  file.close();
+  return !lastSegmentTorn;
+}
+
+/**
+ * @brief Drops the oldest segment to make room. Its unsent records are
+ * counted from the file, as segments are often partial: a torn record or an
+ * epoch too far for a delta starts the next one early.
+ */
+void OfflineQueue::evictOldest() {
+  String path = segmentPath(firstSegment);
+  if (state.segment == firstSegment) {
+    size_t stored = 0;
+    File file = LittleFS.open(path, FILE_READ);
+    if (file) {
+      if (file.size() >= sizeof(SegmentHeader))
+        stored = (file.size() - sizeof(SegmentHeader)) / sizeof(QueuedRecord);
+      file.close();
+    }
+    uint32_t dropped = stored > state.offset ? stored - state.offset : 0;
+    state.count = state.count > dropped ? state.count - dropped : 0;
+    state.segment = firstSegment + 1;
+    state.offset = 0;
+  }
+  LittleFS.remove(path);
+  firstSegment++;
+  LOG_WARN("Offline queue full. Oldest segment dropped.");
+}
+
+/**
+ * @brief Gets the number of queued readings, without touching the flash.
+ * @return The number of readings.
+ */
+size_t OfflineQueue::count() {
+  load();
+  return state.count;
+}
+
+/**
+ * @brief Appends readings to the queue.
+ * @param readings The readings, oldest first.
+ * @param count The number of readings.
+ * @param epoch The wake clock the reading deltas count from.
+ * @return True if every reading was queued. On false none is, and the
+ * caller keeps them.
+ */
+bool OfflineQueue::append(const PackedReading *readings, size_t count,
+                          uint32_t epoch) {
+  load();
+  if (count == 0)
+    return true;
+  if (!mount())
+    return false;
+
+  OfflineQueueState before = state;
+  bool hadSegments = hasSegments;
+  uint32_t previousSegment = lastSegment;
+  size_t previousRecords = lastSegmentRecords;
+  bool previousTorn = lastSegmentTorn;
+  uint32_t previousEpoch = lastSegmentEpoch;
+
+  size_t written = 0;
+  bool failed = false;
+  while (written < count && !failed) {
+    uint32_t time = epoch + readings[written].delta;
+    if (!hasSegments || lastSegmentTorn ||
+        lastSegmentRecords >= OFFLINE_QUEUE_SEGMENT_RECORDS ||
+        time < lastSegmentEpoch || time - lastSegmentEpoch > UINT16_MAX) {
+      if (!startSegment(time)) {
+        LOG_ERROR("Failed to start an offline queue segment.");
+        failed = true;
+        break;
+      }
+    }
+
+    File file = LittleFS.open(segmentPath(lastSegment), FILE_APPEND);
+    if (!file) {
+      LOG_ERROR("Failed to open an offline queue segment.");
+      failed = true;
+      break;
+    }
+    size_t room = OFFLINE_QUEUE_SEGMENT_RECORDS - lastSegmentRecords;
+    size_t batch = min(count - written, room);
+    size_t done = 0;
+    for (; done < batch; done++) {
+      QueuedRecord record;
+      record.reading = readings[written + done];
+      time = epoch + record.reading.delta;
+      if (time < lastSegmentEpoch || time - lastSegmentEpoch > UINT16_MAX)
+        break;
+      record.reading.delta = time - lastSegmentEpoch;
+      record.crc = Checksum::crc32((const uint8_t *)&record.reading,
+                                   sizeof(PackedReading));
+      if (file.write((const uint8_t *)&record, sizeof(record)) !=
+          sizeof(record)) {
+        LOG_ERROR("Offline queue write failed.");
+        failed = true;
+        break;
+      }
+    }
+    file.close();
+    lastSegmentRecords += done;
+    written += done;
+  }
+
+  if (failed) {
+    // The records already written would be sent along with the readings
+    // the caller keeps, so they go too
+    discardSegments(hadSegments ? previousSegment + 1 : firstSegment);
+    if (hadSegments) {
+      hasSegments = true;
+      lastSegment = previousSegment;
+      lastSegmentRecords = previousRecords;
+      lastSegmentEpoch = previousEpoch;
+      lastSegmentTorn = previousTorn;
+      if (!previousTorn &&
+          !truncateSegment(previousSegment, previousRecords)) {
+        LOG_ERROR("Failed to discard a partial append. It may be sent twice.");
+        lastSegmentTorn = true;
+      }
+    }
+    // Only evictions changed the position
+    if (memcmp(&before, &state, sizeof(OfflineQueueState)) != 0)
+      save();
+    return false;
+  }
+
+  // Counted last: a power loss before this leaves records the count misses,
+  // which scan() finds on the next mount
+  state.count += count;
+  save();
+  LOG_INFO("Queued %zu readings in flash, %lu waiting.", count,
+           (unsigned long)state.count);
+  return true;
+}
+
+/**
+ * @brief Deletes the segments from one up to the last, which a failed
+ * append started.
+ * @param from The first segment to delete.
+ */
+void OfflineQueue::discardSegments(uint32_t from) {
+  if (!hasSegments)
+    return;
+  for (uint32_t segment = from; segment <= lastSegment; segment++) {
+    LittleFS.remove(segmentPath(segment));
+  }
+  if (from <= firstSegment) {
+    hasSegments = false;
+    lastSegmentRecords = 0;
+    lastSegmentTorn = false;
+  }
+}
+
+/**
+ * @brief Cuts a segment back to its first records. LittleFS cannot
+ * truncate, so those are copied to a new file that replaces the segment.
+ * @param segment The segment number.
+ * @param records The records to keep.
+ * @return True if the segment holds just those records.
+ */
+bool OfflineQueue::truncateSegment(uint32_t segment, size_t records) {
+  String path = segmentPath(segment);
+  size_t size = sizeof(SegmentHeader) + records * sizeof(QueuedRecord);
+  File source = LittleFS.open(path, FILE_READ);
+  if (!source)
+    return false;
+  if (source.size() == size) {
+    source.close();
+    return true;
+  }
+
+  String copyPath = path + ".tmp";
+  File copy = LittleFS.open(copyPath, FILE_WRITE);
+  size_t copied = 0;
+  uint8_t chunk[sizeof(QueuedRecord)];
+  while (copy && copied < size) {
+    size_t length = min(sizeof(chunk), size - copied);
+    if (source.read(chunk, length) != length ||
+        copy.write(chunk, length) != length)
+      break;
+    copied += length;
+  }
+  source.close();
+  if (copy)
+    copy.close();
+  if (copied == size && LittleFS.rename(copyPath, path))
+    return true;
+  LittleFS.remove(copyPath);
+  return false;
+}
+
+/**
+ * @brief Reads the oldest queued readings. They stay queued until commit().
+ * Records failing their CRC are skipped, and so are segments whose header
+ * is not intact. Reading stops early at a reading whose time does not fit a
+ * delta from the epoch of the first one.
+ * @param readings Filled with the readings, oldest first.
+ * @param capacity The size of the readings array.
+ * @param epoch Set to the wake clock the reading deltas count from.
+ * @return The number of readings read.
+ */
+size_t OfflineQueue::read(PackedReading *readings, size_t capacity,
+                          uint32_t &epoch) {
+  load();
+  readState = state;
+  epoch = 0;
+  if (state.count == 0 || !mount() || !hasSegments)
+    return 0;
+
+  size_t count = 0;
+  uint32_t advanced = 0;
+  bool rebased = true;
+  while (count < capacity && rebased) {
+    File file = LittleFS.open(segmentPath(readState.segment), FILE_READ);
+    uint32_t segmentEpoch;
+    if (file && readHeader(file, segmentEpoch) &&
+        file.seek(sizeof(SegmentHeader) +
+                  readState.offset * sizeof(QueuedRecord))) {
+      QueuedRecord record;
+      while (count < capacity &&
+             file.read((uint8_t *)&record, sizeof(record)) == sizeof(record)) {
+        if (Checksum::crc32((const uint8_t *)&record.reading,
+                            sizeof(PackedReading)) != record.crc) {
+          LOG_WARN("Skipping a corrupted queued reading.");
+          readState.offset++;
+          advanced++;
+          continue;
+        }
+        if (count == 0)
+          epoch = segmentEpoch;
+        uint32_t time = segmentEpoch + record.reading.delta;
+        if (time < epoch || time - epoch > UINT16_MAX) {
+          rebased = false; // left for the next read
+          break;
+        }
+        readState.offset++;
+        advanced++;
+        record.reading.delta = time - epoch;
+        readings[count++] = record.reading;
+      }
+    }
+    if (file)
+      file.close();
+    if (count >= capacity || !rebased || readState.segment >= lastSegment)
+      break;
+    readState.segment++;
+    readState.offset = 0;
+  }
+
+  bool drained = readState.segment >= lastSegment &&
+                 readState.offset >= lastSegmentRecords;
+  readState.count =
+      drained ? 0 : (state.count > advanced ? state.count - advanced : 1);
+  return count;
+}
+
+/**
+ * @brief Removes the readings returned by the last read() from the queue,
+ * once the server has accepted them.
+ */
+void OfflineQueue::commit() {
+  if (!mounted || !hasSegments)
+    return;
+  bool drained = readState.count == 0;
+  if (drained) {
+    readState.segment = lastSegment + 1;
+    readState.offset = 0;
+  }
+  // Position first: a power loss before the deletes leaves stale segments,
+  // which scan() removes, never sends them twice
+  state = readState;
+  save();
+
+  for (uint32_t segment = firstSegment; segment < state.segment; segment++) {
+    LittleFS.remove(segmentPath(segment));
+  }
+  firstSegment = state.segment;
+  if (drained) {
+    hasSegments = false;
+    lastSegmentRecords = 0;
+    lastSegmentTorn = false;
+  }
+}
@@ -0,0 +1,141 @@
+#include "phase_profiler.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <esp_timer.h>
+
+#define WAKE_PROFILE_MAGIC 0x53545750 // "STWP"
+#define PROFILE_UNIT_US 100
+
+static const char *const phaseNames[PHASE_COUNT] = {
+    "boot", "nvs", "wifi", "tls", "sensor", "adc", "post", "startup",
+    "battery"};
+
+Preferences profilePreferences;
+uint32_t PhaseProfiler::startTimes[PHASE_COUNT];
+uint8_t PhaseProfiler::depth[PHASE_COUNT];
+uint32_t PhaseProfiler::totals[PHASE_COUNT];
+PhaseInterval PhaseProfiler::trace[PROFILER_TRACE_SIZE];
+size_t PhaseProfiler::traceHead = 0;
+size_t PhaseProfiler::traceCount = 0;
+WakeProfile PhaseProfiler::saved;
+bool PhaseProfiler::dirty = false;
+
+/**
+ * @brief Records the boot phase, from reset to now, and starts the startup
+ * phase at reset. Call first in setup().
+ */
+void PhaseProfiler::begin() {
+  startTimes[PHASE_BOOT] = 0;
+  depth[PHASE_BOOT] = 1;
+  stop(PHASE_BOOT);
+  startTimes[PHASE_STARTUP] = 0;
+  depth[PHASE_STARTUP] = 1;
+}
+
+/**
+ * @brief Starts timing a phase. Nested starts of the same phase are
+ * counted once, from the outermost one.
+ * @param phase The phase.
+ */
+void PhaseProfiler::start(Phase phase) {
+  if (depth[phase]++ == 0)
+    startTimes[phase] = esp_timer_get_time();
+}
+
+/**
+ * @brief Stops timing a phase and records the interval.
+ * @param phase The phase.
+ */
+void PhaseProfiler::stop(Phase phase) {
+  if (depth[phase] == 0 || --depth[phase] > 0)
+    return;
+  uint32_t duration = (uint32_t)esp_timer_get_time() - startTimes[phase];
+  totals[phase] += duration;
+
+  // The ring keeps the latest intervals
+  PhaseInterval &interval = trace[traceHead];
+  interval.phase = phase;
+  interval.start = startTimes[phase];
+  interval.duration = duration;
+  traceHead = (traceHead + 1) % PROFILER_TRACE_SIZE;
+  if (traceCount < PROFILER_TRACE_SIZE)
+    traceCount++;
+}
+
+/**
+ * @brief Gets the time spent in a phase so far this wake.
+ * @param phase The phase.
+ * @return The time in microseconds.
+ */
+uint32_t PhaseProfiler::total(Phase phase) { return totals[phase]; }
+
+/**
+ * @brief Converts microseconds to profile units.
+ * @param micros The time in microseconds.
+ * @return The time in units of 100 us, saturated to 16 bits.
+ */
+uint16_t PhaseProfiler::toUnits(uint32_t micros) {
+  uint32_t units = micros / PROFILE_UNIT_US;
+  return units > UINT16_MAX ? UINT16_MAX : units;
+}
+
+/**
+ * @brief Keeps the profile of this wake so far, to be sent with the next
+ * batch once commit() stores it. Call at the end of a wake that uploaded.
+ */
+void PhaseProfiler::save() {
+  saved.magic = WAKE_PROFILE_MAGIC;
+  saved.awake = toUnits(esp_timer_get_time());
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    saved.phases[i] = toUnits(totals[i]);
+  }
+  dirty = true;
+}
+
+/**
+ * @brief Writes the profile kept by save() to NVS, if any. Call before power
+ * is cut.
+ */
+void PhaseProfiler::commit() {
+  if (!dirty)
+    return;
+  dirty = false;
+  profilePreferences.begin("stacy", false);
+  profilePreferences.putBytes("profile", &saved, sizeof(WakeProfile));
+  profilePreferences.end();
+}
+
+/**
+ * @brief Gets the profile of the last wake that uploaded.
+ * @param profile Set to the profile.
+ * @return True if a profile was stored.
+ */
+bool PhaseProfiler::lastUplink(WakeProfile &profile) {
+  PhaseTimer timer(PHASE_NVS);
+  profilePreferences.begin("stacy", true);
+  size_t length =
+      profilePreferences.getBytes("profile", &profile, sizeof(WakeProfile));
+  profilePreferences.end();
+  return length == sizeof(WakeProfile) && profile.magic == WAKE_PROFILE_MAGIC;
+}
+
+/**
+ * @brief Prints the time spent in each phase and the trace, oldest first.
+ */
+void PhaseProfiler::report() {
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  LOG_DEBUG("Phase timings (us), awake %lu:",
+            (unsigned long)esp_timer_get_time());
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    LOG_DEBUG("  %s: %lu", phaseNames[i], (unsigned long)totals[i]);
+  }
+  LOG_DEBUG("Phase trace (us):");
+  for (size_t i = 0; i < traceCount; i++) {
+    const PhaseInterval &interval =
+        trace[(traceHead + PROFILER_TRACE_SIZE - traceCount + i) %
+              PROFILER_TRACE_SIZE];
+    LOG_DEBUG("  %lu %s %lu", (unsigned long)interval.start,
+              phaseNames[interval.phase], (unsigned long)interval.duration);
+  }
+#endif
+}
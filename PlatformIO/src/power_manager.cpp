@@ -0,0 +1,72 @@
+#include "power_manager.h"
+#include "device_config.h"
+#include "logger.h"
+#include "network_handler.h"
+#include "phase_profiler.h"
+#include "reading_buffer.h"
+#include "report_policy.h"
+#include <esp_sleep.h>
+
+#define POWER_STATE_MAGIC 0x53545057 // "STPW"
+
+RTC_DATA_ATTR PowerState powerState;
+bool PowerManager::retained = false;
+
+/**
+ * @brief Prepares the power backend and checks what RTC memory kept from
+ * the previous wake. Call early in setup(), before the state kept in RTC
+ * memory is used.
+ */
+void PowerManager::begin() {
+  if (POWER_BACKEND == POWER_TPL5110) {
+    pinMode(TPL5110_DONE_PIN, OUTPUT);
+  }
+
+  retained = powerState.magic == POWER_STATE_MAGIC &&
+             esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+  if (!retained) {
+    memset(&powerState, 0, sizeof(PowerState));
+    powerState.magic = POWER_STATE_MAGIC;
+  }
+  powerState.cycles++;
+}
+
+/**
+ * @brief Tells whether RTC memory was retained from the previous wake.
+ * @return True after a timer wake from deep sleep, false after a TPL5110
+ * power cut or any reset.
+ */
+bool PowerManager::isRetained() { return retained; }
+
+/**
+ * @brief Ends the wake: commits the settings and state it changed, such as
+ * a refreshed token or the reading buffer, each once however often it
+ * changed, then either pulses the TPL5110 DONE pin LOW then HIGH so it cuts
+ * power, or enters deep sleep until the timer wakes the next cycle.
+ */
+void PowerManager::sleep() {
+  DeviceConfig::commit();
+  ReadingBuffer::commit();
+  ReportPolicy::commit();
+  NetworkHandler::commitWiFiCache();
+  PhaseProfiler::commit();
+
+  unsigned long awake = millis();
+  if (retained) {
+    LOG_INFO("Cycle %lu awake %lu ms (previous %lu ms). RTC state retained.",
+             (unsigned long)powerState.cycles, awake,
+             (unsigned long)powerState.lastAwake);
+  } else {
+    LOG_INFO("Cycle %lu awake %lu ms. RTC state lost.",
+             (unsigned long)powerState.cycles, awake);
+  }
+  powerState.lastAwake = awake;
+
+  if (POWER_BACKEND == POWER_DEEP_SLEEP) {
+    esp_sleep_enable_timer_wakeup(TIME_TO_SLEEP * uS_TO_S_FACTOR);
+    esp_deep_sleep_start();
+  }
+  digitalWrite(TPL5110_DONE_PIN, LOW);
+  digitalWrite(TPL5110_DONE_PIN, HIGH);
+  delay(100);
+}
@@ -0,0 +1,215 @@
+#include "reading_buffer.h"
+#include "configuration.h"
+#include "logger.h"
+#include "phase_profiler.h"
+#include <Preferences.h>
+
+#define READING_BUFFER_MAGIC 0x53544232 // "STB2"
+
+Preferences bufferPreferences;
+RTC_DATA_ATTR ReadingBufferState bufferState;
+uint32_t ReadingBuffer::currentTime = 0;
+bool ReadingBuffer::dirty = false;
+
+/**
+ * @brief Checks that a restored buffer state is intact.
+ * @param state The state to check.
+ * @return True if the state can be used, false otherwise.
+ */
+bool ReadingBuffer::isValid(const ReadingBufferState &state) {
+  return state.magic == READING_BUFFER_MAGIC &&
+         state.head < READING_BUFFER_CAPACITY &&
+         state.count <= READING_BUFFER_CAPACITY;
+}
+
+/**
+ * @brief Maps a reading index to its slot in the ring.
+ * @param index The reading index, 0 being the oldest.
+ * @return The slot index.
+ */
+size_t ReadingBuffer::slotOf(size_t index) {
+  return (bufferState.head + READING_BUFFER_CAPACITY - bufferState.count +
+          index) %
+         READING_BUFFER_CAPACITY;
+}
+
+/**
+ * @brief Restores the buffer from RTC memory, or from NVS when power was cut.
+ * With deep sleep the buffer is only in RTC memory and starts empty when
+ * that was lost.
+ * @param now The wake clock, used to stamp and age readings.
+ */
+void ReadingBuffer::begin(uint32_t now) {
+  currentTime = now;
+  if (isValid(bufferState)) {
+    LOG_DEBUG("Reading buffer restored from RTC memory.");
+    return;
+  }
+  if (POWER_RETAINS_RTC) {
+    memset(&bufferState, 0, sizeof(ReadingBufferState));
+    bufferState.magic = READING_BUFFER_MAGIC;
+    LOG_INFO("Reading buffer lost with RTC memory. Initialized empty.");
+    return;
+  }
+
+  PhaseTimer timer(PHASE_NVS);
+  ReadingBufferState stored;
+  bufferPreferences.begin("stacy", true);
+  size_t length = bufferPreferences.getBytes("readings", &stored,
+                                             sizeof(ReadingBufferState));
+  bufferPreferences.end();
+
+  if (length == sizeof(ReadingBufferState) && isValid(stored)) {
+    bufferState = stored;
+    LOG_INFO("Reading buffer restored from NVS.");
+  } else {
+    memset(&bufferState, 0, sizeof(ReadingBufferState));
+    bufferState.magic = READING_BUFFER_MAGIC;
+    LOG_DEBUG("Reading buffer initialized empty.");
+  }
+  LOG_DEBUG("Buffered readings: %u", bufferState.count);
+}
+
+/**
+ * @brief Writes the buffer to NVS if it changed during this wake, so it
+ * survives a TPL5110 power cut. Deep sleep keeps it in RTC memory instead.
+ * Call before power is cut.
+ */
+void ReadingBuffer::commit() {
+  if (POWER_RETAINS_RTC || !dirty)
+    return;
+  dirty = false;
+  PhaseTimer timer(PHASE_NVS);
+  bufferPreferences.begin("stacy", false);
+  bufferPreferences.putBytes("readings", &bufferState,
+                             sizeof(ReadingBufferState));
+  bufferPreferences.end();
+}
+
+/**
+ * @brief Moves the epoch so that the current time fits a reading delta,
+ * once it no longer does. Readings too old to fit are kept with the oldest
+ * delta, so their age is underestimated; the buffer is normally flushed
+ * long before.
+ */
+void ReadingBuffer::rebase() {
+  uint32_t epoch = currentTime;
+  // A clock that went backwards restarted: the readings get no age, as
+  // age() would give them
+  uint32_t shift = UINT16_MAX;
+  if (bufferState.count > 0 && currentTime > bufferState.epoch) {
+    uint16_t oldest = UINT16_MAX;
+    for (size_t i = 0; i < bufferState.count; i++) {
+      oldest = min(oldest, bufferState.readings[slotOf(i)].delta);
+    }
+    epoch = max(bufferState.epoch + oldest, currentTime - UINT16_MAX);
+    shift = epoch - bufferState.epoch;
+  }
+  for (size_t i = 0; i < bufferState.count; i++) {
+    PackedReading &reading = bufferState.readings[slotOf(i)];
+    reading.delta = reading.delta > shift ? reading.delta - shift : 0;
+  }
+  bufferState.epoch = epoch;
+}
+
+/**
+ * @brief Appends a reading, overwriting the oldest one when full.
+ * @param sensorData The reading to store.
+ */
+void ReadingBuffer::push(const SensorData &sensorData) {
+  if (bufferState.count == 0 || currentTime < bufferState.epoch ||
+      currentTime - bufferState.epoch > UINT16_MAX) {
+    rebase();
+  }
+  bufferState.readings[bufferState.head] =
+      ReadingRecord::pack(sensorData, currentTime - bufferState.epoch);
+
+  bufferState.head = (bufferState.head + 1) % READING_BUFFER_CAPACITY;
+  if (bufferState.count < READING_BUFFER_CAPACITY) {
+    bufferState.count++;
+  } else {
+    LOG_WARN("Reading buffer full. Oldest reading dropped.");
+  }
+  dirty = true;
+}
+
+/**
+ * @brief Tells whether the radio should be brought up to flush the buffer.
+ * @return True if the buffer reached its size or age limit.
+ */
+bool ReadingBuffer::shouldFlush() {
+  if (bufferState.count == 0)
+    return false;
+  return bufferState.count >= READING_BUFFER_FLUSH_COUNT ||
+         ageOf(0) >= READING_BUFFER_MAX_AGE_S;
+}
+
+/**
+ * @brief Tells whether the buffer will need flushing once the reading of
+ * this wake is pushed, so the radio can be started before sampling.
+ * @return True if the next push reaches the size or age limit.
+ */
+bool ReadingBuffer::shouldFlushAfterPush() {
+  uint32_t countAfterPush = bufferState.count < READING_BUFFER_CAPACITY
+                                ? bufferState.count + 1
+                                : READING_BUFFER_CAPACITY;
+  return countAfterPush >= READING_BUFFER_FLUSH_COUNT ||
+         (bufferState.count > 0 && ageOf(0) >= READING_BUFFER_MAX_AGE_S);
+}
+
+/**
+ * @brief Gets the number of buffered readings.
+ * @return The number of readings.
+ */
+size_t ReadingBuffer::count() { return bufferState.count; }
+
+/**
+ * @brief Gets the age of a reading from its wake clock stamp.
+ * @param time The wake clock when the reading was sampled.
+ * @return The age in seconds.
+ */
+uint32_t ReadingBuffer::age(uint32_t time) {
+  // The clock restarts if its state is lost, never report a negative age
+  return currentTime > time ? currentTime - time : 0;
+}
+
+/**
+ * @brief Gets the age of a buffered reading.
+ * @param index The reading index, 0 being the oldest.
+ * @return The age in seconds.
+ */
+uint32_t ReadingBuffer::ageOf(size_t index) {
+  return age(bufferState.epoch + bufferState.readings[slotOf(index)].delta);
+}
+
+/**
+ * @brief Copies a buffered reading into a SensorData struct.
+ * @param index The reading index, 0 being the oldest.
+ * @param sensorData Reference to the SensorData struct to populate.
+ */
+void ReadingBuffer::get(size_t index, SensorData &sensorData) {
+  ReadingRecord::unpack(bufferState.readings[slotOf(index)], sensorData);
+}
+
+/**
+ * @brief Copies every buffered reading, oldest first.
+ * @param readings Array of at least READING_BUFFER_CAPACITY readings.
+ * @param epoch Set to the wake clock the reading deltas count from.
+ * @return The number of readings copied.
+ */
+size_t ReadingBuffer::copy(PackedReading *readings, uint32_t &epoch) {
+  for (size_t i = 0; i < bufferState.count; i++) {
+    readings[i] = bufferState.readings[slotOf(i)];
+  }
+  epoch = bufferState.epoch;
+  return bufferState.count;
+}
+
+/**
+ * @brief Empties the buffer once its readings have been uploaded.
+ */
+void ReadingBuffer::clear() {
+  bufferState.head = 0;
+  bufferState.count = 0;
+  dirty = true;
+}
@@ -0,0 +1,90 @@
+#include "reading_record.h"
+#include "battery_monitor.h"
+#include "environment_math.h"
+
+/**
+ * @brief Clamps a value to a record range and quantizes it.
+ * @param value The value, not NaN.
+ * @param min The lowest value the field holds.
+ * @param max The highest value the field holds.
+ * @param scale The fixed-point units per unit of the value.
+ * @return The fixed-point value.
+ */
+long ReadingRecord::clamp(float value, double min, double max, long scale) {
+  if (value < min)
+    return quantize(min, scale);
+  if (value > max)
+    return quantize(max, scale);
+  // Same rounding as quantize(), in single precision
+  return (long)(value * scale + (value < 0 ? -0.5f : 0.5f));
+}
+
+/**
+ * @brief Packs a reading into a record.
+ * @param sensorData The reading.
+ * @param delta Its time, in s after the epoch of the records it joins.
+ * @return The record.
+ */
+PackedReading ReadingRecord::pack(const SensorData &sensorData,
+                                  uint16_t delta) {
+  PackedReading reading = {};
+  reading.version = READING_RECORD_VERSION;
+  reading.delta = delta;
+
+  if (isnan(sensorData.temperature))
+    reading.flags |= RECORD_NAN_TEMPERATURE;
+  else
+    reading.temperature =
+        clamp(sensorData.temperature, RECORD_MIN_CELSIUS, RECORD_MAX_CELSIUS,
+              RECORD_TEMPERATURE_SCALE);
+  if (isnan(sensorData.humidity))
+    reading.flags |= RECORD_NAN_HUMIDITY;
+  else
+    reading.humidity = clamp(sensorData.humidity, 0, RECORD_MAX_PERCENT,
+                             RECORD_HUMIDITY_SCALE);
+  if (isnan(sensorData.moisture))
+    reading.flags |= RECORD_NAN_MOISTURE;
+  else
+    reading.moisture = clamp(sensorData.moisture, 0, RECORD_MAX_PERCENT,
+                             RECORD_MOISTURE_SCALE);
+  if (isnan(sensorData.batteryVoltage))
+    reading.flags |= RECORD_NAN_VOLTAGE;
+  else
+    reading.batteryVoltage = clamp(sensorData.batteryVoltage, 0,
+                                   RECORD_MAX_VOLTS, RECORD_VOLTAGE_SCALE);
+  return reading;
+}
+
+/**
+ * @brief Unpacks a record and derives the values it leaves out.
+ * @param reading The record.
+ * @param sensorData Reference to the SensorData struct to populate.
+ * @return False if the record version is unknown, leaving sensorData as is.
+ */
+bool ReadingRecord::unpack(const PackedReading &reading,
+                           SensorData &sensorData) {
+  if (reading.version != READING_RECORD_VERSION)
+    return false;
+  sensorData.temperature = reading.flags & RECORD_NAN_TEMPERATURE
+                               ? NAN
+                               : (float)reading.temperature /
+                                     RECORD_TEMPERATURE_SCALE;
+  sensorData.humidity = reading.flags & RECORD_NAN_HUMIDITY
+                            ? NAN
+                            : (float)reading.humidity / RECORD_HUMIDITY_SCALE;
+  sensorData.moisture = reading.flags & RECORD_NAN_MOISTURE
+                            ? NAN
+                            : (float)reading.moisture / RECORD_MOISTURE_SCALE;
+  sensorData.batteryVoltage =
+      reading.flags & RECORD_NAN_VOLTAGE
+          ? NAN
+          : (float)reading.batteryVoltage / RECORD_VOLTAGE_SCALE;
+
+  sensorData.hic =
+      EnvironmentMath::heatIndex(sensorData.temperature, sensorData.humidity);
+  sensorData.dewPoint =
+      EnvironmentMath::dewPoint(sensorData.temperature, sensorData.humidity);
+  sensorData.batteryPercentage =
+      BatteryMonitor::calculateBatteryPercentage(sensorData.batteryVoltage);
+  return true;
+}
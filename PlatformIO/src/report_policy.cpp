@@ -0,0 +1,161 @@
+#include "report_policy.h"
+#include "configuration.h"
+#include "logger.h"
+#include "phase_profiler.h"
+#include <Preferences.h>
+
+#define REPORT_POLICY_MAGIC 0x53545250 // "STRP"
+
+Preferences reportPreferences;
+RTC_DATA_ATTR ReportState reportState;
+bool ReportPolicy::dirty = false;
+
+/**
+ * @brief Checks that a restored policy state is intact.
+ * @param state The state to check.
+ * @return True if the state can be used, false otherwise.
+ */
+bool ReportPolicy::isValid(const ReportState &state) {
+  return state.magic == REPORT_POLICY_MAGIC;
+}
+
+/**
+ * @brief Restores the policy state, from NVS unless it is only kept in RTC
+ * memory, and advances the wake clock by one wake period.
+ */
+void ReportPolicy::begin() {
+  if (!isValid(reportState)) {
+    ReportState stored;
+    size_t length = 0;
+    if (!POWER_RETAINS_RTC) {
+      PhaseTimer timer(PHASE_NVS);
+      reportPreferences.begin("stacy", true);
+      length =
+          reportPreferences.getBytes("report", &stored, sizeof(ReportState));
+      reportPreferences.end();
+    }
+
+    if (length == sizeof(ReportState) && isValid(stored)) {
+      reportState = stored;
+    } else {
+      memset(&reportState, 0, sizeof(ReportState));
+      reportState.magic = REPORT_POLICY_MAGIC;
+      reportState.batteryPercentage = 100;
+      LOG_DEBUG("Report policy initialized.");
+    }
+  }
+  reportState.clock += TIME_TO_SLEEP;
+}
+
+/**
+ * @brief Writes the policy state to NVS if it changed during this wake, so
+ * it survives a TPL5110 power cut. Deep sleep keeps it in RTC memory
+ * instead. Call before power is cut.
+ */
+void ReportPolicy::commit() {
+  if (POWER_RETAINS_RTC || !dirty)
+    return;
+  dirty = false;
+  PhaseTimer timer(PHASE_NVS);
+  reportPreferences.begin("stacy", false);
+  reportPreferences.putBytes("report", &reportState, sizeof(ReportState));
+  reportPreferences.end();
+}
+
+/**
+ * @brief Gets the wake clock.
+ * @return Seconds since the device was provisioned.
+ */
+uint32_t ReportPolicy::now() { return reportState.clock; }
+
+/**
+ * @brief Gets how many wakes make one sampling interval. The TPL5110 period
+ * is fixed by a resistor, so the interval is stretched by skipping wakes,
+ * and deep sleep keeps the same period.
+ * @return 1 normally, more when the battery is low.
+ */
+uint8_t ReportPolicy::wakeStride() {
+  if (reportState.batteryPercentage < REPORT_CRITICAL_BATTERY)
+    return REPORT_CRITICAL_BATTERY_STRIDE;
+  if (reportState.batteryPercentage < REPORT_LOW_BATTERY)
+    return REPORT_LOW_BATTERY_STRIDE;
+  return 1;
+}
+
+/**
+ * @brief Tells whether this wake should sample the sensors.
+ * @return False if the wake should be skipped to save battery.
+ */
+bool ReportPolicy::isSampleDue() {
+  return reportState.wakesSinceSample + 1 >= wakeStride();
+}
+
+/**
+ * @brief Gets the battery level of the last sample, the best estimate of
+ * this wake's until the battery is read.
+ * @return The battery percentage, 100 before the first sample.
+ */
+float ReportPolicy::batteryEstimate() { return reportState.batteryPercentage; }
+
+/**
+ * @brief Tells whether the maximum silence has elapsed since the last
+ * reported reading.
+ * @return True if the next reading must be reported even if unchanged.
+ */
+bool ReportPolicy::isHeartbeatDue() {
+  return !reportState.hasReport ||
+         reportState.clock - reportState.lastReportTime >= REPORT_HEARTBEAT_S;
+}
+
+/**
+ * @brief Compares a reading, and the extremes since the previous wake when
+ * the sensor kept them, with the last reported one.
+ * @param sensorData The new reading.
+ * @return True if a value moved past its deadband or the heartbeat is due.
+ */
+bool ReportPolicy::shouldReport(const SensorData &sensorData) {
+  if (isHeartbeatDue())
+    return true;
+  if (sensorData.hasHistory &&
+      (fabsf(sensorData.temperatureMin - reportState.temperature) >=
+           REPORT_DEADBAND_TEMPERATURE ||
+       fabsf(sensorData.temperatureMax - reportState.temperature) >=
+           REPORT_DEADBAND_TEMPERATURE ||
+       fabsf(sensorData.humidityMin - reportState.humidity) >=
+           REPORT_DEADBAND_HUMIDITY ||
+       fabsf(sensorData.humidityMax - reportState.humidity) >=
+           REPORT_DEADBAND_HUMIDITY))
+    return true;
+  return fabsf(sensorData.temperature - reportState.temperature) >=
+             REPORT_DEADBAND_TEMPERATURE ||
+         fabsf(sensorData.humidity - reportState.humidity) >=
+             REPORT_DEADBAND_HUMIDITY ||
+         fabsf(sensorData.moisture - reportState.moisture) >=
+             REPORT_DEADBAND_MOISTURE;
+}
+
+/**
+ * @brief Records a sampled wake.
+ * @param sensorData The reading of this wake.
+ * @param reported Whether the reading was buffered for upload.
+ */
+void ReportPolicy::sampled(const SensorData &sensorData, bool reported) {
+  reportState.wakesSinceSample = 0;
+  reportState.batteryPercentage = sensorData.batteryPercentage;
+  if (reported) {
+    reportState.hasReport = true;
+    reportState.lastReportTime = reportState.clock;
+    reportState.temperature = sensorData.temperature;
+    reportState.humidity = sensorData.humidity;
+    reportState.moisture = sensorData.moisture;
+  }
+  dirty = true;
+}
+
+/**
+ * @brief Records a wake skipped without sampling.
+ */
+void ReportPolicy::skipWake() {
+  reportState.wakesSinceSample++;
+  dirty = true;
+}
@@ -1,57 +1,25 @@
 #include "sensor_handler.h"
-#include "debug.h"
-#include <Adafruit_Sensor.h>
-#include <EnvironmentCalculations.h>
-#include <Wire.h>
-
-Adafruit_HDC302x SensorHandler::hdc3022;
-
-/**
- * @brief Initializes the HDC3022 sensor.
- * @return True if the sensor is initialized successfully, false otherwise.
- */
-bool SensorHandler::initHDC() {
-  if (!SensorHandler::hdc3022.begin(HDC3022_ADDR)) {
-    DEBUG("HDC3022 sensor initialization failed");
-    return false;
-  }
-  return true;
-}
-
-/**
- * @brief Reads the HDC3022 sensor data and populates the SensorData struct.
- * @param sensorData Reference to the SensorData struct to populate.
- */
-void SensorHandler::readHDC(SensorData &sensorData) {
-  DEBUGLN("Reading HDC3022 sensor...");
-
-  if (!SensorHandler::hdc3022.readTemperatureHumidityOnDemand(
-          sensorData.temperature, sensorData.humidity, TRIGGERMODE_LP0)) {
-    DEBUGLN("Failed to read temperature and humidity from HDC3022 sensor.");
-    return;
-  }
-}
-
-/**
- * @brief Reads the moisture from the sensor.
- * @return The moisture value as a float.
- */
-float SensorHandler::getMoisture() {
-  uint16_t sensorValue = analogRead(CAPACITANCE_PIN);
-  float moisture = map(sensorValue, AIR_VALUE, WATER_VALUE, 0.0, 100.0);
-
-  return moisture;
-}
+#include "battery_monitor.h"
+#include "environment_math.h"
+#include "phase_profiler.h"
 
 /**
- * @brief Reads all sensor data and populates the SensorData struct.
- * @param sensorData Reference to the SensorData struct to populate.
+ * @brief Reads all sensors of the build and the battery, and derives the dew
+ * point and heat index from the temperature and humidity. The battery is
+ * read while the sensor conversions run.
+ * @param sensorData Reference to the SensorData struct to populate, with an
+ * estimate of the battery level, which the HDC3022 mode depends on.
+ * @return True if every sensor was read.
  */
-void SensorHandler::readSensorData(SensorData &sensorData) {
-  readHDC(sensorData);
-  sensorData.moisture = getMoisture();
-  sensorData.dewPoint = EnvironmentCalculations::DewPoint(
-      sensorData.temperature, sensorData.humidity, ENV_TEMP_UNIT);
-  sensorData.hic = EnvironmentCalculations::HeatIndex(
-      sensorData.temperature, sensorData.humidity, ENV_TEMP_UNIT);
+bool SensorHandler::readSensorData(SensorData &sensorData) {
+  PhaseTimer timer(PHASE_SENSOR);
+  uint32_t started = Sensors::start(sensorData);
+  BatteryMonitor::getBatteryStatus(sensorData);
+  I2cScheduler::waitForConversions();
+  bool sampled = Sensors::collect(sensorData, started);
+  sensorData.dewPoint =
+      EnvironmentMath::dewPoint(sensorData.temperature, sensorData.humidity);
+  sensorData.hic =
+      EnvironmentMath::heatIndex(sensorData.temperature, sensorData.humidity);
+  return sampled;
 }
@@ -0,0 +1,94 @@
+#include "series_encoder.h"
+
+/**
+ * @brief Creates an encoder on top of a fixed buffer.
+ * @param buffer The destination buffer.
+ * @param capacity The size of the destination buffer.
+ * @param mode How values are coded against the previous reading.
+ */
+SeriesEncoder::SeriesEncoder(uint8_t *buffer, size_t capacity,
+                             SeriesMode mode)
+    : buffer(buffer), capacity(capacity), length(0), mode(mode), version(0),
+      started(false), overflow(false), previousFlags(0), previous(),
+      previousTime(0), previousStep(0) {}
+
+/**
+ * @brief Maps a signed value to an unsigned one, small magnitudes to small
+ * values: 0, -1, 1, -2 become 0, 1, 2, 3.
+ * @param value The signed value.
+ * @return The zigzag value.
+ */
+uint32_t SeriesEncoder::zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @brief Appends an unsigned LEB128 varint, flagging an overflow when the
+ * buffer is full.
+ * @param value The value to append.
+ */
+void SeriesEncoder::writeVarint(uint32_t value) {
+  do {
+    if (length >= capacity) {
+      overflow = true;
+      return;
+    }
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    buffer[length++] = value ? byte | 0x80 : byte;
+  } while (value);
+}
+
+/**
+ * @brief Appends a reading to the series.
+ * @param reading The reading, no older than the previous one for the best
+ * compression, though any order is coded.
+ * @return False if the reading did not fit the buffer or has another
+ * record version than the series, in which case the series is unusable.
+ */
+bool SeriesEncoder::add(const PackedReading &reading) {
+  if (!started) {
+    version = reading.version;
+    started = true;
+    writeVarint(version);
+  } else if (reading.version != version) {
+    overflow = true;
+  }
+  if (overflow)
+    return false;
+
+  // The flags rarely change, so they cost a bit unless they do
+  int32_t step = (int32_t)reading.delta - previousTime;
+  bool flagsChanged = reading.flags != previousFlags;
+  writeVarint(zigzag(step - previousStep) << 1 | flagsChanged);
+  if (flagsChanged)
+    writeVarint(reading.flags);
+  previousFlags = reading.flags;
+  previousTime = reading.delta;
+  previousStep = step;
+
+  const uint16_t values[SERIES_VALUES] = {
+      (uint16_t)reading.temperature, reading.humidity, reading.moisture,
+      reading.batteryVoltage};
+  for (int i = 0; i < SERIES_VALUES; i++) {
+    if (mode == SERIES_XOR) {
+      writeVarint(values[i] ^ previous[i]);
+    } else {
+      writeVarint(zigzag((int16_t)(uint16_t)(values[i] - previous[i])));
+    }
+    previous[i] = values[i];
+  }
+  return !overflow;
+}
+
+/**
+ * @brief Gets the length of the series.
+ * @return The number of bytes written.
+ */
+size_t SeriesEncoder::size() const { return length; }
+
+/**
+ * @brief Tells whether a reading was dropped.
+ * @return True if the buffer overflowed or a record version differed.
+ */
+bool SeriesEncoder::overflowed() const { return overflow; }
@@ -0,0 +1,134 @@
+#include "telemetry_encoder.h"
+#include "configuration.h"
+#include "reading_buffer.h"
+
+/**
+ * @brief Writes an unsigned 16-bit integer in little-endian order.
+ * @param buffer The destination buffer.
+ * @param value The value to write.
+ * @return The number of bytes written.
+ */
+size_t TelemetryEncoder::writeUInt16(uint8_t *buffer, uint16_t value) {
+  buffer[0] = value & 0xFF;
+  buffer[1] = (value >> 8) & 0xFF;
+  return 2;
+}
+
+/**
+ * @brief Writes an unsigned 32-bit integer in little-endian order.
+ * @param buffer The destination buffer.
+ * @param value The value to write.
+ * @return The number of bytes written.
+ */
+size_t TelemetryEncoder::writeUInt32(uint8_t *buffer, uint32_t value) {
+  writeUInt16(buffer, value & 0xFFFF);
+  writeUInt16(buffer + 2, value >> 16);
+  return 4;
+}
+
+/**
+ * @brief Writes readings as PackedReading records.
+ * @param readings The readings, oldest first.
+ * @param count The number of readings.
+ * @param buffer The destination buffer, of count records at least.
+ * @return The number of bytes written.
+ */
+size_t TelemetryEncoder::writeRecords(const PackedReading *readings,
+                                      size_t count, uint8_t *buffer) {
+  size_t offset = 0;
+  for (size_t i = 0; i < count; i++) {
+    const PackedReading &reading = readings[i];
+    buffer[offset++] = reading.version;
+    buffer[offset++] = reading.flags;
+    offset += writeUInt16(buffer + offset, reading.temperature);
+    offset += writeUInt16(buffer + offset, reading.humidity);
+    offset += writeUInt16(buffer + offset, reading.moisture);
+    offset += writeUInt16(buffer + offset, reading.batteryVoltage);
+    offset += writeUInt16(buffer + offset, reading.delta);
+  }
+  return offset;
+}
+
+/**
+ * @brief Writes readings as a compressed series, after its SeriesMode.
+ * @param readings The readings, oldest first.
+ * @param count The number of readings.
+ * @param buffer The destination buffer.
+ * @param capacity The size of the destination buffer.
+ * @return The number of bytes written, 0 if the series does not fit.
+ */
+size_t TelemetryEncoder::writeSeries(const PackedReading *readings,
+                                     size_t count, uint8_t *buffer,
+                                     size_t capacity) {
+  buffer[0] = TELEMETRY_SERIES_MODE;
+  SeriesEncoder series(buffer + 1, capacity - 1, TELEMETRY_SERIES_MODE);
+  for (size_t i = 0; i < count; i++) {
+    if (!series.add(readings[i]))
+      return 0;
+  }
+  return 1 + series.size();
+}
+
+/**
+ * @brief Writes a wake profile, or its absence.
+ * @param profile The wake profile, or nullptr.
+ * @param buffer The destination buffer.
+ * @return The number of bytes written.
+ */
+size_t TelemetryEncoder::writeProfile(const WakeProfile *profile,
+                                      uint8_t *buffer) {
+  size_t offset = 0;
+  if (!profile) {
+    buffer[offset++] = 0;
+    return offset;
+  }
+  buffer[offset++] = PHASE_COUNT;
+  offset += writeUInt16(buffer + offset, profile->awake);
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    offset += writeUInt16(buffer + offset, profile->phases[i]);
+  }
+  return offset;
+}
+
+/**
+ * @brief Encodes readings into the binary telemetry format, as a series
+ * when TELEMETRY_SERIES is set.
+ * Writes into the caller's buffer only, no heap allocation is made.
+ * @param readings The readings, oldest first.
+ * @param count The number of readings.
+ * @param epoch The wake clock the reading deltas count from.
+ * @param profile The wake profile to attach, or nullptr.
+ * @param buffer The destination buffer.
+ * @param capacity The size of the destination buffer.
+ * @return The number of bytes written, 0 if the buffer is too small.
+ */
+size_t TelemetryEncoder::encodeReadings(const PackedReading *readings,
+                                        size_t count, uint32_t epoch,
+                                        const WakeProfile *profile,
+                                        uint8_t *buffer, size_t capacity) {
+  // Worst case of a series: its mode, record version and readings
+  size_t readingsSize = TELEMETRY_SERIES
+                            ? 2 + count * SERIES_MAX_READING_SIZE
+                            : count * TELEMETRY_READING_SIZE;
+  size_t profileSize = profile ? TELEMETRY_PROFILE_SIZE : 1;
+  if (count > UINT8_MAX ||
+      capacity < TELEMETRY_HEADER_SIZE + readingsSize + profileSize)
+    return 0;
+
+  size_t offset = 0;
+  buffer[offset++] =
+      TELEMETRY_SERIES ? TELEMETRY_SERIES_VERSION : TELEMETRY_VERSION;
+  buffer[offset++] = count;
+  offset += writeUInt32(buffer + offset, ReadingBuffer::age(epoch));
+
+  if (TELEMETRY_SERIES) {
+    size_t written = writeSeries(readings, count, buffer + offset,
+                                 capacity - offset - profileSize);
+    if (written == 0)
+      return 0;
+    offset += written;
+  } else {
+    offset += writeRecords(readings, count, buffer + offset);
+  }
+  return offset + writeProfile(profile, buffer + offset);
+}
@@ -0,0 +1,125 @@
+// The batched uplink over 1,000 wakes, each in its own process as with the
+// TPL5110, so that the reading buffer only survives through NVS. Every wake
+// takes a reading and sends the buffer as one batch once it is due, as
+// startNormalMode() does; the per-wake uplink it replaced would have sent
+// each reading on its own. Reports the radio sessions and payload bytes of
+// both. Run with
+//   pio test -e native-test -f test_batched_uplink -v
+#include "configuration.h"
+#include "power_manager.h"
+#include "reading_buffer.h"
+#include "reading_record.h"
+#include "report_policy.h"
+#include "telemetry_encoder.h"
+#include <NativeHal.h>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unity.h>
+
+#define TEST_WAKES 1000
+
+// Counted by the wake processes, in memory shared with the test
+typedef struct UplinkTotals {
+  uint32_t sessions;
+  uint32_t readingsSent;
+  uint32_t bytesSent;
+  uint32_t baselineSessions;
+  uint32_t baselineBytes;
+  uint32_t buffered; // left in the buffer after the last wake
+} UplinkTotals;
+
+static UplinkTotals *totals;
+static char directory[] = "/tmp/stacy-test-XXXXXX";
+
+/**
+ * @brief One wake of startNormalMode() without the sensors and the radio:
+ * the reading is buffered, and the buffer encoded as for its POST once due.
+ */
+static void wake() {
+  // 1,000 wakes of log lines, the totals are what the test reports
+  if (!freopen("/dev/null", "w", stdout))
+    return;
+
+  PowerManager::begin();
+  ReportPolicy::begin();
+  ReadingBuffer::begin(ReportPolicy::now());
+
+  double temperature, humidity;
+  NativeHal::conditions(NativeHal::wake(), temperature, humidity);
+  SensorData data;
+  data.temperature = temperature;
+  data.humidity = humidity;
+  data.moisture = 40.0f;
+  data.hic = temperature;
+  data.batteryVoltage = 3.9f;
+  data.batteryPercentage = 80.0f;
+
+  uint8_t payload[TELEMETRY_MAX_SIZE];
+  PackedReading single = ReadingRecord::pack(data, 0);
+  totals->baselineSessions++;
+  totals->baselineBytes += TelemetryEncoder::encodeReadings(
+      &single, 1, ReportPolicy::now(), nullptr, payload, sizeof(payload));
+
+  ReadingBuffer::push(data);
+  ReportPolicy::sampled(data, true);
+  if (ReadingBuffer::shouldFlush()) {
+    PackedReading readings[READING_BUFFER_CAPACITY];
+    uint32_t epoch;
+    size_t count = ReadingBuffer::copy(readings, epoch);
+    totals->sessions++;
+    totals->readingsSent += count;
+    totals->bytesSent += TelemetryEncoder::encodeReadings(
+        readings, count, epoch, nullptr, payload, sizeof(payload));
+    ReadingBuffer::clear();
+  }
+  totals->buffered = ReadingBuffer::count();
+
+  PowerManager::sleep();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_batched_uplink_saves_radio_sessions() {
+  TEST_ASSERT_TRUE(NativeHal::runWakes(TEST_WAKES, wake));
+
+  printf("%d wakes: %u radio sessions and %u payload B batched, against %u "
+         "and %u B sending every wake\n",
+         TEST_WAKES, totals->sessions, totals->bytesSent,
+         totals->baselineSessions, totals->baselineBytes);
+  printf("saved %u radio sessions (%.1f%%) and %u payload B (%.1f%%)\n",
+         totals->baselineSessions - totals->sessions,
+         100.0 * (totals->baselineSessions - totals->sessions) /
+             totals->baselineSessions,
+         totals->baselineBytes - totals->bytesSent,
+         100.0 * (totals->baselineBytes - totals->bytesSent) /
+             totals->baselineBytes);
+
+  // No reading is lost, and one session carries a full buffer
+  TEST_ASSERT_EQUAL_UINT32(TEST_WAKES, totals->readingsSent + totals->buffered);
+  TEST_ASSERT_EQUAL_UINT32(TEST_WAKES, totals->baselineSessions);
+  TEST_ASSERT_EQUAL_UINT32(TEST_WAKES / READING_BUFFER_FLUSH_COUNT,
+                           totals->sessions);
+  TEST_ASSERT_LESS_THAN_UINT32(totals->baselineBytes, totals->bytesSent);
+}
+
+int main() {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  if (!mkdtemp(directory))
+    return 1;
+  setenv("STACY_NVS_DIR", directory, 1);
+  totals = (UplinkTotals *)mmap(nullptr, sizeof(UplinkTotals),
+                                PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (totals == MAP_FAILED)
+    return 1;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_batched_uplink_saves_radio_sessions);
+  int failures = UNITY_END();
+  std::filesystem::remove_all(directory);
+  return failures;
+}
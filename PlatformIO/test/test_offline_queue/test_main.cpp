@@ -0,0 +1,233 @@
+// OfflineQueue recovery from a power loss in the middle of an append,
+// against the file-backed LittleFS of NativeHAL: STACY_FS_CUT_WAKE and
+// STACY_FS_CUT_BYTES end a wake that many bytes into its flash writes. Each
+// wake runs in its own process and appends TEST_READINGS readings, then a
+// last wake replays the queue. The intact records must come back in order,
+// the torn one must be skipped, and the queued count must match them once
+// the filesystem is scanned, also after the oldest segment was evicted.
+// STACY_FS_FAIL_WAKE and STACY_FS_FAIL_BYTES fail a write instead, without
+// the power loss: the append must then leave none of its readings queued.
+// Run with
+//   pio test -e native-test -f test_offline_queue -v
+#include "configuration.h"
+#include "offline_queue.h"
+#include "reading_record.h"
+#include <NativeHal.h>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unity.h>
+
+#define TEST_READINGS 4
+#define TEST_MAX_REPLAYED 80
+
+// Counted by the replay wake, in memory shared with the test
+typedef struct ReplayResults {
+  uint32_t queuedBefore;   // from NVS, before the filesystem is mounted
+  uint32_t queuedScanned;  // once the segments have been scanned
+  uint32_t queuedAfter;    // after the replay
+  uint32_t replayed;
+  uint32_t failedAppends;
+  int16_t temperatures[TEST_MAX_REPLAYED]; // centi-°C, tagging each reading
+} ReplayResults;
+
+static ReplayResults *results;
+static long replayWake;
+static int appendSize;      // readings per append
+static uint32_t epochStep; // wake clock between appends
+static char directory[32];
+
+/**
+ * @brief The temperature tagging a reading, in centi-°C.
+ * @param wake The wake that appended it.
+ * @param index Its index in the append.
+ */
+static int16_t tag(long wake, int index) { return wake * 100 + index * 10; }
+
+/**
+ * @brief Appends the readings of a wake, or replays the queue in the last.
+ */
+static void wake() {
+  if (!freopen("/dev/null", "w", stdout))
+    return;
+  long index = NativeHal::wake();
+  PackedReading readings[READING_BUFFER_CAPACITY];
+  uint32_t epoch = index * epochStep;
+
+  if (index < replayWake) {
+    for (int i = 0; i < appendSize; i++) {
+      SensorData sensorData;
+      sensorData.temperature = tag(index, i) / 100.0f;
+      sensorData.humidity = 50.0f;
+      sensorData.moisture = 40.0f;
+      sensorData.batteryVoltage = 3.9f;
+      readings[i] = ReadingRecord::pack(sensorData, i * TIME_TO_SLEEP);
+    }
+    if (!OfflineQueue::append(readings, appendSize, epoch))
+      results->failedAppends++;
+    NativeHal::powerOff();
+  }
+
+  results->queuedBefore = OfflineQueue::count();
+  for (int batch = 0; batch < TEST_MAX_REPLAYED; batch++) {
+    size_t count =
+        OfflineQueue::read(readings, READING_BUFFER_CAPACITY, epoch);
+    if (batch == 0)
+      results->queuedScanned = OfflineQueue::count();
+    for (size_t i = 0; i < count && results->replayed < TEST_MAX_REPLAYED;
+         i++) {
+      results->temperatures[results->replayed++] = readings[i].temperature;
+    }
+    OfflineQueue::commit();
+    if (OfflineQueue::count() == 0)
+      break;
+  }
+  results->queuedAfter = OfflineQueue::count();
+  NativeHal::powerOff();
+}
+
+/**
+ * @brief Runs the append wakes, with the power cut in one of them, then the
+ * replay wake.
+ * @param appends The number of append wakes.
+ * @param cutWake The wake whose flash writes are cut.
+ * @param cutBytes The bytes written before the cut.
+ */
+static void run(long appends, long cutWake, long cutBytes) {
+  char value[16];
+  snprintf(value, sizeof(value), "%ld", cutWake);
+  setenv("STACY_FS_CUT_WAKE", value, 1);
+  snprintf(value, sizeof(value), "%ld", cutBytes);
+  setenv("STACY_FS_CUT_BYTES", value, 1);
+  replayWake = appends;
+  TEST_ASSERT_TRUE(NativeHal::runWakes(appends + 1, wake));
+}
+
+/**
+ * @brief Makes a write of one wake fail, without cutting the power.
+ * @param failWake The wake whose write fails.
+ * @param failBytes The bytes written before the failure.
+ */
+static void failWrite(long failWake, long failBytes) {
+  char value[16];
+  snprintf(value, sizeof(value), "%ld", failWake);
+  setenv("STACY_FS_FAIL_WAKE", value, 1);
+  snprintf(value, sizeof(value), "%ld", failBytes);
+  setenv("STACY_FS_FAIL_BYTES", value, 1);
+}
+
+/**
+ * @brief Checks that the replay returned the readings of the append wakes,
+ * but for those missing from the wake whose writes were cut.
+ * @param appends The number of append wakes.
+ * @param cutWake The wake whose writes were cut.
+ * @param kept How many of its readings are intact.
+ */
+static void assertReplayed(long appends, long cutWake, int kept) {
+  uint32_t expected = 0;
+  for (long wake = 0; wake < appends; wake++) {
+    int intact = wake == cutWake ? kept : TEST_READINGS;
+    for (int i = 0; i < intact; i++) {
+      TEST_ASSERT_TRUE(expected < results->replayed);
+      TEST_ASSERT_EQUAL(tag(wake, i), results->temperatures[expected++]);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(expected, results->replayed);
+  TEST_ASSERT_EQUAL_UINT32(expected, results->queuedScanned);
+  TEST_ASSERT_EQUAL_UINT32(0, results->queuedAfter);
+}
+
+void setUp() {
+  memset(results, 0, sizeof(ReplayResults));
+  appendSize = TEST_READINGS;
+  epochStep = TEST_READINGS * TIME_TO_SLEEP;
+  snprintf(directory, sizeof(directory), "/tmp/stacy-test-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+  setenv("STACY_NVS_DIR", directory, 1);
+}
+
+void tearDown() {
+  unsetenv("STACY_FS_CUT_WAKE");
+  unsetenv("STACY_FS_CUT_BYTES");
+  unsetenv("STACY_FS_FAIL_WAKE");
+  unsetenv("STACY_FS_FAIL_BYTES");
+  std::filesystem::remove_all(directory);
+}
+
+// Power lost within the third record of the second append: two records of
+// it survive, and the next append starts a fresh segment
+void test_torn_record_is_skipped() {
+  run(3, 1, 2 * sizeof(QueuedRecord) + 5);
+  assertReplayed(3, 1, 2);
+}
+
+// Power lost in the last append, before anything rescans the queue: NVS
+// only counts the appends that completed, the scan adds the intact record
+void test_count_recovers_from_the_segments() {
+  run(2, 1, sizeof(QueuedRecord) + 3);
+  TEST_ASSERT_EQUAL_UINT32(TEST_READINGS, results->queuedBefore);
+  assertReplayed(2, 1, 1);
+}
+
+// Power lost within the header of the first segment: the segment holds no
+// record and is passed over
+void test_torn_segment_header_is_skipped() {
+  run(3, 0, sizeof(SegmentHeader) / 2);
+  assertReplayed(3, 0, 0);
+}
+
+// One reading per append, each too far from the last for a delta, so that
+// every segment holds a single record: evicting the oldest segment drops
+// that record only, not a full segment's worth of the count
+void test_partial_segment_is_evicted() {
+  appendSize = 1;
+  epochStep = UINT16_MAX + 1;
+  run(OFFLINE_QUEUE_MAX_SEGMENTS + 1, -1, 0);
+  TEST_ASSERT_EQUAL_UINT32(OFFLINE_QUEUE_MAX_SEGMENTS, results->queuedBefore);
+  TEST_ASSERT_EQUAL_UINT32(OFFLINE_QUEUE_MAX_SEGMENTS, results->replayed);
+  for (uint32_t i = 0; i < results->replayed; i++) {
+    TEST_ASSERT_EQUAL(tag(i + 1, 0), results->temperatures[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, results->queuedAfter);
+}
+
+// A write failing within the third record of the second append, which
+// extends the first segment: the segment is cut back to the first append,
+// which the third one then extends
+void test_failed_append_queues_nothing() {
+  failWrite(1, 2 * sizeof(QueuedRecord) + 5);
+  run(3, -1, 0);
+  TEST_ASSERT_EQUAL_UINT32(1, results->failedAppends);
+  TEST_ASSERT_EQUAL_UINT32(2 * TEST_READINGS, results->queuedBefore);
+  assertReplayed(3, 1, 0);
+}
+
+// A write failing within the second record of the first append: the
+// segment it started is deleted
+void test_failed_first_append_queues_nothing() {
+  failWrite(0, sizeof(SegmentHeader) + sizeof(QueuedRecord) + 3);
+  run(3, -1, 0);
+  TEST_ASSERT_EQUAL_UINT32(1, results->failedAppends);
+  TEST_ASSERT_EQUAL_UINT32(2 * TEST_READINGS, results->queuedBefore);
+  assertReplayed(3, 0, 0);
+}
+
+int main() {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  results = (ReplayResults *)mmap(nullptr, sizeof(ReplayResults),
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (results == MAP_FAILED)
+    return 1;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_torn_record_is_skipped);
+  RUN_TEST(test_count_recovers_from_the_segments);
+  RUN_TEST(test_torn_segment_header_is_skipped);
+  RUN_TEST(test_partial_segment_is_evicted);
+  RUN_TEST(test_failed_append_queues_nothing);
+  RUN_TEST(test_failed_first_append_queues_nothing);
+  return UNITY_END();
+}
@@ -0,0 +1,257 @@
+// TelemetryEncoder: every field of a batch decodes back from the bytes on
+// the wire, the way the backend reads them, and an undersized buffer is
+// refused. Then the size and host encode time of a batch against the JSON
+// array sendReadings() writes otherwise. Run with
+//   pio test -e native-test -f test_telemetry_encoder -v
+#include "configuration.h"
+#include "json_writer.h"
+#include "reading_record.h"
+#include "telemetry_encoder.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+#define TEST_LOOPS 2000
+#define TEST_JSON_READING_SIZE 160 // JSON_READING_SIZE of network_handler
+
+static PackedReading batch[READING_BUFFER_CAPACITY];
+static uint8_t payload[TELEMETRY_MAX_SIZE];
+static char json[TEST_JSON_READING_SIZE * READING_BUFFER_CAPACITY];
+
+/**
+ * @brief Cursor over a payload, reading it the way the backend does.
+ */
+struct PayloadReader {
+  const uint8_t *cursor;
+
+  uint8_t u8() { return *cursor++; }
+
+  uint16_t u16() {
+    uint16_t value = cursor[0] | cursor[1] << 8;
+    cursor += 2;
+    return value;
+  }
+
+  uint32_t u32() {
+    uint32_t low = u16();
+    return low | (uint32_t)u16() << 16;
+  }
+
+  uint32_t varint() {
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      uint8_t byte = *cursor++;
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return value;
+    }
+  }
+
+  static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+  }
+};
+
+/**
+ * @brief Decodes the readings of a payload, as records (version 3) or as a
+ * series (version 4).
+ * @return The number of readings decoded, 0 if the version is unknown.
+ */
+static size_t decodeReadings(PayloadReader &reader, PackedReading *readings,
+                             uint32_t &epochAge) {
+  uint8_t version = reader.u8();
+  size_t count = reader.u8();
+  epochAge = reader.u32();
+
+  if (version == TELEMETRY_VERSION) {
+    for (size_t i = 0; i < count; i++) {
+      PackedReading &reading = readings[i];
+      reading.version = reader.u8();
+      reading.flags = reader.u8();
+      reading.temperature = reader.u16();
+      reading.humidity = reader.u16();
+      reading.moisture = reader.u16();
+      reading.batteryVoltage = reader.u16();
+      reading.delta = reader.u16();
+    }
+    return count;
+  }
+  if (version != TELEMETRY_SERIES_VERSION)
+    return 0;
+
+  SeriesMode mode = (SeriesMode)reader.u8();
+  uint8_t recordVersion = reader.varint();
+  uint16_t values[SERIES_VALUES] = {};
+  uint8_t flags = 0;
+  int32_t time = 0;
+  int32_t step = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t timing = reader.varint();
+    if (timing & 1)
+      flags = reader.varint();
+    step += PayloadReader::unzigzag(timing >> 1);
+    time += step;
+    for (int j = 0; j < SERIES_VALUES; j++) {
+      uint32_t coded = reader.varint();
+      values[j] = mode == SERIES_XOR
+                      ? values[j] ^ coded
+                      : values[j] + PayloadReader::unzigzag(coded);
+    }
+    PackedReading &reading = readings[i];
+    reading.version = recordVersion;
+    reading.flags = flags;
+    reading.temperature = values[0];
+    reading.humidity = values[1];
+    reading.moisture = values[2];
+    reading.batteryVoltage = values[3];
+    reading.delta = time;
+  }
+  return count;
+}
+
+/**
+ * @brief Fills the batch with a day-like series, one reading every wake,
+ * and a reading with unset values in the middle.
+ */
+static void fillBatch() {
+  for (size_t i = 0; i < READING_BUFFER_CAPACITY; i++) {
+    SensorData sensorData;
+    sensorData.temperature = 21.5f + 2.0f * sinf(i * 0.3f);
+    sensorData.humidity = 48.0f - 5.0f * sinf(i * 0.3f);
+    sensorData.moisture = 37.5f + (i % 3) * 0.1f;
+    sensorData.batteryVoltage = 3.91f - i * 0.001f;
+    if (i == READING_BUFFER_CAPACITY / 2) {
+      sensorData.temperature = NAN;
+      sensorData.moisture = NAN;
+    }
+    batch[i] = ReadingRecord::pack(sensorData, i * TIME_TO_SLEEP);
+  }
+}
+
+/**
+ * @brief Writes the batch as the JSON array of sendReadings().
+ * @return The size of the array, 0 if it overflowed.
+ */
+static size_t writeJson(size_t count) {
+  JsonWriter writer(json, sizeof(json));
+  writer.beginArray();
+  for (size_t i = 0; i < count; i++) {
+    SensorData sensorData;
+    ReadingRecord::unpack(batch[i], sensorData);
+    writer.beginObject();
+    writer.add("temperature", sensorData.temperature);
+    writer.add("humidity", sensorData.humidity);
+    writer.add("moisture", sensorData.moisture);
+    writer.add("hic", sensorData.hic);
+    writer.add("batteryPercentage", sensorData.batteryPercentage);
+    writer.add("batteryVoltage", sensorData.batteryVoltage);
+    uint32_t age = (count - 1 - i) * TIME_TO_SLEEP;
+    if (age > 0)
+      writer.add("age", age);
+    writer.endObject();
+  }
+  writer.endArray();
+  return writer.overflowed() ? 0 : writer.size();
+}
+
+/**
+ * @brief Times an encoder over TEST_LOOPS runs.
+ * @return The mean time of a run, in host ns.
+ */
+template <typename Encode> static double timeEncoding(Encode encode) {
+  auto start = std::chrono::steady_clock::now();
+  volatile size_t sink = 0;
+  for (int loop = 0; loop < TEST_LOOPS; loop++) {
+    sink = sink + encode();
+  }
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         TEST_LOOPS;
+}
+
+void setUp() { fillBatch(); }
+
+void tearDown() {}
+
+void test_round_trip() {
+  WakeProfile profile = {};
+  profile.awake = 523;
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    profile.phases[i] = 10 * i + 7;
+  }
+
+  size_t length = TelemetryEncoder::encodeReadings(
+      batch, READING_BUFFER_CAPACITY, 0, &profile, payload, sizeof(payload));
+  TEST_ASSERT_GREATER_THAN(0, length);
+
+  PackedReading decoded[READING_BUFFER_CAPACITY];
+  uint32_t epochAge;
+  PayloadReader reader = {payload};
+  TEST_ASSERT_EQUAL(READING_BUFFER_CAPACITY,
+                    decodeReadings(reader, decoded, epochAge));
+  TEST_ASSERT_EQUAL_UINT32(0, epochAge);
+  TEST_ASSERT_EQUAL_MEMORY(batch, decoded, sizeof(batch));
+
+  TEST_ASSERT_EQUAL_UINT8(PHASE_COUNT, reader.u8());
+  TEST_ASSERT_EQUAL(profile.awake, reader.u16());
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    TEST_ASSERT_EQUAL(profile.phases[i], reader.u16());
+  }
+  TEST_ASSERT_TRUE(reader.cursor == payload + length);
+}
+
+void test_round_trip_without_profile() {
+  size_t length = TelemetryEncoder::encodeReadings(batch, 1, 0, nullptr,
+                                                   payload, sizeof(payload));
+  PackedReading decoded;
+  uint32_t epochAge;
+  PayloadReader reader = {payload};
+  TEST_ASSERT_EQUAL(1, decodeReadings(reader, &decoded, epochAge));
+  TEST_ASSERT_EQUAL_MEMORY(batch, &decoded, sizeof(PackedReading));
+  TEST_ASSERT_EQUAL_UINT8(0, reader.u8());
+  TEST_ASSERT_TRUE(reader.cursor == payload + length);
+}
+
+void test_undersized_buffer_is_refused() {
+  size_t length = TelemetryEncoder::encodeReadings(
+      batch, READING_BUFFER_CAPACITY, 0, nullptr, payload, sizeof(payload));
+  TEST_ASSERT_GREATER_THAN(0, length);
+  TEST_ASSERT_EQUAL(0, TelemetryEncoder::encodeReadings(
+                           batch, READING_BUFFER_CAPACITY, 0, nullptr,
+                           payload, TELEMETRY_HEADER_SIZE + 1));
+}
+
+void test_binary_against_json() {
+  const size_t counts[] = {1, READING_BUFFER_FLUSH_COUNT,
+                           READING_BUFFER_CAPACITY};
+  printf("%-9s %10s %10s %14s %14s\n", "readings", "binary B", "JSON B",
+         "binary ns", "JSON ns");
+  for (size_t count : counts) {
+    size_t binarySize = TelemetryEncoder::encodeReadings(
+        batch, count, 0, nullptr, payload, sizeof(payload));
+    size_t jsonSize = writeJson(count);
+    TEST_ASSERT_GREATER_THAN(0, binarySize);
+    TEST_ASSERT_GREATER_THAN(0, jsonSize);
+    TEST_ASSERT_LESS_THAN(jsonSize, binarySize);
+
+    double binaryTime = timeEncoding([count] {
+      return TelemetryEncoder::encodeReadings(batch, count, 0, nullptr,
+                                              payload, sizeof(payload));
+    });
+    double jsonTime = timeEncoding([count] { return writeJson(count); });
+    printf("%-9zu %10zu %10zu %14.0f %14.0f\n", count, binarySize, jsonSize,
+           binaryTime, jsonTime);
+  }
+}
+
+int main() {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_round_trip_without_profile);
+  RUN_TEST(test_undersized_buffer_is_refused);
+  RUN_TEST(test_binary_against_json);
+  return UNITY_END();
+}
@@ -0,0 +1,226 @@
+// The firmware end to end on the host: setup() and loop() run as TPL5110
+// wakes, each in its own process, against a stub of the backend that this
+// test serves on the address of SERVER_URL. The replayed temperature moves
+// past its deadband on every wake, so every reading is reported. Every wake
+// must power off, and the buffered readings must reach /weather as one
+// batch. Run with
+//   pio test -e native-test -f test_wake_cycle -v
+// SERVER_URL in credentials.h must be a local address such as
+// http://127.0.0.1:18080, the test is ignored otherwise.
+#include "configuration.h"
+#include "credentials.h"
+#include <NativeHal.h>
+#include <arpa/inet.h>
+#include <filesystem>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unity.h>
+
+#define TEST_WAKES (READING_BUFFER_FLUSH_COUNT + 1)
+#define TEST_REQUEST_SIZE 8192
+
+// Counted by the stub, in memory shared with the test
+typedef struct StubCounts {
+  uint32_t weatherPosts;
+  uint32_t readingsPosted;
+  uint32_t otherRequests;
+} StubCounts;
+
+static StubCounts *counts;
+static char directory[] = "/tmp/stacy-test-XXXXXX";
+static int listener = -1;
+static pid_t stub = -1;
+
+void setup();
+void loop();
+
+/**
+ * @brief Reads one request off a connection.
+ * @param request Receives the request line, the headers and the body.
+ * @param body Set to the start of the body in request.
+ * @param length Set to the length of the body.
+ * @return False once the firmware closed the connection.
+ */
+static bool readRequest(int connection, char *request, char *&body,
+                        size_t &length) {
+  size_t size = 0;
+  char *end = nullptr;
+  while (!end) {
+    ssize_t count = recv(connection, request + size,
+                         TEST_REQUEST_SIZE - 1 - size, 0);
+    if (count <= 0)
+      return false;
+    size += count;
+    request[size] = '\0';
+    end = strstr(request, "\r\n\r\n");
+  }
+
+  body = end + 4;
+  length = 0;
+  const char *header = strcasestr(request, "\r\nContent-Length:");
+  if (header && header < end)
+    length = strtoul(header + 17, nullptr, 10);
+  while ((size_t)(request + size - body) < length) {
+    ssize_t count = recv(connection, request + size,
+                         TEST_REQUEST_SIZE - 1 - size, 0);
+    if (count <= 0)
+      return false;
+    size += count;
+  }
+  return true;
+}
+
+/**
+ * @brief Serves the backend routes the wake cycle uses, one keep-alive
+ * connection at a time, until the test stops the stub.
+ */
+static void serve() {
+  char request[TEST_REQUEST_SIZE];
+  for (;;) {
+    int connection = accept(listener, nullptr, nullptr);
+    if (connection < 0)
+      continue;
+
+    char *body;
+    size_t length;
+    while (readRequest(connection, request, body, length)) {
+      int code = 200;
+      const char *reply = "{}";
+      if (strncmp(request, "POST /weather ", 14) == 0) {
+        code = 201;
+        counts->weatherPosts++;
+        // Binary batches carry their reading count after the version
+        if (strcasestr(request, TELEMETRY_CONTENT_TYPE) && length > 1)
+          counts->readingsPosted += (uint8_t)body[1];
+      } else if (strncmp(request, "POST /refresh ", 14) == 0) {
+        reply = "{\"auth_token\":\"native\"}";
+        counts->otherRequests++;
+      } else {
+        counts->otherRequests++;
+      }
+
+      char response[256];
+      int size = snprintf(response, sizeof(response),
+                          "HTTP/1.1 %d OK\r\nContent-Type: application/json"
+                          "\r\nContent-Length: %zu\r\n\r\n%s",
+                          code, strlen(reply), reply);
+      send(connection, response, size, 0);
+    }
+    close(connection);
+  }
+}
+
+/**
+ * @brief Listens on the loopback port of SERVER_URL.
+ * @return False if SERVER_URL is not a local http:// address.
+ */
+static bool listenOnServerUrl() {
+  const char *url = SERVER_URL;
+  const char *address = nullptr;
+  if (strncmp(url, "http://127.0.0.1:", 17) == 0)
+    address = url + 17;
+  else if (strncmp(url, "http://localhost:", 17) == 0)
+    address = url + 17;
+  if (!address)
+    return false;
+
+  struct sockaddr_in socketAddress = {};
+  socketAddress.sin_family = AF_INET;
+  socketAddress.sin_port = htons(atoi(address));
+  socketAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  return bind(listener, (struct sockaddr *)&socketAddress,
+              sizeof(socketAddress)) == 0 &&
+         listen(listener, 4) == 0;
+}
+
+/**
+ * @brief Writes the STACY_TRACE replay file: temperature alternating by
+ * more than its deadband, with moisture and battery steady.
+ * @return False if the file could not be written.
+ */
+static bool writeTrace() {
+  std::string path = std::string(directory) + "/trace.csv";
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+  fputs("# temperature,humidity,moisture_mv,battery_mv\n"
+        "21.0,45.0,2200,3900\n"
+        "22.0,45.0,2200,3900\n",
+        file);
+  fclose(file);
+  setenv("STACY_TRACE", path.c_str(), 1);
+  return true;
+}
+
+/**
+ * @brief One wake of the firmware, as NativeHAL's main() runs it.
+ */
+static void wake() {
+  if (!freopen("/dev/null", "w", stdout))
+    return;
+  setup();
+  loop();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_wakes_upload_one_batch() {
+  if (stub < 0)
+    TEST_IGNORE_MESSAGE("SERVER_URL is not a local http:// address.");
+
+  TEST_ASSERT_TRUE(NativeHal::runWakes(TEST_WAKES, wake));
+  printf("%d wakes: %u POST /weather with %u readings, %u other requests\n",
+         TEST_WAKES, counts->weatherPosts, counts->readingsPosted,
+         counts->otherRequests);
+  TEST_ASSERT_EQUAL_UINT32(1, counts->weatherPosts);
+  TEST_ASSERT_EQUAL_UINT32(READING_BUFFER_FLUSH_COUNT,
+                           counts->readingsPosted);
+}
+
+int main() {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  if (!mkdtemp(directory))
+    return 1;
+  setenv("STACY_NVS_DIR", directory, 1);
+  if (!writeTrace())
+    return 1;
+  NativeHal::provision(false);
+  counts = (StubCounts *)mmap(nullptr, sizeof(StubCounts),
+                              PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (counts == MAP_FAILED)
+    return 1;
+
+  if (listenOnServerUrl()) {
+    stub = fork();
+    if (stub == 0) {
+      serve();
+      _exit(0);
+    }
+    close(listener);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_wakes_upload_one_batch);
+  int failures = UNITY_END();
+  if (stub > 0) {
+    kill(stub, SIGTERM);
+    waitpid(stub, nullptr, 0);
+  }
+  std::filesystem::remove_all(directory);
+  return failures;
+}
@@ -2,27 +2,66 @@ const PlantData = require('../models/PlantData');
 const database = require('../utilities/database');
 const broadcast = require('../utilities/broadcast');
 const verifyToken = require('../middleware/verifyToken.js');
+const express = require('express');
+const {
+  TELEMETRY_CONTENT_TYPE,
+  decodeTelemetry,
+} = require('../utilities/telemetry');
+
+/**
+ * Checks whether a reading contains an unset (zero) measurement.
+ * @param {object} reading - The raw reading sent by the device.
+ * @returns {boolean} True if the reading must be skipped.
+ */
+const isInvalidReading = (reading) =>
+  !reading ||
+  reading.temperature == 0 ||
+  reading.humidity == 0 ||
+  reading.moisture == 0 ||
+  reading.hic == 0 ||
+  reading.batteryVoltage == 0 ||
+  reading.batteryPercentage == 0;
 
 const weatherRoutes = (app, clients) => {
   app.use('/weather', verifyToken);
+  app.use(
+    '/weather',
+    express.raw({ type: TELEMETRY_CONTENT_TYPE, limit: '16kb' })
+  );
 
   app.post('/weather', (req, res) => {
-    const rawDataFromDevice = req.body;
+    let rawDataFromDevice = req.body;
+    let profile = null;
     const device_id = req.headers['device-id'];
     const uid = req.headers['uid'];
 
     console.log('Received data from device: ', device_id);
     console.log('Received data from user: ', uid);
 
+    // Binary telemetry is decoded into the same shape as the JSON body.
+    if (Buffer.isBuffer(rawDataFromDevice)) {
+      try {
+        ({ readings: rawDataFromDevice, profile } =
+          decodeTelemetry(rawDataFromDevice));
+      } catch (error) {
+        console.warn('Invalid telemetry payload:', error.message);
+        return res
+          .status(400)
+          .send({ message: `Invalid telemetry payload: ${error.message}` });
+      }
+    }
+
+    // Devices may send a single reading or a batch of buffered readings.
+    const readings = Array.isArray(rawDataFromDevice)
+      ? rawDataFromDevice
+      : [rawDataFromDevice];
+
     if (
-      rawDataFromDevice.temperature == 0 ||
-      rawDataFromDevice.humidity == 0 ||
-      rawDataFromDevice.moisture == 0 ||
-      rawDataFromDevice.hic == 0 ||
-      rawDataFromDevice.batteryVoltage == 0 ||
-      rawDataFromDevice.batteryPercentage == 0
+      !rawDataFromDevice ||
+      typeof rawDataFromDevice !== 'object' ||
+      readings.length === 0
     ) {
-      console.warn('Unauthorized: Invalid sensor data received');
+      console.warn('Malformed or empty sensor data received');
       console.warn(
         'Received data: ',
         rawDataFromDevice,
@@ -31,7 +70,7 @@ const weatherRoutes = (app, clients) => {
       );
       return res
         .status(400)
-        .send({ message: 'Unauthorized: Invalid sensor data received.' });
+        .send({ message: 'Malformed or empty sensor data received.' });
     }
 
     if (!device_id || device_id.length === 0) {
@@ -47,40 +86,80 @@ const weatherRoutes = (app, clients) => {
         .send({ message: 'Unauthorized: No User-ID provided.' });
     }
 
-    try {
-      const plantDataObject = PlantData.fromObject(rawDataFromDevice);
-
-      database
-        .storePlantData(plantDataObject, device_id, uid)
-        .then((plant) => {
-          console.log(`Data stored successfully: `, plant);
-          broadcast(
-            clients,
-            JSON.stringify({
-              type: 'update',
-              plants: plant,
-            }),
-            uid
-          );
-          return res
-            .status(201)
-            .send({ message: 'Data stored and broadcast successfully' });
-        })
-        .catch((error) => {
-          console.error(
-            `Error saving data to database for device_id "${device_id}":`,
-            error
-          );
-          return res.status(500).send({
-            message: 'Error saving data to database. Check server logs.',
-          });
+    // Each reading is checked on its own, so one bad reading does not cost
+    // the device the rest of its batch.
+    const accepted = [];
+    readings.forEach((reading, index) => {
+      if (isInvalidReading(reading)) {
+        console.warn(
+          `Skipping invalid reading ${index} from device ${device_id}:`,
+          reading
+        );
+        return;
+      }
+      try {
+        accepted.push({
+          plantData: PlantData.fromObject(reading),
+          age: reading.age,
         });
-    } catch (error) {
-      console.error('Error processing incoming sensor data:', error.message);
+      } catch (error) {
+        console.warn(
+          `Skipping invalid reading ${index} from device ${device_id}:`,
+          error.message
+        );
+      }
+    });
+    const skipped = readings.length - accepted.length;
+
+    // Nothing left to store: the batch holds no reading at all.
+    if (accepted.length === 0) {
       return res
         .status(400)
-        .send({ message: `Invalid sensor data: ${error.message}` });
+        .send({ message: 'Invalid sensor data: no valid reading received.' });
     }
+
+    // Store sequentially so rows keep the device's chronological order.
+    accepted
+      .reduce(
+        (previous, { plantData, age }) =>
+          previous.then(() =>
+            database.storePlantData(plantData, device_id, uid, age)
+          ),
+        Promise.resolve()
+      )
+      .then((plant) => {
+        console.log(`Data stored successfully: `, plant);
+        // Timing data only, a failure must not fail the upload
+        if (profile) {
+          database
+            .storeWakeProfile(profile, device_id)
+            .catch((error) =>
+              console.error('Error storing wake profile:', error.message)
+            );
+        }
+        broadcast(
+          clients,
+          JSON.stringify({
+            type: 'update',
+            plants: plant,
+          }),
+          uid
+        );
+        return res.status(201).send({
+          message: 'Data stored and broadcast successfully',
+          stored: accepted.length,
+          skipped,
+        });
+      })
+      .catch((error) => {
+        console.error(
+          `Error saving data to database for device_id "${device_id}":`,
+          error
+        );
+        return res.status(500).send({
+          message: 'Error saving data to database. Check server logs.',
+        });
+      });
   });
 };
 
@@ -32,6 +32,26 @@ CREATE TABLE IF NOT EXISTS plant_data (
     FOREIGN KEY (plant_id) REFERENCES plants(plant_id)
 );`;
 
+// Time a device spent in each phase of an uplink wake, in milliseconds.
+const createWakeProfilesTable = `
+CREATE TABLE IF NOT EXISTS wake_profiles (
+    profile_id INTEGER PRIMARY KEY AUTOINCREMENT,
+    device_id TEXT NOT NULL,
+    timestamp DATETIME DEFAULT CURRENT_TIMESTAMP,
+    awake REAL,
+    boot REAL,
+    nvs REAL,
+    wifi REAL,
+    tls REAL,
+    sensor REAL,
+    adc REAL,
+    post REAL,
+    startup REAL,
+    battery REAL
+);
+CREATE INDEX IF NOT EXISTS idx_device_id_timestamp ON wake_profiles (device_id, timestamp);
+`;
+
 const createIndex = `
 CREATE INDEX IF NOT EXISTS idx_plant_id_timestamp ON plant_data (plant_id, timestamp);
 CREATE INDEX IF NOT EXISTS idx_user_id_plant_id ON plants (user_id, plant_id);
@@ -41,5 +61,6 @@ module.exports = {
   createUsersTable,
   createPlantsTable,
   createPlantDataTable,
+  createWakeProfilesTable,
   createIndex,
 };
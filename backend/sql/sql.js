@@ -2,9 +2,22 @@ const getTablesSQL = `
 SELECT name FROM sqlite_master WHERE type='table' LIMIT 1;
 `;
 
+const getWakeProfileColumnsSQL = `
+PRAGMA table_info(wake_profiles);
+`;
+
+const addWakeProfileColumnSQL = (phase) => `
+ALTER TABLE wake_profiles ADD COLUMN ${phase} REAL;
+`;
+
 const addPlantDataSQL = `
-INSERT INTO plant_data (plant_id, temperature, humidity, moisture, hic, batteryVoltage, batteryPercentage) 
-VALUES (?, ?, ?, ?, ?, ?, ?);
+INSERT INTO plant_data (plant_id, timestamp, temperature, humidity, moisture, hic, batteryVoltage, batteryPercentage) 
+VALUES (?, datetime('now', ?), ?, ?, ?, ?, ?, ?);
+`;
+
+const addWakeProfileSQL = `
+INSERT INTO wake_profiles (device_id, awake, boot, nvs, wifi, tls, sensor, adc, post, startup, battery)
+VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);
 `;
 
 const addUserSQL = `
@@ -57,12 +70,15 @@ SELECT * FROM plant_data WHERE data_id = ?;
 
 module.exports = {
   addPlantDataSQL,
+  addWakeProfileSQL,
   getPlantFromUserIdAndDeviceIdSQL,
   getPlantIdFromUserIdSQL,
   getDataByPlantIdSQL,
   addUserSQL,
   addPlantSQL,
   getTablesSQL,
+  getWakeProfileColumnsSQL,
+  addWakeProfileColumnSQL,
   getUserByEmailSQL,
   getUserPasswordSQL,
   getUserByUIDSQL,
@@ -9,6 +9,9 @@ const PlantData = require('../models/PlantData.js');
 
 const dbPath = path.resolve(__dirname, '../plant_station.db');
 
+// Wake profile phases added after the wake_profiles table was introduced
+const ADDED_PROFILE_PHASES = ['startup', 'battery'];
+
 let db;
 
 /**
@@ -35,6 +38,17 @@ function connectDatabase() {
             });
             console.log('Connected to a new SQLite database.');
           } else {
+            // Tables and columns added since the database was created
+            db.exec(sqlInitialize.createWakeProfilesTable, (err) => {
+              if (err) {
+                console.error(
+                  'Error creating wake profiles table:',
+                  err.message
+                );
+                return;
+              }
+              addWakeProfileColumns();
+            });
             console.log('Connected to an existing SQLite database.');
           }
           resolve(db);
@@ -44,6 +58,28 @@ function connectDatabase() {
   });
 }
 
+/**
+ * Adds the wake profile columns of phases devices started sending after the
+ * table was created.
+ */
+function addWakeProfileColumns() {
+  db.all(sql.getWakeProfileColumnsSQL, (err, columns) => {
+    if (err) {
+      console.error('Error reading wake profile columns:', err.message);
+      return;
+    }
+    ADDED_PROFILE_PHASES.filter(
+      (phase) => !columns.some((column) => column.name === phase)
+    ).forEach((phase) => {
+      db.exec(sql.addWakeProfileColumnSQL(phase), (err) => {
+        if (err) {
+          console.error('Error adding wake profile column:', err.message);
+        }
+      });
+    });
+  });
+}
+
 /**
  * Initializes the database by creating necessary tables.
  * This function is called when the database is first created.
@@ -56,6 +92,7 @@ async function initializeDatabase() {
         sqlInitialize.createUsersTable +
           sqlInitialize.createPlantsTable +
           sqlInitialize.createPlantDataTable +
+          sqlInitialize.createWakeProfilesTable +
           sqlInitialize.createIndex,
         (err) => {
           if (err) {
@@ -76,9 +113,11 @@ async function initializeDatabase() {
  * Saves weather data to the database.
  * @param {PlantData} weatherData - The weather data object (PlantData)
  * @param {string} device_id - The ID of the device (MAC address).
+ * @param {string} uid - The unique identifier of the user.
+ * @param {number} [age=0] - How many seconds ago the reading was taken.
  * @returns {Promise<void>} A promise that resolves when data is saved, or rejects on error.
  */
-function storePlantData(weatherData, device_id, uid) {
+function storePlantData(weatherData, device_id, uid, age = 0) {
   return new Promise((resolve, reject) => {
     const {
       temperature,
@@ -111,6 +150,7 @@ function storePlantData(weatherData, device_id, uid) {
             sql.addPlantDataSQL,
             [
               plant.plant_id,
+              `-${Math.max(0, Math.floor(Number(age) || 0))} seconds`,
               temperature,
               humidity,
               moisture,
@@ -167,6 +207,40 @@ function storePlantData(weatherData, device_id, uid) {
   });
 }
 
+/**
+ * Saves the phase timings of a device's uplink wake.
+ * @param {object} profile - The decoded wake profile, in milliseconds.
+ * @param {string} device_id - The ID of the device (MAC address).
+ * @returns {Promise<void>} A promise that resolves when the profile is saved.
+ */
+function storeWakeProfile(profile, device_id) {
+  return new Promise((resolve, reject) => {
+    db.run(
+      sql.addWakeProfileSQL,
+      [
+        device_id,
+        profile.awake,
+        profile.boot,
+        profile.nvs,
+        profile.wifi,
+        profile.tls,
+        profile.sensor,
+        profile.adc,
+        profile.post,
+        profile.startup,
+        profile.battery,
+      ],
+      (err) => {
+        if (err) {
+          console.error('Error inserting wake profile:', err.message);
+          return reject(err);
+        }
+        resolve();
+      }
+    );
+  });
+}
+
 /**
  * Retrieves the plant ID associated with a given user ID and device ID.
  * @param {string} uid - The unique identifier of the user.
@@ -461,6 +535,7 @@ module.exports = {
   connectDatabase,
   getDataByUID,
   storePlantData,
+  storeWakeProfile,
   createUser,
   createPlant,
   getUserByEmail,
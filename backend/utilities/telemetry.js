@@ -0,0 +1,382 @@
+const TELEMETRY_CONTENT_TYPE = 'application/vnd.stacy.telemetry';
+const TELEMETRY_HEADER_SIZE = 2;
+// Version 3 adds the age of the epoch that the record deltas count from
+const TELEMETRY_V3_HEADER_SIZE = 6;
+
+// Fixed-point scales and battery range, as in the firmware's
+// reading_record.h and configuration.h
+const RECORD_VERSION = 1;
+const RECORD_TEMPERATURE_SCALE = 100;
+const RECORD_HUMIDITY_SCALE = 100;
+const RECORD_MOISTURE_SCALE = 10;
+const RECORD_VOLTAGE_SCALE = 1000;
+const RECORD_NAN_TEMPERATURE = 0x01;
+const RECORD_NAN_HUMIDITY = 0x02;
+const RECORD_NAN_MOISTURE = 0x04;
+const RECORD_NAN_VOLTAGE = 0x08;
+const BATTERY_MIN = 3.0;
+const BATTERY_MAX = 3.8;
+
+/**
+ * Decodes a version 1 record: six little-endian float32 values followed by
+ * the age in seconds as a little-endian uint16.
+ * @param {Buffer} buffer - The payload.
+ * @param {number} offset - Offset of the record in the payload.
+ * @returns {object} The decoded reading.
+ */
+const decodeReadingV1 = (buffer, offset) => ({
+  temperature: buffer.readFloatLE(offset),
+  humidity: buffer.readFloatLE(offset + 4),
+  moisture: buffer.readFloatLE(offset + 8),
+  hic: buffer.readFloatLE(offset + 12),
+  batteryVoltage: buffer.readFloatLE(offset + 16),
+  batteryPercentage: buffer.readFloatLE(offset + 20),
+  age: buffer.readUInt16LE(offset + 24),
+});
+
+/**
+ * NWS heat index, as the firmware computes it: Steadman's simple formula,
+ * then the Rothfusz regression and its adjustments above 79 °F.
+ * @param {number} celsius - The temperature, in °C.
+ * @param {number} humidity - The relative humidity, in %.
+ * @returns {number} The heat index in °C.
+ */
+function heatIndex(celsius, humidity) {
+  const t = celsius * 1.8 + 32;
+  let index = t;
+  if (t > 40) {
+    index = 1.1 * t - 10.3 + 0.047 * humidity;
+    if (index >= 79) {
+      index =
+        -42.379 +
+        2.04901523 * t +
+        10.14333127 * humidity -
+        0.22475541 * t * humidity -
+        0.00683783 * t * t -
+        0.05481717 * humidity * humidity +
+        0.00122874 * t * t * humidity +
+        0.00085282 * t * humidity * humidity -
+        0.00000199 * t * t * humidity * humidity;
+      if (humidity < 13 && t >= 80 && t <= 112) {
+        index -=
+          (13 - humidity) * 0.25 * Math.sqrt((17 - Math.abs(t - 95)) * 0.05882);
+      } else if (humidity > 85 && t >= 80 && t <= 87) {
+        index += 0.02 * (humidity - 85) * (87 - t);
+      }
+    }
+  }
+  return ((index - 32) * 5) / 9;
+}
+
+/**
+ * Battery charge from its voltage, as the firmware computes it.
+ * @param {number} voltage - The battery voltage.
+ * @returns {number} The charge in %, clamped to 0 to 100.
+ */
+const batteryPercentage = (voltage) =>
+  Math.min(
+    100,
+    Math.max(0, ((voltage - BATTERY_MIN) / (BATTERY_MAX - BATTERY_MIN)) * 100)
+  );
+
+/**
+ * Converts a fixed-point record to a reading, deriving the heat index and
+ * battery percentage.
+ * @param {object} record - The record version, flags, temperature in
+ * centi-°C, humidity in centi-%RH, moisture in per-mille, battery voltage in
+ * mV and delta from the epoch in seconds.
+ * @param {number} epochAge - Age of the epoch in seconds.
+ * @returns {object} The reading.
+ * @throws {Error} if the record version is unknown.
+ */
+function readingFromRecord(record, epochAge) {
+  if (record.version !== RECORD_VERSION) {
+    throw new Error(`Unsupported telemetry record version: ${record.version}.`);
+  }
+  const value = (flag, raw, scale) =>
+    record.flags & flag ? NaN : raw / scale;
+
+  const temperature = value(
+    RECORD_NAN_TEMPERATURE,
+    record.temperature,
+    RECORD_TEMPERATURE_SCALE
+  );
+  const humidity = value(
+    RECORD_NAN_HUMIDITY,
+    record.humidity,
+    RECORD_HUMIDITY_SCALE
+  );
+  const batteryVoltage = value(
+    RECORD_NAN_VOLTAGE,
+    record.batteryVoltage,
+    RECORD_VOLTAGE_SCALE
+  );
+  return {
+    temperature,
+    humidity,
+    moisture: value(
+      RECORD_NAN_MOISTURE,
+      record.moisture,
+      RECORD_MOISTURE_SCALE
+    ),
+    hic: heatIndex(temperature, humidity),
+    batteryVoltage,
+    batteryPercentage: batteryPercentage(batteryVoltage),
+    age: Math.max(0, epochAge - record.delta),
+  };
+}
+
+/**
+ * Decodes a version 3 record: the record version and NaN flags as uint8
+ * values, the temperature in centi-°C as a little-endian int16, then the
+ * humidity in centi-%RH, the moisture in per-mille, the battery voltage in
+ * mV and the delta from the epoch in seconds as little-endian uint16 values.
+ * @param {Buffer} buffer - The payload.
+ * @param {number} offset - Offset of the record in the payload.
+ * @returns {object} The decoded reading.
+ * @throws {Error} if the record version is unknown.
+ */
+const decodeReadingV3 = (buffer, offset) =>
+  readingFromRecord(
+    {
+      version: buffer.readUInt8(offset),
+      flags: buffer.readUInt8(offset + 1),
+      temperature: buffer.readInt16LE(offset + 2),
+      humidity: buffer.readUInt16LE(offset + 4),
+      moisture: buffer.readUInt16LE(offset + 6),
+      batteryVoltage: buffer.readUInt16LE(offset + 8),
+      delta: buffer.readUInt16LE(offset + 10),
+    },
+    buffer.readUInt32LE(2)
+  );
+
+/**
+ * Makes a decoder of readings stored as records of one size.
+ * @param {number} size - The record size.
+ * @param {Function} decode - Decodes the record at an offset.
+ * @returns {Function} The decoder, returning the readings and their end.
+ */
+const fixedRecords = (size, decode) => (buffer, offset, count) => {
+  const end = offset + count * size;
+  if (end > buffer.length) {
+    throw new Error('Telemetry payload length does not match its header.');
+  }
+  const readings = [];
+  for (let i = 0; i < count; i++) {
+    readings.push(decode(buffer, offset + i * size));
+  }
+  return { readings, end };
+};
+
+// Series modes and coded values, as in the firmware's series_encoder.h
+const SERIES_DELTA = 0;
+const SERIES_XOR = 1;
+const SERIES_VALUES = ['temperature', 'humidity', 'moisture', 'batteryVoltage'];
+
+/**
+ * Reads an unsigned LEB128 varint: 7 bits per byte, low bits first, the high
+ * bit set on every byte but the last.
+ * @param {Buffer} buffer - The payload.
+ * @param {number} offset - Offset of the varint in the payload.
+ * @returns {{value: number, size: number}} The value and its encoded size.
+ * @throws {Error} if the varint runs past the payload or 32 bits.
+ */
+function readVarint(buffer, offset) {
+  let value = 0;
+  for (let size = 0; size < 5; size++) {
+    if (offset + size >= buffer.length) {
+      throw new Error('Telemetry series runs past the payload.');
+    }
+    const byte = buffer[offset + size];
+    value += (byte & 0x7f) * 2 ** (7 * size);
+    if (!(byte & 0x80)) {
+      return { value, size: size + 1 };
+    }
+  }
+  throw new Error('Telemetry series holds an invalid varint.');
+}
+
+// Maps a zigzag value back to a signed one: 0, 1, 2, 3 become 0, -1, 1, -2
+const unzigzag = (value) => (value % 2 ? -(value + 1) / 2 : value / 2);
+
+/**
+ * Decodes a version 4 series: the SeriesMode as a uint8, then, unless there
+ * are no readings, the record version, and for each reading the
+ * delta-of-delta of its time as a zigzag varint shifted left by one, whose
+ * low bit tells that the flags follow, having changed, then its
+ * temperature, humidity, moisture and battery voltage. In SERIES_DELTA mode a value is a
+ * zigzag varint of its difference from the previous reading's, modulo 2^16,
+ * and in SERIES_XOR mode a varint of the bits that differ. The first
+ * reading is coded against a reading of zeros.
+ * @param {Buffer} buffer - The payload.
+ * @param {number} offset - Offset of the series in the payload.
+ * @param {number} count - The number of readings.
+ * @returns {{readings: object[], end: number}} The readings and the offset
+ * where the series ends.
+ * @throws {Error} if the series is malformed or its mode unknown.
+ */
+function decodeSeries(buffer, offset, count) {
+  if (offset >= buffer.length) {
+    throw new Error('Telemetry payload is missing its series.');
+  }
+  const mode = buffer.readUInt8(offset);
+  if (mode !== SERIES_DELTA && mode !== SERIES_XOR) {
+    throw new Error(`Unsupported telemetry series mode: ${mode}.`);
+  }
+  let position = offset + 1;
+  const next = () => {
+    const { value, size } = readVarint(buffer, position);
+    position += size;
+    return value;
+  };
+
+  const readings = [];
+  if (count === 0) {
+    return { readings, end: position };
+  }
+  const epochAge = buffer.readUInt32LE(2);
+  const version = next();
+  const previous = SERIES_VALUES.map(() => 0);
+  let flags = 0;
+  let time = 0;
+  let step = 0;
+  for (let i = 0; i < count; i++) {
+    const timing = next();
+    if (timing % 2) {
+      flags = next();
+    }
+    step += unzigzag(Math.floor(timing / 2));
+    time += step;
+    const record = { version, flags, delta: time };
+    SERIES_VALUES.forEach((field, j) => {
+      const coded = next();
+      previous[j] =
+        (mode === SERIES_XOR
+          ? previous[j] ^ coded
+          : previous[j] + unzigzag(coded)) & 0xffff;
+      record[field] = previous[j];
+    });
+    // The temperature is an int16
+    record.temperature = (record.temperature << 16) >> 16;
+    readings.push(readingFromRecord(record, epochAge));
+  }
+  return { readings, end: position };
+}
+
+// Version 2 appends the wake profile of the device's previous uplink,
+// version 3 sends fixed-point records timed from an epoch, and version 4
+// compresses them as a series
+const decoders = {
+  1: {
+    headerSize: TELEMETRY_HEADER_SIZE,
+    decodeReadings: fixedRecords(26, decodeReadingV1),
+    profile: false,
+  },
+  2: {
+    headerSize: TELEMETRY_HEADER_SIZE,
+    decodeReadings: fixedRecords(26, decodeReadingV1),
+    profile: true,
+  },
+  3: {
+    headerSize: TELEMETRY_V3_HEADER_SIZE,
+    decodeReadings: fixedRecords(12, decodeReadingV3),
+    profile: true,
+  },
+  4: {
+    headerSize: TELEMETRY_V3_HEADER_SIZE,
+    decodeReadings: decodeSeries,
+    profile: true,
+  },
+};
+
+// Phases of a wake, in the order the device sends them
+const PROFILE_PHASES = [
+  'boot',
+  'nvs',
+  'wifi',
+  'tls',
+  'sensor',
+  'adc',
+  'post',
+  'startup',
+  'battery',
+];
+const PROFILE_UNITS_PER_MS = 10;
+
+/**
+ * Decodes a wake profile: the phase count as a uint8, then, unless it is 0,
+ * the awake time and the time of each phase as little-endian uint16 values
+ * in units of 100 microseconds. Phases unknown to this server are ignored.
+ * @param {Buffer} buffer - The payload.
+ * @param {number} offset - Offset of the profile in the payload.
+ * @returns {{profile: (object|null), size: number}} The profile in
+ * milliseconds, or null if the device sent none, and its encoded size.
+ * @throws {Error} if the profile runs past the payload.
+ */
+function decodeProfile(buffer, offset) {
+  if (offset >= buffer.length) {
+    throw new Error('Telemetry payload is missing its profile.');
+  }
+  const phaseCount = buffer.readUInt8(offset);
+  if (phaseCount === 0) {
+    return { profile: null, size: 1 };
+  }
+  const size = 1 + 2 + 2 * phaseCount;
+  if (offset + size > buffer.length) {
+    throw new Error('Telemetry profile runs past the payload.');
+  }
+
+  const profile = {
+    awake: buffer.readUInt16LE(offset + 1) / PROFILE_UNITS_PER_MS,
+  };
+  PROFILE_PHASES.slice(0, phaseCount).forEach((phase, i) => {
+    profile[phase] =
+      buffer.readUInt16LE(offset + 3 + 2 * i) / PROFILE_UNITS_PER_MS;
+  });
+  return { profile, size };
+}
+
+/**
+ * Decodes a binary telemetry payload sent by a device.
+ * @param {Buffer} buffer - The raw request body.
+ * @returns {{readings: object[], profile: (object|null)}} The readings,
+ * oldest first, and the wake profile if the payload carries one.
+ * @throws {Error} if the payload is malformed or its version is unknown.
+ */
+function decodeTelemetry(buffer) {
+  if (!Buffer.isBuffer(buffer) || buffer.length < TELEMETRY_HEADER_SIZE) {
+    throw new Error('Telemetry payload is too short.');
+  }
+
+  const version = buffer.readUInt8(0);
+  const count = buffer.readUInt8(1);
+  const decoder = decoders[version];
+  if (!decoder) {
+    throw new Error(`Unsupported telemetry version: ${version}.`);
+  }
+  if (buffer.length < decoder.headerSize) {
+    throw new Error('Telemetry payload is too short.');
+  }
+  const { readings, end } = decoder.decodeReadings(
+    buffer,
+    decoder.headerSize,
+    count
+  );
+  let profile = null;
+  let length = end;
+  if (decoder.profile) {
+    const decoded = decodeProfile(buffer, end);
+    profile = decoded.profile;
+    length += decoded.size;
+  }
+  if (buffer.length !== length) {
+    throw new Error('Telemetry payload length does not match its header.');
+  }
+  return { readings, profile };
+}
+
+module.exports = {
+  TELEMETRY_CONTENT_TYPE,
+  PROFILE_PHASES,
+  decodeTelemetry,
+};